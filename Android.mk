@@ -107,6 +107,8 @@ LOCAL_SRC_FILES := \
     session/src/SessionAlsaVoice.cpp \
     session/src/SoundTriggerEngine.cpp \
     session/src/SoundTriggerEngineCapi.cpp \
+    session/src/SoundTriggerCapiLoop.cpp \
+    session/src/SoundTriggerMmapPacer.cpp \
     session/src/SoundTriggerEngineGsl.cpp \
     session/src/ContextDetectionEngine.cpp \
     context_manager/src/ContextManager.cpp \
@@ -117,6 +119,9 @@ LOCAL_SRC_FILES := \
     utils/src/SoundTriggerPlatformInfo.cpp \
     utils/src/ACDPlatformInfo.cpp \
     utils/src/PalRingBuffer.cpp \
+    utils/src/PalIoReactor.cpp \
+    utils/src/PalTaskPool.cpp \
+    utils/src/PalTimerService.cpp \
     utils/src/SoundTriggerUtils.cpp \
     utils/src/SignalHandler.cpp
 ifeq ($(strip $(AUDIO_FEATURE_ENABLED_EC_REF_CAPTURE)),true)
@@ -148,6 +153,7 @@ LOCAL_SHARED_LIBRARIES += libqti-tinyalsa libqti-tinycompress
 else
 LOCAL_C_INCLUDES       += $(TOP)/external/tinycompress/include
 LOCAL_SHARED_LIBRARIES += libtinyalsa libtinycompress
+LOCAL_CFLAGS           += -DTINYALSA_PCM_FRAMES_API
 endif
 
 include $(BUILD_SHARED_LIBRARY)
@@ -195,6 +201,103 @@ LOCAL_VENDOR_MODULE := true
 
 include $(BUILD_EXECUTABLE)
 
+#-------------------------------------------
+#   Build second stage replay benchmark
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/StReplayTest.cpp \
+                    session/src/SoundTriggerCapiLoop.cpp \
+                    utils/src/PalRingBuffer.cpp
+LOCAL_MODULE     := StReplayTest
+include $(PAL_BASE_PATH)/test/pal_src_test.mk
+
+#-------------------------------------------
+#   Build MMAP lab pacing benchmark
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/StMmapPacingBench.cpp \
+                    session/src/SoundTriggerMmapPacer.cpp
+LOCAL_MODULE     := StMmapPacingBench
+include $(PAL_BASE_PATH)/test/pal_src_test.mk
+
+#-------------------------------------------
+#   Build ring buffer tests
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalRingBufferTest.cpp \
+                    utils/src/PalRingBuffer.cpp
+LOCAL_MODULE     := PalRingBufferTest
+include $(PAL_BASE_PATH)/test/pal_src_test.mk
+
+# same tests under ThreadSanitizer
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalRingBufferTest.cpp \
+                    utils/src/PalRingBuffer.cpp
+LOCAL_MODULE     := PalRingBufferTest_tsan
+LOCAL_SANITIZE   := thread
+LOCAL_MULTILIB   := 64
+include $(PAL_BASE_PATH)/test/pal_src_test.mk
+
+ifneq ($(QCPATH),)
+
+#-------------------------------------------
+#   Build device info lookup test
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalDeviceInfoTest.cpp
+LOCAL_MODULE     := PalDeviceInfoTest
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+#-------------------------------------------
+#   Build usecase KV snapshot tool
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalKvSnapshotTool.cpp
+LOCAL_MODULE     := PalKvSnapshotTool
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+#-------------------------------------------
+#   Build volume payload allocation test
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalPayloadAllocTest.cpp
+LOCAL_MODULE     := PalPayloadAllocTest
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+#-------------------------------------------
+#   Build stream handle validation benchmark
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalHandleBench.cpp
+LOCAL_MODULE     := PalHandleBench
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+#-------------------------------------------
+#   Build stream volume latency benchmark
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalVolumeBench.cpp
+LOCAL_MODULE     := PalVolumeBench
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+#-------------------------------------------
+#   Build usecase KV lookup benchmark
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalKvBench.cpp
+LOCAL_MODULE     := PalKvBench
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+#-------------------------------------------
+#   Build device switch gap benchmark
+#-------------------------------------------
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES  := test/PalDevSwitchGapBench.cpp
+LOCAL_MODULE     := PalDevSwitchGapBench
+include $(PAL_BASE_PATH)/test/pal_lib_test.mk
+
+endif
+
 include $(CLEAR_VARS)
 
 include $(PAL_BASE_PATH)/plugins/Android.mk
@@ -581,6 +581,59 @@ int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle,
     return status;
 }
 
+int32_t pal_stream_set_volume_ramp(pal_stream_handle_t *stream_handle,
+                                   struct pal_volume_data *volume,
+                                   uint32_t duration_ms,
+                                   pal_volume_ramp_curve_t curve)
+{
+    Stream *s = NULL;
+    int status;
+    std::shared_ptr<ResourceManager> rm = NULL;
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        status = -EINVAL;
+        return status;
+    }
+
+    if (!stream_handle || !volume || curve > PAL_VOLUME_RAMP_FRAC_EXP) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG,"Invalid input parameters status %d", status);
+        return status;
+    }
+    PAL_DBG(LOG_TAG, "Enter. Stream handle :%pK ramp %u ms curve %d",
+            stream_handle, duration_ms, curve);
+
+    rm->lockValidStreamMutex();
+    if (!rm->isActiveStream(stream_handle)) {
+        rm->unlockValidStreamMutex();
+        status = -EINVAL;
+        return status;
+    }
+
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = rm->increaseStreamUserCounter(s);
+    if (0 != status) {
+        rm->unlockValidStreamMutex();
+        PAL_ERR(LOG_TAG, "failed to increase stream user count");
+        return status;
+    }
+    rm->unlockValidStreamMutex();
+
+    status = s->setVolumeRamp(volume, duration_ms, curve);
+
+    rm->lockValidStreamMutex();
+    rm->decreaseStreamUserCounter(s);
+    rm->unlockValidStreamMutex();
+
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "setVolumeRamp failed with status %d", status);
+        return status;
+    }
+    PAL_DBG(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
 int32_t pal_stream_set_mute(pal_stream_handle_t *stream_handle, bool state)
 {
     Stream *s = NULL;
@@ -267,6 +267,11 @@ int32_t pal_stream_set_buffer_size (pal_stream_handle_t *stream_handle,
   * Capture timestamps will be populated if session was
   * opened with timetamp flag.
   *
+  * Non-mmap PCM streams opened with PAL_STREAM_FLAG_NON_BLOCKING
+  * and a callback return what is captured already, -EAGAIN if
+  * nothing is, and report PAL_STREAM_CBK_EVENT_READ_DONE once more
+  * data arrives. Without a callback the read blocks as before.
+  *
   * \param[in] stream_handle - Valid stream handle obtained
   *       from pal_stream_open
   * \param[in] buf - pointer to pal_buffer containing audio
@@ -291,6 +296,12 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
   * pal_stream_open, the callback function will be called when
   * more space is available in the driver/hardware buffer.
   *
+  * For non-mmap PCM streams, PAL_STREAM_FLAG_NON_BLOCKING takes
+  * effect only when a callback is passed to pal_stream_open; the
+  * write then returns -EAGAIN when nothing fits and
+  * PAL_STREAM_CBK_EVENT_WRITE_READY follows once there is room.
+  * Without a callback the write blocks as before.
+  *
   * \param[in] stream_handle - Valid stream handle obtained
   *       from pal_stream_open
   * \param[in] buf - pointer to pal_buffer containing audio
@@ -392,6 +403,27 @@ int32_t pal_stream_get_volume(pal_stream_handle_t *stream_handle,
 int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle,
                               struct pal_volume_data *volume);
 
+/**
+  * \brief Ramp audio volume of a stream to a target in one request.
+  *
+  * The ramp is run by the DSP volume module, so a fade costs a single
+  * mixer write instead of one per intermediate step. Streams that do not
+  * use set param based volume have no ramp and fail a non zero duration_ms
+  * with -ENOSYS, the volume is left unchanged.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] volume - target volume data.
+  * \param[in] duration_ms - ramp duration in ms, 0 sets the volume directly.
+  * \param[in] curve - ramp curve.
+  *
+  * \return 0 on success, -ENOSYS if the stream cannot ramp, error code otherwise
+  */
+int32_t pal_stream_set_volume_ramp(pal_stream_handle_t *stream_handle,
+                                   struct pal_volume_data *volume,
+                                   uint32_t duration_ms,
+                                   pal_volume_ramp_curve_t curve);
+
 /**
   * \brief Get current audio audio mute state to a stream.
   *
@@ -813,6 +813,20 @@ struct pal_volume_data {
     struct pal_channel_vol_kv volume_pair[];     /**< channel mask and volume pair */
 };
 
+/** Shape of the gain ramp applied by the DSP on a volume change */
+typedef enum {
+    PAL_VOLUME_RAMP_LINEAR = 0,                   /**< linear ramp */
+    PAL_VOLUME_RAMP_EXP = 1,                      /**< exponential ramp */
+    PAL_VOLUME_RAMP_LOG = 2,                      /**< logarithmic ramp */
+    PAL_VOLUME_RAMP_FRAC_EXP = 3,                 /**< fractional exponential ramp */
+} pal_volume_ramp_curve_t;
+
+/** Ramp info, followed by pal_volume_data in PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM */
+struct pal_volume_ramp_info {
+    uint32_t duration_ms;                         /**< ramp duration in ms */
+    uint32_t curve;                               /**< one of pal_volume_ramp_curve_t */
+};
+
 struct pal_time_us {
     uint32_t value_lsw;   /** Lower 32 bits of 64 bit time value in microseconds */
     uint32_t value_msw;   /** Upper 32 bits of 64 bit time value in microseconds */
@@ -903,6 +917,11 @@ typedef enum {
     PAL_PARAM_ID_VOLUME_USING_SET_PARAM = 55,
     PAL_PARAM_ID_UHQA_FLAG = 56,
     PAL_PARAM_ID_STREAM_ATTRIBUTES = 57,
+    PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM = 58,
+    PAL_PARAM_ID_ST_LAB_READ_CONFIG = 59,
+    PAL_PARAM_ID_MIXER_WRITE_STATS = 60,
+    PAL_PARAM_ID_DEVICE_SWITCH_STATS = 61,
+    PAL_PARAM_ID_COMPRESS_CALLBACK_LATENCY = 62,
 } pal_param_id_type_t;
 
 /** HDMI/DP */
@@ -1027,6 +1046,54 @@ typedef struct pal_param_uhqa_state {
     bool uhqa_state;
 } pal_param_uhqa_t;
 
+/* Payload For ID: PAL_PARAM_ID_ST_LAB_READ_CONFIG
+ * Description   : how reads of buffered keyword audio wait for data
+ */
+typedef enum {
+    PAL_ST_LAB_READ_PACED = 0, /**< default, after a short read wait up to one
+                                    buffer duration for the next buffer */
+    PAL_ST_LAB_READ_PARTIAL,   /**< return what is buffered right away */
+    PAL_ST_LAB_READ_DEADLINE,  /**< block until the buffer is full or
+                                    deadline_ms expires */
+} pal_st_lab_read_mode_t;
+
+typedef struct pal_param_st_lab_read_config {
+    pal_st_lab_read_mode_t mode;
+    uint32_t deadline_ms;      /**< used by PAL_ST_LAB_READ_DEADLINE */
+} pal_param_st_lab_read_config_t;
+
+/* Payload For ID: PAL_PARAM_ID_MIXER_WRITE_STATS
+ * Description   : mixer control writes sent to the driver vs skipped because
+ *                 the control already held the value, since PAL init
+ */
+typedef struct pal_param_mixer_write_stats {
+    uint64_t issued;
+    uint64_t skipped;
+} pal_param_mixer_write_stats_t;
+
+/* Payload For ID: PAL_PARAM_ID_DEVICE_SWITCH_STATS
+ * Description   : gap of the stream silent longest during a device switch,
+ *                 i.e. from its disconnect to its reconnect
+ */
+typedef struct pal_param_device_switch_stats {
+    uint32_t last_streams;     /**< streams moved by the last switch */
+    int64_t last_gap_us;       /**< longest stream gap of the last switch */
+    int64_t max_gap_us;        /**< longest stream gap since PAL init */
+    uint32_t switches;         /**< switches done since PAL init */
+    int32_t last_status;       /**< status of the last switch */
+    bool last_per_stream;      /**< last switch moved streams one at a time */
+} pal_param_device_switch_stats_t;
+
+/* Payload For ID: PAL_PARAM_ID_COMPRESS_CALLBACK_LATENCY
+ * Description   : time from a compress offload event being ready to the
+ *                 client callback returning, over all sessions since PAL init
+ */
+typedef struct pal_param_compress_cb_latency {
+    uint64_t count;            /**< callbacks measured */
+    uint64_t avg_us;
+    uint64_t max_us;
+} pal_param_compress_cb_latency_t;
+
 /* Payload For ID: PAL_PARAM_ID_BT_SCO*
  * Description   : BT SCO related device parameters
 */
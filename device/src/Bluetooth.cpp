@@ -747,7 +747,7 @@ void Bluetooth::startAbr()
     }
 
     connectCtrlName << "PCM" << fbpcmDevIds.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtualMixerHandle, connectCtrlName.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(virtualMixerHandle, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         goto free_fe;
@@ -762,7 +762,7 @@ void Bluetooth::startAbr()
 
     // Notify ABR usecase information to BT driver to distinguish
     // between SCO and feedback usecase
-    btSetFeedbackChannelCtrl = mixer_get_ctl_by_name(hwMixerHandle,
+    btSetFeedbackChannelCtrl = ResourceManager::getMixerCtl(hwMixerHandle,
                                         MIXER_SET_FEEDBACK_CHANNEL);
     if (!btSetFeedbackChannelCtrl) {
         PAL_ERR(LOG_TAG, "ERROR %s mixer control not identified",
@@ -770,7 +770,7 @@ void Bluetooth::startAbr()
         goto disconnect_fe;
     }
 
-    if (mixer_ctl_set_value(btSetFeedbackChannelCtrl, 0, 1) != 0) {
+    if (ResourceManager::setMixerCtlValue(btSetFeedbackChannelCtrl, 0, 1) != 0) {
         PAL_ERR(LOG_TAG, "Failed to set BT usecase");
         goto disconnect_fe;
     }
@@ -1115,7 +1115,7 @@ err_pcm_open:
     fbPcm = NULL;
 disconnect_fe:
     disconnectCtrlName << "PCM" << fbpcmDevIds.at(0) << " disconnect";
-    disconnectCtrl = mixer_get_ctl_by_name(virtualMixerHandle, disconnectCtrlName.str().data());
+    disconnectCtrl = ResourceManager::getMixerCtl(virtualMixerHandle, disconnectCtrlName.str().data());
     if(disconnectCtrl != NULL){
        mixer_ctl_set_enum_by_string(disconnectCtrl, backEndName.c_str());
     }
@@ -1175,12 +1175,12 @@ void Bluetooth::stopAbr()
         goto free_fe;
     }
     // Reset BT driver mixer control for ABR usecase
-    btSetFeedbackChannelCtrl = mixer_get_ctl_by_name(hwMixerHandle,
+    btSetFeedbackChannelCtrl = ResourceManager::getMixerCtl(hwMixerHandle,
                                         MIXER_SET_FEEDBACK_CHANNEL);
     if (!btSetFeedbackChannelCtrl) {
         PAL_ERR(LOG_TAG, "%s mixer control not identified",
                 MIXER_SET_FEEDBACK_CHANNEL);
-    } else if (mixer_ctl_set_value(btSetFeedbackChannelCtrl, 0, 0) != 0) {
+    } else if (ResourceManager::setMixerCtlValue(btSetFeedbackChannelCtrl, 0, 0) != 0) {
         PAL_ERR(LOG_TAG, "Failed to reset BT usecase");
     }
 
@@ -546,7 +546,7 @@ int32_t Device::configureDeviceClockSrc(char const *mixerStrClockSrc, const uint
     /* Hw mixer control registration is optional in case
      * clock source selection is not required
      */
-    clockSrcCtrl = mixer_get_ctl_by_name(hwMixerHandle, mixerStrClockSrc);
+    clockSrcCtrl = ResourceManager::getMixerCtl(hwMixerHandle, mixerStrClockSrc);
     if (!clockSrcCtrl) {
         PAL_DBG(LOG_TAG, "%s hw mixer control not identified", mixerStrClockSrc);
         goto exit;
@@ -357,7 +357,7 @@ int DisplayPort::updateAudioAckState(int node_value, int controller, int stream)
                  "%s%d %s", ctl_prefix, ctl_index, ctl_suffix);
 
     PAL_DBG(LOG_TAG, "mixer ctl name: %s", mixer_ctl_name);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_ctl_name);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_ctl_name);
     /* If no mixer command support, fall back to sysfs node approach */
     if (!ctl) {
         PAL_DBG(LOG_TAG, "could not get ctl for mixer cmd(%s), use sysfs node instead\n",
@@ -508,7 +508,7 @@ int32_t DisplayPort::setExtDisplayDevice(struct audio_mixer *mixer, int controll
 
     PAL_DBG(LOG_TAG," mixer: %pK mixer ctl name: %s", mixer, mixerCtlName);
 
-    ctl = mixer_get_ctl_by_name(mixer, mixerCtlName);
+    ctl = ResourceManager::getMixerCtl(mixer, mixerCtlName);
     if (!ctl) {
         PAL_ERR(LOG_TAG,"Could not get ctl for mixer cmd - %s", mixerCtlName);
         return -EINVAL;
@@ -553,7 +553,7 @@ int32_t DisplayPort::getExtDispType(struct audio_mixer *mixer, int controller, i
 
         PAL_VERBOSE(LOG_TAG,"mixer ctl name: %s", mixerCtlName);
 
-        ctl = mixer_get_ctl_by_name(mixer, mixerCtlName);
+        ctl = ResourceManager::getMixerCtl(mixer, mixerCtlName);
         if (!ctl) {
             PAL_ERR(LOG_TAG,"Could not get ctl for mixer cmd - %s", mixerCtlName);
             return -EINVAL;
@@ -628,7 +628,7 @@ int DisplayPort::getEdidInfo(struct audio_mixer *mixer, int controller, int stre
 
     PAL_VERBOSE(LOG_TAG," mixer ctl name: %s", mixerCtlName);
 
-    ctl = mixer_get_ctl_by_name(mixer, mixerCtlName);
+    ctl = ResourceManager::getMixerCtl(mixer, mixerCtlName);
     if (!ctl) {
         PAL_ERR(LOG_TAG," Could not get ctl for mixer cmd - %s", mixerCtlName);
         goto fail;
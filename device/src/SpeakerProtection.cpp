@@ -298,7 +298,7 @@ int SpeakerProtection::getCpsDevNumber(std::string mixer_name)
     PAL_DBG(LOG_TAG, "Mixer control %s", mixer_name.c_str());
     PAL_DBG(LOG_TAG, "audio_hw_mixer %pK", hwMixer);
 
-    ctl = mixer_get_ctl_by_name(hwMixer, mixer_name.c_str());
+    ctl = ResourceManager::getMixerCtl(hwMixer, mixer_name.c_str());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_name.c_str());
         status = -ENOENT;
@@ -329,7 +329,7 @@ int SpeakerProtection::getSpeakerTemperature(int spkr_pos)
 
     PAL_DBG(LOG_TAG, "audio_mixer %pK", hwMixer);
 
-    ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
+    ctl = ResourceManager::getMixerCtl(hwMixer, mixer_ctl_name.c_str());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_ctl_name.c_str());
         status = -EINVAL;
@@ -366,7 +366,7 @@ void SpeakerProtection::disconnectFeandBe(std::vector<int> pcmDevIds,
     }
 
     disconnectCtrlNameBe<< backEndName << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, disconnectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer, disconnectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         ret = -EINVAL;
         PAL_ERR(LOG_TAG, "Error: %d, invalid mixer control %s", ret, backEndName.c_str());
@@ -374,7 +374,7 @@ void SpeakerProtection::disconnectFeandBe(std::vector<int> pcmDevIds,
     }
 
     disconnectCtrlName << "PCM" << pcmDevIds.at(0) << " disconnect";
-    disconnectCtrl = mixer_get_ctl_by_name(virtMixer, disconnectCtrlName.str().data());
+    disconnectCtrl = ResourceManager::getMixerCtl(virtMixer, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         ret = -EINVAL;
         PAL_ERR(LOG_TAG, "Error: %d, invalid mixer control: %s", ret, disconnectCtrlName.str().data());
@@ -550,7 +550,7 @@ int SpeakerProtection::spkrStartCalibrationV2()
     }
 
     connectCtrlNameBeVI<< backEndNameTx << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBeVI.str().data());
+    beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlNameBeVI.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndNameTx.c_str());
         ret = -EINVAL;
@@ -586,7 +586,7 @@ int SpeakerProtection::spkrStartCalibrationV2()
     }
 
     connectCtrlName << "PCM" << pcmDevIdsTx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         goto free_fe;
@@ -823,7 +823,7 @@ int SpeakerProtection::spkrStartCalibrationV2()
 
     connectCtrlNameBe<< backEndNameRx << " metadata";
 
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", backEndNameRx.c_str());
         ret = -EINVAL;
@@ -860,7 +860,7 @@ int SpeakerProtection::spkrStartCalibrationV2()
     }
 
     connectCtrlNameRx << "PCM" << pcmDevIdsRx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameRx.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlNameRx.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlNameRx.str().data());
         ret = -ENOSYS;
@@ -1203,7 +1203,7 @@ int SpeakerProtection::spkrStartCalibration()
     }
 
     connectCtrlNameBeVI<< backEndNameTx << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBeVI.str().data());
+    beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlNameBeVI.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndNameTx.c_str());
         ret = -EINVAL;
@@ -1239,7 +1239,7 @@ int SpeakerProtection::spkrStartCalibration()
     }
 
     connectCtrlName << "PCM" << pcmDevIdsTx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         goto free_fe;
@@ -1475,7 +1475,7 @@ int SpeakerProtection::spkrStartCalibration()
 
     connectCtrlNameBe<< backEndNameRx << " metadata";
 
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", backEndNameRx.c_str());
         ret = -EINVAL;
@@ -1512,7 +1512,7 @@ int SpeakerProtection::spkrStartCalibration()
     }
 
     connectCtrlNameRx << "PCM" << pcmDevIdsRx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameRx.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlNameRx.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlNameRx.str().data());
         ret = -ENOSYS;
@@ -1838,7 +1838,7 @@ int SpeakerProtection::getDeviceTemperatureList()
     for(i = 0; i < spDevInfo.numChannels; i++) {
         PAL_ERR(LOG_TAG, "audio_mixer %pK", hwMixer);
         mixer_ctl_name = temp_ctrls[i];
-        ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
+        ctl = ResourceManager::getMixerCtl(hwMixer, mixer_ctl_name.c_str());
         if(!ctl) {
             PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n",
                     mixer_ctl_name.c_str());
@@ -2494,7 +2494,7 @@ int32_t SpeakerProtection::spkrProtProcessingModeV2(bool flag)
             goto exit;
         }
         connectCtrlNameBeVI<< backEndName << " metadata";
-        beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer,
+        beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer,
                                     connectCtrlNameBeVI.str().data());
         if (!beMetaDataMixerCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndName.c_str());
@@ -2532,7 +2532,7 @@ int32_t SpeakerProtection::spkrProtProcessingModeV2(bool flag)
         }
 
         connectCtrlName << "PCM" << pcmDevIdTx.at(0) << " connect";
-        connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+        connectCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlName.str().data());
         if (!connectCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
             goto free_fe;
@@ -3155,7 +3155,7 @@ int SpeakerProtection::viTxSetupThreadLoop()
         }
 
         connectCtrlNameBeVI<< backEndName << " metadata";
-        beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer,
+        beMetaDataMixerCtrl = ResourceManager::getMixerCtl(virtMixer,
                                     connectCtrlNameBeVI.str().data());
         if (!beMetaDataMixerCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s",
@@ -3193,7 +3193,7 @@ int SpeakerProtection::viTxSetupThreadLoop()
         }
 
         connectCtrlName << "PCM" << pcmDevIdTx.at(0) << " connect";
-        connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+        connectCtrl = ResourceManager::getMixerCtl(virtMixer, connectCtrlName.str().data());
         if (!connectCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
             goto free_fe;
@@ -3866,7 +3866,7 @@ int32_t SpeakerProtection::getFTMParameter(void **param)
         goto exit;
     }
 
-    ctl = mixer_get_ctl_by_name(virtMixer, cntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(virtMixer, cntrlName.str().data());
     if (!ctl) {
         status = -ENOENT;
         PAL_ERR(LOG_TAG, "Error: %d Invalid mixer control: %s\n", status,cntrlName.str().data());
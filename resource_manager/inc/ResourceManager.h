@@ -75,6 +75,8 @@
 #include "PalCommon.h"
 #include <array>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <expat.h>
 #include <stdio.h>
 #include <queue>
@@ -291,6 +293,13 @@ struct pal_device_info {
      pal_audio_fmt_t bitFormatSupported;
 };
 
+/* getDeviceInfo result for one device and usecase, resolved at init */
+struct device_info_entry {
+    bool valid;
+    struct pal_device_info base;
+    std::unordered_map<std::string, struct pal_device_info> custom;
+};
+
 struct vsid_modepair {
     unsigned int key;
     unsigned int value;
@@ -419,6 +428,53 @@ struct deviceIn {
     pal_audio_fmt_t bitFormatSupported;
 };
 
+/*
+ * Caches mixer_ctl handles by (mixer, control name). tinyalsa resolves a
+ * name with a linear scan of every control on the card, and the virtual
+ * AGM card exposes several per FE/BE, so repeated graph setup lookups are
+ * served from here instead. Only successful lookups are cached; entries are
+ * dropped when the owning mixer is closed or the sound card goes offline.
+ */
+class MixerCtlCache
+{
+public:
+    struct mixer_ctl *get(struct mixer *am, const std::string &name);
+    void invalidate();
+    void getStats(uint64_t *hits, uint64_t *misses);
+private:
+    std::mutex mLock;
+    std::unordered_map<struct mixer *,
+        std::unordered_map<std::string, struct mixer_ctl *>> mCtls;
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+};
+
+/*
+ * Remembers the last value written to a mixer control and drops writes that
+ * would set the same value again, saving the ioctl into AGM. Only meant for
+ * controls that hold state (the FE "control" selector, BE media format and
+ * group attributes, the BT feedback channel); action controls such as
+ * connect, metadata or setParam must keep going to the driver. A failed
+ * write forgets the control so the next write always goes through.
+ */
+class MixerShadow
+{
+public:
+    int setEnum(struct mixer_ctl *ctl, const char *str);
+    int setValue(struct mixer_ctl *ctl, unsigned int id, int value);
+    int setArray(struct mixer_ctl *ctl, const void *array, size_t count);
+    void invalidate();
+    void getStats(uint64_t *issued, uint64_t *skipped);
+private:
+    static size_t elemSize(struct mixer_ctl *ctl);
+    bool isUnchanged(struct mixer_ctl *ctl, const std::string &val);
+    void update(struct mixer_ctl *ctl, const std::string &val, int ret);
+    std::mutex mLock;
+    std::unordered_map<struct mixer_ctl *, std::string> mValues;
+    uint64_t mIssued = 0;
+    uint64_t mSkipped = 0;
+};
+
 class ResourceManager
 {
 
@@ -446,6 +502,13 @@ private:
     int32_t streamDevConnect(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
     int32_t streamDevDisconnect_l(std::vector <std::tuple<Stream *, uint32_t>> streamDevDisconnectList);
     int32_t streamDevConnect_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
+    bool isPerStreamDevSwitchAllowed(const std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+                                     const std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList);
+    static bool isPerStreamDevSwitchPair(pal_device_id_t from, pal_device_id_t to);
+    int32_t streamDevSwitchPerStream_l(const std::vector <Stream *> &streams,
+                                       const std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+                                       const std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList,
+                                       int64_t *maxGapUs);
     void ssrHandlingLoop(std::shared_ptr<ResourceManager> rm);
     int updateECDeviceMap(std::shared_ptr<Device> rx_dev,
                         std::shared_ptr<Device> tx_dev,
@@ -481,7 +544,10 @@ protected:
     std::vector <std::pair<std::shared_ptr<Device>, Stream*>> active_devices;
     std::vector <std::shared_ptr<Device>> plugin_devices_;
     std::vector <pal_device_id_t> avail_devices_;
-    std::map<Stream*, std::pair<uint32_t, bool>> mActiveStreamUserCounter;
+    /* hashed mirrors of mActiveStreams for O(1) handle validation on the
+     * data path, both protected by mValidStreamMutex */
+    std::unordered_set<const Stream*> mValidStreamHandles;
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>> mActiveStreamUserCounter;
     bool bOverwriteFlag;
     bool screen_state_ = true;
     bool charging_state_;
@@ -490,6 +556,13 @@ protected:
     bool use_lpi_;
     pal_speaker_rotation_type rotation_type_;
     bool isDeviceSwitch = false;
+    /* longest stream gap (own disconnect to own connect) of a device switch */
+    int64_t lastDevSwitchGapUs = 0;
+    int64_t maxDevSwitchGapUs = 0;
+    uint32_t lastDevSwitchStreams = 0;
+    uint32_t devSwitchCount = 0;
+    int32_t lastDevSwitchStatus = 0;
+    bool lastDevSwitchPerStream = false;
     static std::mutex mResourceManagerMutex;
     static std::mutex mGraphMutex;
     static std::mutex mActiveStreamMutex;
@@ -503,6 +576,8 @@ protected:
     static struct audio_route* audio_route;
     static struct audio_mixer* audio_virt_mixer;
     static struct audio_mixer* audio_hw_mixer;
+    static MixerCtlCache mixerCtlCache;
+    static MixerShadow mixerShadow;
     static std::vector <int> streamTag;
     static std::vector <int> streamPpTag;
     static std::vector <int> mixerTag;
@@ -537,7 +612,11 @@ protected:
     static std::map<uint32_t, uint32_t> btSlimClockSrcMap;
     static std::map<std::string, int> handsetPosTable;
     static std::map<pal_device_id_t, std::vector<std::string>> deviceTempCtrlsMap;
+    /* device pairs that may be switched one stream at a time, either way */
+    static std::vector<std::pair<pal_device_id_t, pal_device_id_t>> perStreamDevSwitchPairs;
     static std::vector<deviceIn> deviceInfo;
+    /* indexed by device id * PAL_STREAM_MAX + stream type */
+    static std::vector<device_info_entry> deviceInfoTable;
     static std::vector<tx_ecinfo> txEcInfo;
     static struct vsid_info vsidInfo;
     static struct volume_set_param_info volumeSetParamInfo_;
@@ -648,6 +727,9 @@ public:
     /*getDeviceInfo - updates channels, fluence info of the device*/
     void getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t type,
                        std::string key, struct pal_device_info *devinfo);
+    void scanDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t type,
+                        const std::string *key, struct pal_device_info *devinfo);
+    void buildDeviceInfoTable();
     bool getEcRefStatus(pal_stream_type_t tx_streamtype,pal_stream_type_t rx_streamtype);
     int32_t getVsidInfo(struct vsid_info  *info);
     int32_t getVolumeSetParamInfo(struct volume_set_param_info *volinfo);
@@ -665,6 +747,9 @@ public:
     int decreaseStreamUserCounter(Stream* s);
     int getStreamUserCounter(Stream *s);
     int printStreamUserCounter(Stream *s);
+    /* test only: placeholder handles, compared but never dereferenced */
+    void addPlaceholderStreamHandle(const Stream *s);
+    void removePlaceholderStreamHandle(const Stream *s);
     int registerDevice(std::shared_ptr<Device> d, Stream *s);
     int deregisterDevice(std::shared_ptr<Device> d, Stream *s);
     int registerDevice_l(std::shared_ptr<Device> d, Stream *s);
@@ -726,6 +811,12 @@ public:
     int getAudioRoute(struct audio_route** ar);
     int getVirtualAudioMixer(struct audio_mixer **am);
     int getHwAudioMixer(struct audio_mixer **am);
+    static struct mixer_ctl *getMixerCtl(struct audio_mixer *am, const std::string &name);
+    static void invalidateMixerCtlCache();
+    static int setMixerCtlEnum(struct mixer_ctl *ctl, const char *str);
+    static int setMixerCtlValue(struct mixer_ctl *ctl, unsigned int id, int value);
+    static int setMixerCtlArray(struct mixer_ctl *ctl, const void *array, size_t count);
+    static void getMixerShadowStats(uint64_t *issued, uint64_t *skipped);
     int getActiveStream(std::vector<Stream*> &activestreams, std::shared_ptr<Device> d = nullptr);
     int getActiveStream_l(std::vector<Stream*> &activestreams,std::shared_ptr<Device> d = nullptr);
     int getOrphanStream(std::vector<Stream*> &orphanstreams, std::vector<Stream*> &retrystreams);
@@ -833,6 +924,7 @@ public:
     static void processCardInfo(struct xml_userdata *data, const XML_Char *tag_name);
     static void processSpkrTempCtrls(const XML_Char **attr);
     static void processDeviceTempCtrls(const XML_Char **attr, const int attr_count);
+    static void processPerStreamDevSwitch(const XML_Char **attr);
     static void processBTCodecInfo(const XML_Char **attr, const int attr_count);
     static void startTag(void *userdata __unused, const XML_Char *tag_name, const XML_Char **attr);
     static void snd_data_handler(void *userdata, const XML_Char *s, int len);
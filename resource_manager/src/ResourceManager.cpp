@@ -77,6 +77,8 @@
 #include "gsl_intf.h"
 #include "Headphone.h"
 #include "PayloadBuilder.h"
+#include "SessionAlsaUtils.h"
+#include "SessionAlsaCompress.h"
 #include "Bluetooth.h"
 #include "SpeakerMic.h"
 #include "Speaker.h"
@@ -94,6 +96,8 @@
 #include <dlfcn.h>
 #include <mutex>
 #include <sys/ioctl.h>
+#include <chrono>
+#include <future>
 #ifdef EC_REF_CAPTURE_ENABLED
 #include "ECRefDevice.h"
 #endif
@@ -434,6 +438,8 @@ std::vector <int> ResourceManager::listAllNonTunnelSessionIds = {0};
 std::vector <int> ResourceManager::listAllPcmContextProxyFrontEnds = {0};
 struct audio_mixer* ResourceManager::audio_virt_mixer = NULL;
 struct audio_mixer* ResourceManager::audio_hw_mixer = NULL;
+MixerCtlCache ResourceManager::mixerCtlCache;
+MixerShadow ResourceManager::mixerShadow;
 struct audio_route* ResourceManager::audio_route = NULL;
 int ResourceManager::snd_virt_card = SND_CARD_VIRTUAL;
 int ResourceManager::snd_hw_card = SND_CARD_HW;
@@ -500,6 +506,7 @@ void str_parms_destroy(struct str_parms *str_parms){return;}
 
 std::vector<uint32_t> ResourceManager::lpi_vote_streams_;
 std::vector<deviceIn> ResourceManager::deviceInfo;
+std::vector<device_info_entry> ResourceManager::deviceInfoTable;
 std::vector<tx_ecinfo> ResourceManager::txEcInfo;
 struct vsid_info ResourceManager::vsidInfo;
 struct volume_set_param_info ResourceManager::volumeSetParamInfo_;
@@ -509,6 +516,7 @@ std::map<std::pair<uint32_t, std::string>, std::string> ResourceManager::btCodec
 std::map<int, std::string> ResourceManager::spkrTempCtrlsMap;
 std::map<uint32_t, uint32_t> ResourceManager::btSlimClockSrcMap;
 std::map<pal_device_id_t, std::vector<std::string>> ResourceManager::deviceTempCtrlsMap;
+std::vector<std::pair<pal_device_id_t, pal_device_id_t>> ResourceManager::perStreamDevSwitchPairs;
 
 std::shared_ptr<group_dev_config_t> ResourceManager::activeGroupDevConfig = nullptr;
 std::shared_ptr<group_dev_config_t> ResourceManager::currentGroupDevConfig = nullptr;
@@ -681,9 +689,44 @@ void ResourceManager::sendCrashSignal(int signal, pid_t pid, uid_t uid)
     agm_dump(&dump_info);
 }
 
+static void logInitStage(const char *stage,
+    std::chrono::steady_clock::time_point &start)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    PAL_INFO(LOG_TAG, "init stage %s took %lld ms", stage,
+        (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - start).count());
+    start = now;
+}
+
 ResourceManager::ResourceManager()
 {
     int ret = 0;
+    auto initStart = std::chrono::steady_clock::now();
+    auto stageStart = initStart;
+    /*
+     * usecaseKvManager parsing and the ADM library load depend on nothing
+     * set up below, so they run alongside sound card probing and the
+     * resource xml parse. The futures join on destruction, which also
+     * covers the error paths that throw.
+     */
+    std::future<int> usecaseKvInit = std::async(std::launch::async,
+        []() {
+            auto start = std::chrono::steady_clock::now();
+            int status = PayloadBuilder::init();
+
+            logInitStage("usecase kv xml", start);
+            return status;
+        });
+    std::future<void> admInit = std::async(std::launch::async,
+        [this]() {
+            auto start = std::chrono::steady_clock::now();
+
+            loadAdmLib();
+            logInitStage("adm lib", start);
+        });
+
     // Init audio_route and audio_mixer
     sleepmon_fd_ = -1;
     na_props.rm_na_prop_enabled = false;
@@ -705,12 +748,14 @@ ResourceManager::ResourceManager()
         PAL_ERR(LOG_TAG, "error in snd xml parsing ret %d", ret);
         throw std::runtime_error("error in snd xml parsing");
     }
+    logInitStage("snd xml", stageStart);
 
     ret = ResourceManager::init_audio();
     if (ret) {
         PAL_ERR(LOG_TAG, "error in init audio route and audio mixer ret %d", ret);
         throw std::runtime_error("error in init audio route and audio mixer");
     }
+    logInitStage("audio route", stageStart);
 
     ret = ResourceManager::XmlParser(rmngr_xml_file);
     if (ret) {
@@ -718,6 +763,9 @@ ResourceManager::ResourceManager()
         throw std::runtime_error("error in resource xml parsing");
     }
 
+    buildDeviceInfoTable();
+    logInitStage("resource xml", stageStart);
+
     if (isHifiFilterEnabled)
         audio_route_apply_and_update_path(audio_route, "hifi-filter-coefficients");
 
@@ -826,14 +874,15 @@ ResourceManager::ResourceManager()
     mNTStreamInstancesList[NT_PATH_ENCODE] = encodeMap;
     mNTStreamInstancesList[NT_PATH_DECODE] = decodeMap;
 
-    ResourceManager::loadAdmLib();
     ResourceManager::initWakeLocks();
-    ret = PayloadBuilder::init();
+    admInit.wait();
+    ret = usecaseKvInit.get();
     if (ret) {
         throw std::runtime_error("Failed to parse usecase manager xml");
     } else {
         PAL_INFO(LOG_TAG, "usecase manager xml parsing successful");
     }
+    logInitStage("frontends and parallel stages", stageStart);
 
     PAL_DBG(LOG_TAG, "Creating ContextManager");
     ctxMgr = new ContextManager();
@@ -846,6 +895,7 @@ ResourceManager::ResourceManager()
     use_lpi_ = IsLPISupported(PAL_STREAM_VOICE_UI) ||
         IsLPISupported(PAL_STREAM_ACD) ||
         IsLPISupported(PAL_STREAM_SENSOR_PCM_DATA);
+    logInitStage("resource manager total", initStart);
 }
 
 ResourceManager::~ResourceManager()
@@ -872,6 +922,7 @@ ResourceManager::~ResourceManager()
     listAllPcmExtEcTxFrontEnds.clear();
     devInfo.clear();
     deviceInfo.clear();
+    deviceInfoTable.clear();
     txEcInfo.clear();
 
     STInstancesLists.clear();
@@ -1038,6 +1089,9 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
             mActiveStreamMutex.lock();
             rm->cardState = state;
             if (state != prevState) {
+                /* controls may be re-enumerated when the card comes back */
+                invalidateMixerCtlCache();
+                SessionAlsaUtils::invalidateAgmMetaDataCache();
                 if (rm->globalCb) {
                     PAL_DBG(LOG_TAG, "Notifying client about sound card state %d global cb %pK",
                                       rm->cardState, rm->globalCb);
@@ -1636,6 +1690,65 @@ bool ResourceManager::getEcRefStatus(pal_stream_type_t tx_streamtype,pal_stream_
 }
 
 void ResourceManager::getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t type, std::string key, struct pal_device_info *devinfo)
+{
+    if (deviceInfoTable.empty() || (int)deviceId < 0 || deviceId >= PAL_DEVICE_IN_MAX ||
+        (int)type < 0 || type >= PAL_STREAM_MAX) {
+        scanDeviceInfo(deviceId, type, &key, devinfo);
+        return;
+    }
+
+    const device_info_entry &entry = deviceInfoTable[deviceId * PAL_STREAM_MAX + type];
+    if (!entry.valid)
+        return;
+
+    auto it = entry.custom.find(key);
+    *devinfo = (it != entry.custom.end()) ? it->second : entry.base;
+}
+
+/*
+ * Flattens deviceInfo into deviceInfoTable so getDeviceInfo is a table
+ * lookup. Every (device, usecase) pair gets the result without custom
+ * config plus one result per custom config key defined for that usecase;
+ * any other key resolves to the result without custom config, as the scan
+ * would.
+ */
+void ResourceManager::buildDeviceInfoTable()
+{
+    deviceInfoTable.clear();
+    deviceInfoTable.resize(PAL_DEVICE_IN_MAX * PAL_STREAM_MAX);
+
+    for (int32_t i = 0; i < deviceInfo.size(); i++) {
+        pal_device_id_t deviceId = (pal_device_id_t)deviceInfo[i].deviceId;
+
+        if ((int)deviceId < 0 || deviceId >= PAL_DEVICE_IN_MAX)
+            continue;
+        for (int32_t type = 0; type < PAL_STREAM_MAX; type++) {
+            device_info_entry &entry = deviceInfoTable[deviceId * PAL_STREAM_MAX + type];
+
+            if (!entry.valid) {
+                scanDeviceInfo(deviceId, (pal_stream_type_t)type, nullptr, &entry.base);
+                entry.valid = true;
+            }
+            for (int32_t j = 0; j < deviceInfo[i].usecase.size(); j++) {
+                if (type != deviceInfo[i].usecase[j].type)
+                    continue;
+                for (int32_t k = 0; k < deviceInfo[i].usecase[j].config.size(); k++) {
+                    const std::string &key = deviceInfo[i].usecase[j].config[k].key;
+
+                    if (entry.custom.count(key))
+                        continue;
+                    scanDeviceInfo(deviceId, (pal_stream_type_t)type, &key,
+                                   &entry.custom[key]);
+                }
+            }
+        }
+    }
+    PAL_DBG(LOG_TAG, "device info table built from %zu device entries", deviceInfo.size());
+}
+
+/* key == nullptr resolves device and usecase config without custom config */
+void ResourceManager::scanDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t type,
+    const std::string *key, struct pal_device_info *devinfo)
 {
     bool found = false;
 
@@ -1696,15 +1809,15 @@ void ResourceManager::getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t
                                 deviceNameLUT.at(deviceId).c_str());
                     }
                     /*parse custom config if there*/
-                    for (int32_t k = 0; k < deviceInfo[i].usecase[j].config.size(); k++) {
-                        if (!deviceInfo[i].usecase[j].config[k].key.compare(key)) {
+                    for (int32_t k = 0; key && k < deviceInfo[i].usecase[j].config.size(); k++) {
+                        if (!deviceInfo[i].usecase[j].config[k].key.compare(*key)) {
                             /*overwrite the channels if needed*/
                             if (deviceInfo[i].usecase[j].config[k].channel) {
                                 devinfo->channels = deviceInfo[i].usecase[j].config[k].channel;
                                 devinfo->channels_overwrite = true;
                                 PAL_VERBOSE(LOG_TAG, "got overwritten channels %d for custom key %s usecase %d for dev %s",
                                         devinfo->channels,
-                                        key.c_str(),
+                                        key->c_str(),
                                         type,
                                         deviceNameLUT.at(deviceId).c_str());
                             }
@@ -1713,7 +1826,7 @@ void ResourceManager::getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t
                                 devinfo->samplerate_overwrite = true;
                                 PAL_VERBOSE(LOG_TAG, "got overwritten samplerate %d for custom key %s usecase %d for dev %s",
                                         devinfo->samplerate,
-                                        key.c_str(),
+                                        key->c_str(),
                                         type,
                                         deviceNameLUT.at(deviceId).c_str());
                             }
@@ -1722,7 +1835,7 @@ void ResourceManager::getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t
                                 devinfo->sndDevName_overwrite = true;
                                 PAL_VERBOSE(LOG_TAG, "got overwitten snd dev %s for custom key %s usecase %d for dev %s",
                                         devinfo->sndDevName.c_str(),
-                                        key.c_str(),
+                                        key->c_str(),
                                         type,
                                         deviceNameLUT.at(deviceId).c_str());
                             }
@@ -1731,7 +1844,7 @@ void ResourceManager::getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t
                                 devinfo->priority = deviceInfo[i].usecase[j].config[k].priority;
                                 PAL_VERBOSE(LOG_TAG, "got priority %d for custom key %s usecase %d for dev %s",
                                         devinfo->priority,
-                                        key.c_str(),
+                                        key->c_str(),
                                         type,
                                         deviceNameLUT.at(deviceId).c_str());
                             }
@@ -1740,7 +1853,7 @@ void ResourceManager::getDeviceInfo(pal_device_id_t deviceId, pal_stream_type_t
                                 devinfo->bit_width_overwrite = true;
                                 PAL_VERBOSE(LOG_TAG, "got overwritten bit width %d for custom key %s usecase %d for dev %s",
                                         devinfo->bit_width,
-                                        key.c_str(),
+                                        key->c_str(),
                                         type,
                                         deviceNameLUT.at(deviceId).c_str());
                             }
@@ -2630,6 +2743,7 @@ int ResourceManager::registerStream(Stream *s)
             break;
     }
     mActiveStreams.push_back(s);
+    mValidStreamHandles.insert(s);
 
 #if 0
     s->getStreamAttributes(&incomingStreamAttr);
@@ -2807,6 +2921,7 @@ int ResourceManager::deregisterStream(Stream *s)
     }
 
     deregisterstream(s, mActiveStreams);
+    mValidStreamHandles.erase(s);
     mValidStreamMutex.unlock();
     mActiveStreamMutex.unlock();
 exit:
@@ -2831,12 +2946,30 @@ bool isStreamActive(T s, std::list<T> &streams)
 }
 
 int ResourceManager::isActiveStream(pal_stream_handle_t *handle) {
-    for (auto &s : mActiveStreams) {
-        if (handle == reinterpret_cast<uint64_t *>(s)) {
-            return true;
-        }
-    }
-    return false;
+    /* handle is only compared, never dereferenced, until it is found */
+    return mValidStreamHandles.find(reinterpret_cast<const Stream *>(handle)) !=
+           mValidStreamHandles.end();
+}
+
+/*
+ * Registers a handle the way registerStream and initStreamUserCounter do,
+ * with its user count at one so the counter never touches the stream
+ * semaphore. Only for host benches timing the handle validation.
+ */
+void ResourceManager::addPlaceholderStreamHandle(const Stream *s)
+{
+    lockValidStreamMutex();
+    mValidStreamHandles.insert(s);
+    mActiveStreamUserCounter[const_cast<Stream *>(s)] = std::make_pair(1, true);
+    unlockValidStreamMutex();
+}
+
+void ResourceManager::removePlaceholderStreamHandle(const Stream *s)
+{
+    lockValidStreamMutex();
+    mValidStreamHandles.erase(s);
+    mActiveStreamUserCounter.erase(const_cast<Stream *>(s));
+    unlockValidStreamMutex();
 }
 
 int ResourceManager::initStreamUserCounter(Stream *s)
@@ -2850,7 +2983,7 @@ int ResourceManager::initStreamUserCounter(Stream *s)
 
 int ResourceManager::deactivateStreamUserCounter(Stream *s)
 {
-    std::map<Stream*, std::pair<uint32_t, bool>>::iterator it;
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>>::iterator it;
     lockValidStreamMutex();
     printStreamUserCounter(s);
     it = mActiveStreamUserCounter.find(s);
@@ -2871,7 +3004,7 @@ int ResourceManager::deactivateStreamUserCounter(Stream *s)
 
 int ResourceManager::eraseStreamUserCounter(Stream *s)
 {
-    std::map<Stream*, std::pair<uint32_t, bool>>::iterator it;
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>>::iterator it;
     lockValidStreamMutex();
     it = mActiveStreamUserCounter.find(s);
     if (it != mActiveStreamUserCounter.end()) {
@@ -2888,7 +3021,7 @@ int ResourceManager::eraseStreamUserCounter(Stream *s)
 
 int ResourceManager::increaseStreamUserCounter(Stream* s)
 {
-    std::map<Stream*, std::pair<uint32_t, bool>>::iterator it;
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>>::iterator it;
     printStreamUserCounter(s);
     it = mActiveStreamUserCounter.find(s);
     if (it != mActiveStreamUserCounter.end() &&
@@ -2909,7 +3042,7 @@ int ResourceManager::increaseStreamUserCounter(Stream* s)
 
 int ResourceManager::decreaseStreamUserCounter(Stream* s)
 {
-    std::map<Stream*, std::pair<uint32_t, bool>>::iterator it;
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>>::iterator it;
     printStreamUserCounter(s);
     it = mActiveStreamUserCounter.find(s);
     if (it != mActiveStreamUserCounter.end()) {
@@ -2934,7 +3067,7 @@ int ResourceManager::decreaseStreamUserCounter(Stream* s)
 
 int ResourceManager::getStreamUserCounter(Stream *s)
 {
-    std::map<Stream*, std::pair<uint32_t, bool>>::iterator it;
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>>::iterator it;
     printStreamUserCounter(s);
     it = mActiveStreamUserCounter.find(s);
     if (it != mActiveStreamUserCounter.end()) {
@@ -2947,9 +3080,9 @@ int ResourceManager::getStreamUserCounter(Stream *s)
 
 int ResourceManager::printStreamUserCounter(Stream *s)
 {
-    std::map<Stream*, std::pair<uint32_t, bool>>::iterator it;
-    for (it = mActiveStreamUserCounter.begin();
-            it != mActiveStreamUserCounter.end(); it++) {
+    std::unordered_map<Stream*, std::pair<uint32_t, bool>>::iterator it;
+    it = mActiveStreamUserCounter.find(s);
+    if (it != mActiveStreamUserCounter.end()) {
         PAL_VERBOSE(LOG_TAG, "stream = %p count = %d active = %d",
                     it->first, it->second.first, it->second.second);
     }
@@ -3563,6 +3696,186 @@ int ResourceManager::getHwAudioMixer(struct audio_mixer ** am)
     return 0;
 }
 
+struct mixer_ctl *MixerCtlCache::get(struct mixer *am, const std::string &name)
+{
+    struct mixer_ctl *ctl = NULL;
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (!am)
+        return NULL;
+
+    auto &ctls = mCtls[am];
+    auto it = ctls.find(name);
+    if (it != ctls.end()) {
+        mHits++;
+        return it->second;
+    }
+
+    mMisses++;
+    ctl = mixer_get_ctl_by_name(am, name.c_str());
+    if (ctl)
+        ctls.emplace(name, ctl);
+    return ctl;
+}
+
+void MixerCtlCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    PAL_INFO(LOG_TAG, "mixer ctl cache hits %llu misses %llu",
+        (unsigned long long)mHits, (unsigned long long)mMisses);
+    mCtls.clear();
+}
+
+void MixerCtlCache::getStats(uint64_t *hits, uint64_t *misses)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (hits)
+        *hits = mHits;
+    if (misses)
+        *misses = mMisses;
+}
+
+struct mixer_ctl *ResourceManager::getMixerCtl(struct audio_mixer *am,
+    const std::string &name)
+{
+    return mixerCtlCache.get(am, name);
+}
+
+void ResourceManager::invalidateMixerCtlCache()
+{
+    mixerCtlCache.invalidate();
+    /* shadowed values are keyed by the ctl handles dropped above */
+    mixerShadow.invalidate();
+}
+
+bool MixerShadow::isUnchanged(struct mixer_ctl *ctl, const std::string &val)
+{
+    auto it = mValues.find(ctl);
+
+    if (it != mValues.end() && it->second == val) {
+        mSkipped++;
+        return true;
+    }
+    mIssued++;
+    return false;
+}
+
+void MixerShadow::update(struct mixer_ctl *ctl, const std::string &val, int ret)
+{
+    if (ret)
+        mValues.erase(ctl);
+    else
+        mValues[ctl] = val;
+}
+
+int MixerShadow::setEnum(struct mixer_ctl *ctl, const char *str)
+{
+    std::string val("E");
+    int ret = 0;
+
+    if (!ctl || !str)
+        return -EINVAL;
+
+    val.append(str);
+    std::lock_guard<std::mutex> lock(mLock);
+    if (isUnchanged(ctl, val))
+        return 0;
+    ret = mixer_ctl_set_enum_by_string(ctl, str);
+    update(ctl, val, ret);
+    return ret;
+}
+
+int MixerShadow::setValue(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    std::string val("V");
+    int ret = 0;
+
+    if (!ctl)
+        return -EINVAL;
+
+    val.append((const char *)&id, sizeof(id));
+    val.append((const char *)&value, sizeof(value));
+    std::lock_guard<std::mutex> lock(mLock);
+    if (isUnchanged(ctl, val))
+        return 0;
+    ret = mixer_ctl_set_value(ctl, id, value);
+    update(ctl, val, ret);
+    return ret;
+}
+
+/* bytes per element mixer_ctl_set_array reads for this control */
+size_t MixerShadow::elemSize(struct mixer_ctl *ctl)
+{
+    switch (mixer_ctl_get_type(ctl)) {
+        case MIXER_CTL_TYPE_BYTE:
+            return sizeof(uint8_t);
+        case MIXER_CTL_TYPE_ENUM:
+            return sizeof(unsigned int);
+        case MIXER_CTL_TYPE_INT64:
+            return sizeof(long long);
+        default:
+            return sizeof(long);
+    }
+}
+
+int MixerShadow::setArray(struct mixer_ctl *ctl, const void *array, size_t count)
+{
+    std::string val("A");
+    int ret = 0;
+
+    if (!ctl || !array)
+        return -EINVAL;
+
+    val.append((const char *)array, count * elemSize(ctl));
+    std::lock_guard<std::mutex> lock(mLock);
+    if (isUnchanged(ctl, val))
+        return 0;
+    ret = mixer_ctl_set_array(ctl, array, count);
+    update(ctl, val, ret);
+    return ret;
+}
+
+void MixerShadow::invalidate()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    PAL_INFO(LOG_TAG, "mixer writes issued %llu skipped %llu",
+        (unsigned long long)mIssued, (unsigned long long)mSkipped);
+    mValues.clear();
+}
+
+void MixerShadow::getStats(uint64_t *issued, uint64_t *skipped)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (issued)
+        *issued = mIssued;
+    if (skipped)
+        *skipped = mSkipped;
+}
+
+int ResourceManager::setMixerCtlEnum(struct mixer_ctl *ctl, const char *str)
+{
+    return mixerShadow.setEnum(ctl, str);
+}
+
+int ResourceManager::setMixerCtlValue(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    return mixerShadow.setValue(ctl, id, value);
+}
+
+int ResourceManager::setMixerCtlArray(struct mixer_ctl *ctl, const void *array, size_t count)
+{
+    return mixerShadow.setArray(ctl, array, count);
+}
+
+void ResourceManager::getMixerShadowStats(uint64_t *issued, uint64_t *skipped)
+{
+    mixerShadow.getStats(issued, skipped);
+}
+
 void ResourceManager::GetVoiceUIProperties(struct pal_st_properties *qstp)
 {
     std::shared_ptr<SoundTriggerPlatformInfo> st_info =
@@ -4202,7 +4515,7 @@ int ResourceManager::handleMixerEvent(struct mixer *mixer, char *mixer_str) {
     std::map<int, std::pair<session_callback, uint64_t>>::iterator it;
 
     PAL_DBG(LOG_TAG, "Enter");
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s", mixer_str);
         status = -EINVAL;
@@ -5706,6 +6019,8 @@ void ResourceManager::deinit()
     card_status_t state = CARD_STATUS_NONE;
 
     mixerClosed = true;
+    invalidateMixerCtlCache();
+    SessionAlsaUtils::invalidateAgmMetaDataCache();
     mixer_close(audio_virt_mixer);
     mixer_close(audio_hw_mixer);
     if (audio_route) {
@@ -6601,6 +6916,103 @@ int32_t ResourceManager::streamDevConnect_l(std::vector <std::tuple<Stream *, st
 }
 
 
+/*
+ * Streams can be switched one by one, each disconnecting and reconnecting
+ * before the next starts, only if no backend being connected is also being
+ * disconnected, and only if every old/new device pair is listed as a
+ * per_stream_dev_switch in the resource manager xml. Disjoint backends
+ * alone are not enough: the new device is enabled while the old one still
+ * plays, which some pairs cannot do (e.g. A2DP and SCO share the BT link,
+ * speaker and handset may share the WSA amplifiers). Otherwise the old
+ * backend must be fully released first.
+ */
+bool ResourceManager::isPerStreamDevSwitchAllowed(
+        const std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+        const std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList)
+{
+    std::vector <std::string> disconnectBackEnds;
+    std::string backEndName;
+
+    if (perStreamDevSwitchPairs.empty())
+        return false;
+
+    for (auto &entry : streamDevDisconnectList) {
+        if (getBackendName(std::get<1>(entry), backEndName) || backEndName.empty())
+            return false;
+        disconnectBackEnds.push_back(backEndName);
+    }
+
+    for (auto &entry : streamDevConnectList) {
+        if (!std::get<1>(entry) ||
+            getBackendName(std::get<1>(entry)->id, backEndName) || backEndName.empty())
+            return false;
+        if (std::find(disconnectBackEnds.begin(), disconnectBackEnds.end(),
+                      backEndName) != disconnectBackEnds.end())
+            return false;
+        for (auto &old : streamDevDisconnectList) {
+            if (!isPerStreamDevSwitchPair((pal_device_id_t)std::get<1>(old),
+                                          std::get<1>(entry)->id))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool ResourceManager::isPerStreamDevSwitchPair(pal_device_id_t from, pal_device_id_t to)
+{
+    for (auto &pair : perStreamDevSwitchPairs) {
+        if ((pair.first == from && pair.second == to) ||
+            (pair.first == to && pair.second == from))
+            return true;
+    }
+    return false;
+}
+
+int32_t ResourceManager::streamDevSwitchPerStream_l(const std::vector <Stream *> &streams,
+        const std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+        const std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList,
+        int64_t *maxGapUs)
+{
+    int32_t status = 0;
+    int32_t connectStatus = 0;
+    int64_t gapUs = 0;
+    std::vector <std::tuple<Stream *, uint32_t>> disconnectList;
+    std::vector <std::tuple<Stream *, struct pal_device *>> connectList;
+    std::chrono::steady_clock::time_point gapStart;
+
+    *maxGapUs = 0;
+    for (Stream *str : streams) {
+        disconnectList.clear();
+        connectList.clear();
+        for (auto &entry : streamDevDisconnectList) {
+            if (std::get<0>(entry) == str)
+                disconnectList.push_back(entry);
+        }
+        for (auto &entry : streamDevConnectList) {
+            if (std::get<0>(entry) == str)
+                connectList.push_back(entry);
+        }
+
+        gapStart = std::chrono::steady_clock::now();
+        status = streamDevDisconnect_l(disconnectList);
+        if (status) {
+            PAL_ERR(LOG_TAG, "disconnect failed for stream %pK", str);
+            return status;
+        }
+        status = streamDevConnect_l(connectList);
+        if (status) {
+            PAL_ERR(LOG_TAG, "connect failed for stream %pK", str);
+            connectStatus = status;
+        }
+        gapUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - gapStart).count();
+        PAL_DBG(LOG_TAG, "stream %pK silent for %lld us", str, (long long)gapUs);
+        if (gapUs > *maxGapUs)
+            *maxGapUs = gapUs;
+    }
+    return connectStatus;
+}
+
 template <class T>
 void SortAndUnique(std::vector<T> &streams)
 {
@@ -6622,6 +7034,9 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
     std::vector <Stream*> uniqueStreamsList;
     std::vector <struct pal_device *> uniqueDevConnectionList;
     pal_stream_attributes sAttr;
+    bool perStreamSwitch = false;
+    int64_t gapUs = 0;
+    std::chrono::steady_clock::time_point switchStart;
 
     PAL_INFO(LOG_TAG, "Enter");
 
@@ -6692,6 +7107,21 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
         }
     }
 
+    /*
+     * When allowed each stream is moved on its own, so a stream is silent
+     * only for its own disconnect/connect instead of for the whole batch of
+     * disconnects and connects.
+     */
+    perStreamSwitch = isPerStreamDevSwitchAllowed(streamDevDisconnectList, streamDevConnectList);
+    if (perStreamSwitch) {
+        status = streamDevSwitchPerStream_l(uniqueStreamsList, streamDevDisconnectList,
+                                            streamDevConnectList, &gapUs);
+        goto exit;
+    }
+
+    /* batched: the first stream disconnected is silent until the last connect */
+    switchStart = std::chrono::steady_clock::now();
+
     status = streamDevDisconnect_l(streamDevDisconnectList);
     if (status) {
         PAL_ERR(LOG_TAG, "disconnect failed");
@@ -6701,8 +7131,21 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
     if (status) {
         PAL_ERR(LOG_TAG, "Connect failed");
     }
+    gapUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - switchStart).count();
 
 exit:
+    devSwitchCount++;
+    lastDevSwitchStatus = status;
+    lastDevSwitchPerStream = perStreamSwitch;
+    lastDevSwitchGapUs = gapUs;
+    lastDevSwitchStreams = uniqueStreamsList.size();
+    if (gapUs > maxDevSwitchGapUs)
+        maxDevSwitchGapUs = gapUs;
+    PAL_INFO(LOG_TAG, "device switch of %zu streams (%s), longest stream gap %lld us",
+             uniqueStreamsList.size(), perStreamSwitch ? "per stream" : "batched",
+             (long long)gapUs);
+
     // unlock all stream mutexes
     for (sIter = uniqueStreamsList.begin(); sIter != uniqueStreamsList.end(); sIter++) {
         PAL_DBG(LOG_TAG, "uniqueStreamsList stream %pK unlock", (*sIter));
@@ -6950,7 +7393,7 @@ int32_t ResourceManager::forceDeviceSwitch(std::shared_ptr<Device> inDev,
     }
 
 done:
-    return 0;
+    return status;
 }
 
 int32_t ResourceManager::forceDeviceSwitch(std::shared_ptr<Device> inDev,
@@ -6992,7 +7435,7 @@ int32_t ResourceManager::forceDeviceSwitch(std::shared_ptr<Device> inDev,
         PAL_ERR(LOG_TAG, "forceDeviceSwitch failed %d", status);
     }
 
-    return 0;
+    return status;
 }
 
 const std::string ResourceManager::getPALDeviceName(const pal_device_id_t id) const
@@ -8111,6 +8554,60 @@ int ResourceManager::getParameter(uint32_t param_id, void **param_payload,
             **(bool **)param_payload = isHifiFilterEnabled;
         }
         break;
+        case PAL_PARAM_ID_MIXER_WRITE_STATS:
+        {
+            pal_param_mixer_write_stats_t *stats =
+                (pal_param_mixer_write_stats_t *)(*param_payload);
+
+            if (!stats) {
+                status = -EINVAL;
+                break;
+            }
+            getMixerShadowStats(&stats->issued, &stats->skipped);
+            *payload_size = sizeof(pal_param_mixer_write_stats_t);
+            PAL_INFO(LOG_TAG, "mixer writes issued %llu skipped %llu",
+                (unsigned long long)stats->issued,
+                (unsigned long long)stats->skipped);
+            break;
+        }
+        case PAL_PARAM_ID_DEVICE_SWITCH_STATS:
+        {
+            pal_param_device_switch_stats_t *stats =
+                (pal_param_device_switch_stats_t *)(*param_payload);
+
+            if (!stats) {
+                status = -EINVAL;
+                break;
+            }
+            mActiveStreamMutex.lock();
+            stats->last_streams = lastDevSwitchStreams;
+            stats->last_gap_us = lastDevSwitchGapUs;
+            stats->max_gap_us = maxDevSwitchGapUs;
+            stats->switches = devSwitchCount;
+            stats->last_status = lastDevSwitchStatus;
+            stats->last_per_stream = lastDevSwitchPerStream;
+            mActiveStreamMutex.unlock();
+            *payload_size = sizeof(pal_param_device_switch_stats_t);
+            break;
+        }
+        case PAL_PARAM_ID_COMPRESS_CALLBACK_LATENCY:
+        {
+            pal_param_compress_cb_latency_t *stats =
+                (pal_param_compress_cb_latency_t *)(*param_payload);
+
+            if (!stats) {
+                status = -EINVAL;
+                break;
+            }
+            SessionAlsaCompress::getCallbackLatency(&stats->count,
+                &stats->avg_us, &stats->max_us);
+            *payload_size = sizeof(pal_param_compress_cb_latency_t);
+            PAL_INFO(LOG_TAG, "compress callbacks %llu avg %llu us max %llu us",
+                (unsigned long long)stats->count,
+                (unsigned long long)stats->avg_us,
+                (unsigned long long)stats->max_us);
+            break;
+        }
         default:
             status = -EINVAL;
             PAL_ERR(LOG_TAG, "Unknown ParamID:%d", param_id);
@@ -8823,7 +9320,7 @@ int ResourceManager::setParameter(uint32_t param_id, void *param_payload,
                 (pal_param_haptics_intensity *)param_payload;
             PAL_DBG(LOG_TAG, "Haptics Intensity %d", hInt->intensity);
             char mixer_ctl_name[128] =  "Haptics Amplitude Step";
-            struct mixer_ctl *ctl = mixer_get_ctl_by_name(audio_hw_mixer, mixer_ctl_name);
+            struct mixer_ctl *ctl = getMixerCtl(audio_hw_mixer, mixer_ctl_name);
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Could not get ctl for mixer cmd - %s", mixer_ctl_name);
                 status = -EINVAL;
@@ -9846,6 +10343,31 @@ void ResourceManager::processDeviceTempCtrls(const XML_Char **attr, const int at
     deviceTempCtrlsMap[dev_id].push_back(std::string(attr[5]));
 }
 
+void ResourceManager::processPerStreamDevSwitch(const XML_Char **attr)
+{
+    pal_device_id_t from;
+    pal_device_id_t to;
+
+    if (!attr[0] || !attr[1] || !attr[2] || !attr[3] ||
+        (strcmp(attr[0], "from") != 0) ||
+        (strcmp(attr[2], "to") != 0)) {
+        PAL_ERR(LOG_TAG, "invalid attributes passed for per_stream_dev_switch");
+        return;
+    }
+
+    if ((deviceIdLUT.find(attr[1]) == deviceIdLUT.end()) ||
+        (deviceIdLUT.find(attr[3]) == deviceIdLUT.end())) {
+        PAL_ERR(LOG_TAG, "invalid device %s or %s for per_stream_dev_switch",
+                attr[1], attr[3]);
+        return;
+    }
+
+    from = deviceIdLUT.at(attr[1]);
+    to = deviceIdLUT.at(attr[3]);
+    if (!isPerStreamDevSwitchPair(from, to))
+        perStreamDevSwitchPairs.push_back(std::make_pair(from, to));
+}
+
 bool ResourceManager::isPluginDevice(pal_device_id_t id) {
     if (id == PAL_DEVICE_OUT_USB_DEVICE ||
         id == PAL_DEVICE_OUT_USB_HEADSET ||
@@ -10621,6 +11143,9 @@ void ResourceManager::startTag(void *userdata, const XML_Char *tag_name,
     } else if(strcmp(tag_name, "device_temp_ctrl") == 0) {
         processDeviceTempCtrls(attr, XML_GetSpecifiedAttributeCount(data->parser));
         return;
+    } else if(strcmp(tag_name, "per_stream_dev_switch") == 0) {
+        processPerStreamDevSwitch(attr);
+        return;
     }
 
     if (data->card_parsed)
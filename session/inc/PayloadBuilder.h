@@ -42,6 +42,7 @@
 #include <algorithm>
 #include <expat.h>
 #include <map>
+#include <unordered_map>
 #include <regex>
 #include <sstream>
 #include "Stream.h"
@@ -146,6 +147,10 @@ struct kvInfo {
 struct allKVs {
     std::vector<int> id_type;
     std::vector<kvInfo> keys_values;
+    /* canonical selector key -> first keys_values index with exactly those selectors */
+    std::unordered_map<std::string, uint32_t> exact_selector_idx;
+    /* per keys_values index, the most selector pairs of any entry before it */
+    std::vector<uint32_t> max_pairs_before;
 };
 
 typedef enum {
@@ -174,6 +179,34 @@ struct user_xml_data{
 };
 class SessionGsl;
 
+/*
+ * Fixed-capacity scratch storage for one small control payload (volume,
+ * mute, runtime params). Meant to live on the caller's stack so steady
+ * state control operations build their payload without touching the heap.
+ * Larger payloads fall back to calloc; release() frees only those.
+ */
+class PayloadWriter
+{
+public:
+    static const size_t CAPACITY = 256;
+
+    uint8_t *alloc(size_t size)
+    {
+        if (size <= CAPACITY) {
+            memset(buf_, 0, size);
+            return buf_;
+        }
+        return (uint8_t *)calloc(1, size);
+    }
+    void release(uint8_t *payload)
+    {
+        if (payload && payload != buf_)
+            free(payload);
+    }
+private:
+    alignas(8) uint8_t buf_[CAPACITY];
+};
+
 class PayloadBuilder
 {
 protected:
@@ -194,10 +227,17 @@ public:
                            struct sessionToPayloadParam* data);
     void payloadVolumeConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
-                           struct pal_volume_data * data);
+                           struct pal_volume_data * data,
+                           PayloadWriter *writer = nullptr);
     void payloadMultichVolumemConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
-                           struct pal_volume_data * data);
+                           struct pal_volume_data * data,
+                           PayloadWriter *writer = nullptr);
+    void payloadVolumeRampConfig(uint8_t** payload, size_t* size,
+                           uint32_t miid,
+                           struct pal_volume_ramp_info *ramp,
+                           uint8_t *gainPayload, size_t gainSize,
+                           PayloadWriter *writer = nullptr);
     int payloadCustomParam(uint8_t **alsaPayload, size_t *size,
                             uint32_t *customayload, uint32_t customPayloadSize,
                             uint32_t moduleInstanceId, uint32_t dspParamId);
@@ -264,6 +304,12 @@ public:
     int populateTagKeyVector(Stream *s, std::vector <std::pair<int,int>> &tkv, int tag, uint32_t* gsltag);
     void payloadTimestamp(std::shared_ptr<std::vector<uint8_t>>& module_payload, size_t *size, uint32_t moduleId);
     static int init();
+    static int initKVTables(const char *xmlFile, const char *snapshotFile);
+    static int readKVXml(const char *xmlFile, std::vector<char> &xml, uint64_t *xmlHash);
+    static int parseKVXml(const std::vector<char> &xml);
+    static int loadKVSnapshot(const char *snapshotFile, uint64_t xmlHash);
+    static int saveKVSnapshot(const char *snapshotFile, uint64_t xmlHash);
+    static void serializeKVTables(std::vector<uint8_t> &out);
     static void endTag(void *userdata, const XML_Char *tag_name);
     static void startTag(void *userdata, const XML_Char *tag_name, const XML_Char **attr);
     static void handleData(void *userdata, const char *s, int len);
@@ -291,6 +337,9 @@ public:
         uint32_t codecFormat, bool isAbrEnabled, bool isHostless);
     static int getDeviceKV(int dev_id, std::vector<std::pair<int, int>> &deviceKV);
     static bool compareNumSelectors(struct kvInfo info_1, struct kvInfo info_2);
+    static std::string getSelectorKey(
+        const std::vector<std::pair<selector_type_t, std::string>> &selector_pairs);
+    static void buildSelectorIndex(struct allKVs &kvs);
     static int payloadDualMono(uint8_t **payloadInfo);
     PayloadBuilder();
     ~PayloadBuilder();
@@ -37,6 +37,8 @@
 #include "PayloadBuilder.h"
 #include "PalDefs.h"
 #include <mutex>
+#include <map>
+#include <tuple>
 #include <algorithm>
 #include <vector>
 #include <string.h>
@@ -92,6 +94,15 @@ protected:
     uint32_t eventId;
     void *eventPayload;
     size_t eventPayloadSize;
+    /*
+     * MIIDs resolved for this session's graph, keyed by (pcm device,
+     * backend, tag). Used by runtime parameter paths only; graph setup
+     * queries AGM directly and every graph change invalidates the cache.
+     */
+    std::mutex miidCacheMutex;
+    std::map<std::tuple<int, std::string, int>, uint32_t> miidCache;
+    int getCachedMIID(struct mixer *mixer, int device, const char *intf_name,
+                      int tag_id, uint32_t *miid);
     bool RegisterForEvents = false;
     Stream *streamHandle;
     static struct pcm *pcmEcTx;
@@ -103,6 +114,8 @@ public:
     bool isMixerEventCbRegd;
     bool isPauseRegistrationDone;
     virtual ~Session();
+    /* drops the cached MIIDs, the next runtime param lookup asks AGM again */
+    void invalidateMIIDCache();
     static Session* makeSession(const std::shared_ptr<ResourceManager>& rm, const struct pal_stream_attributes *sAttr);
     static Session* makeACDBSession(const std::shared_ptr<ResourceManager>& rm, const struct pal_stream_attributes *sAttr);
     int handleDeviceRotation(Stream *s, pal_speaker_rotation_type rotation_type,
@@ -138,6 +151,13 @@ public:
     virtual int registerCallBack(session_callback cb __unused, uint64_t cookie __unused) {return 0;};
     virtual int drain(pal_drain_type_t type __unused) {return 0;};
     virtual int flush() {return 0;};
+    /* makes a read/write blocked in the driver return, ahead of stop */
+    virtual void wakeDataPath(Stream *s __unused) {};
+    /*
+     * stops readiness callbacks until the next start, called without the
+     * stream lock held as it waits for a callback already running
+     */
+    virtual void cancelIoReady(Stream *s __unused) {};
     virtual void setEventPayload(uint32_t event_id __unused, void *payload __unused, size_t payload_size __unused) {  };
     virtual int getTimestamp(struct pal_session_time *stime __unused) {return 0;};
     /*TODO need to implement connect/disconnect in basecase*/
@@ -42,6 +42,8 @@
 #include "PalCommon.h"
 #include <tinyalsa/asoundlib.h>
 #include <condition_variable>
+#include <chrono>
+#include <atomic>
 #include <sound/compress_params.h>
 #include <tinycompress/tinycompress.h>
 
@@ -51,7 +53,6 @@ class Stream;
 class Session;
 
 enum {
-    OFFLOAD_CMD_EXIT,               /* exit compress offload thread loop*/
     OFFLOAD_CMD_DRAIN,              /* send a full drain request to DSP */
     OFFLOAD_CMD_PARTIAL_DRAIN,      /* send a partial drain request to DSP */
     OFFLOAD_CMD_WAIT_FOR_BUFFER,    /* wait for buffer released by DSP */
@@ -76,12 +77,6 @@ enum {
 #define PAL_SND_PROFILE_WMA10_LOSSLESS SND_AUDIOMODE_WMAPRO_LEVELM2
 #endif
 
-struct offload_msg {
-    offload_msg(int c)
-        :cmd(c) {}
-    int cmd; /**< command */
-};
-
 class SessionAlsaCompress : public Session
 {
 private:
@@ -92,13 +87,19 @@ private:
     struct snd_codec codec;
     //  unsigned int compressDevId;
     std::vector<int> compressDevIds;
-    std::unique_ptr<std::thread> worker_thread;
-    std::queue<std::shared_ptr<offload_msg>> msg_queue_;
     size_t compress_cap_buf_size;
     std::vector<std::pair<std::string, int>> freeDeviceMetadata;
 
-    std::condition_variable cv_; /* used to wait for incoming requests */
-    std::mutex cv_mutex_; /* mutex used in conjunction with above cv */
+    /* offload commands run in order on the shared PalTaskPool */
+    bool isDrainCalled = false;
+    int offloadRet = 0;
+    std::atomic<bool> offloadClosing{false};  /* close() is draining the commands */
+    static std::mutex cbLatencyMutex;
+    static uint64_t cbLatencyCount;
+    static uint64_t cbLatencyTotalUs;
+    static uint64_t cbLatencyMaxUs;
+    void postOffloadCmd(int cmd);
+    void handleOffloadCmd(int cmd, std::chrono::steady_clock::time_point postTime);
     void getSndCodecParam(struct snd_codec &codec, struct pal_stream_attributes &sAttr);
     int getSndCodecId(pal_audio_fmt_t fmt);
     int setCustomFormatParam(pal_audio_fmt_t audio_fmt);
@@ -115,6 +116,7 @@ private:
     std::vector <std::pair<int, int>> tkv;
     bool isGaplessFmt = false;
     bool sendNextTrackParams = false;
+    bool volumeRampSet = false;  /* a non zero gain ramp is programmed */
     bool isGaplessFormat(pal_audio_fmt_t fmt);
     bool isCodecConfigNeeded(pal_audio_fmt_t audio_fmt, pal_stream_direction_t stream_direction);
     int configureEarlyEOSDelay(void);
@@ -142,7 +144,8 @@ public:
     int read(Stream *s, int tag, struct pal_buffer *buf, int * size) override;
     int write(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag) override;
     int setECRef(Stream *s, std::shared_ptr<Device> rx_dev, bool is_enable) override;
-    static void offloadThreadLoop(SessionAlsaCompress *ob);
+    /* driver ready to client callback return, over all compress sessions */
+    static void getCallbackLatency(uint64_t *count, uint64_t *avgUs, uint64_t *maxUs);
     int registerCallBack(session_callback cb, uint64_t cookie);
     int drain(pal_drain_type_t type);
     int flush();
@@ -71,6 +71,12 @@ private:
     uint32_t svaMiid;
     static std::mutex pcmLpmRefCntMtx;
     static int pcmLpmRefCnt;
+    bool isNonBlocking = false;
+    std::mutex ioArmLock;
+    bool ioArmBlocked = false;  /* cancelIoReady ran, no arming until start */
+    bool pcmWoken = false;      /* wakeDataPath already stopped the pcm */
+    bool volumeRampSet = false;  /* a non zero gain ramp is programmed */
+    void armIoReady(short events, uint32_t eventId);
 public:
 
     SessionAlsaPcm(std::shared_ptr<ResourceManager> Rm);
@@ -90,6 +96,8 @@ public:
     int read(Stream *s, int tag, struct pal_buffer *buf, int * size) override;
     int write(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag) override;
     int setParameters(Stream *s, int tagId, uint32_t param_id, void *payload) override;
+    void wakeDataPath(Stream *s) override;
+    void cancelIoReady(Stream *s) override;
     int getParameters(Stream *s, int tagId, uint32_t param_id, void **payload) override;
     int setECRef(Stream *s, std::shared_ptr<Device> rx_dev, bool is_enable) override;
     int getTimestamp(struct pal_session_time *stime) override;
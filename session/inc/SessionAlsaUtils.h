@@ -40,6 +40,10 @@
 
 #include <tinyalsa/asoundlib.h>
 #include <sound/asound.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 
 class Stream;
@@ -78,10 +82,21 @@ enum BeCtrlsIndex {
 };
 
 
+/* packed agm metadata, shared read-only between the cache and its users */
+typedef std::shared_ptr<const std::vector<uint8_t>> AgmMetaDataBlob;
+
 class SessionAlsaUtils
 {
 private:
     SessionAlsaUtils() {};
+    static std::mutex mdCacheMutex;
+    static std::list<std::pair<std::string, AgmMetaDataBlob>> mdCacheLru;
+    static std::unordered_map<std::string,
+        std::list<std::pair<std::string, AgmMetaDataBlob>>::iterator> mdCacheIndex;
+    static bool getAgmMetaDataKey(Stream *s, struct pal_stream_attributes &sAttr,
+        std::vector<std::shared_ptr<Device>> &associatedDevices, std::string &key);
+    static AgmMetaDataBlob lookupAgmMetaData(const std::string &key);
+    static void storeAgmMetaData(const std::string &key, AgmMetaDataBlob blob);
     static struct mixer_ctl *getFeMixerControl(struct mixer *am, std::string feName,
         uint32_t idx);
     static struct mixer_ctl *getBeMixerControl(struct mixer *am, std::string beName,
@@ -160,6 +175,10 @@ public:
                         const std::vector <std::pair<int, int>> &ckv,
                         struct prop_data *propData,
                         struct agmMetaData &md);
+    static AgmMetaDataBlob makeAgmMetaData(const std::vector <std::pair<int, int>> &kv,
+                        const std::vector <std::pair<int, int>> &ckv,
+                        struct prop_data *propData);
+    static void invalidateAgmMetaDataCache();
     static int rwParameterACDB(Stream * streamHandle, struct mixer *mixer,
                         void *inParamPayload, size_t inPayloadSize,
                         pal_device_id_t palDeviceId, uint32_t sampleRate,
@@ -66,6 +66,7 @@
 #define PARAM_ID_SOFT_PAUSE_RESUME 0x0800102F
 #define PARAM_ID_VOL_CTRL_MULTICHANNEL_GAIN 0x08001038
 #define PARAM_ID_VOL_CTRL_MASTER_GAIN 0x08001035
+#define PARAM_ID_VOL_CTRL_GAIN_RAMP_PARAMETERS 0x08001037
 #define PLAYBACK_VOLUME_MASTER_GAIN_DEFAULT 0x2000
 #define PARAM_ID_FFV_DOA_TRACKING_MONITOR 0x080010A4
 
@@ -116,6 +117,13 @@ struct __attribute__((__packed__)) volume_ctrl_multichannel_gain_t
     volume_ctrl_channels_gain_config_t gain_data[0];
 };
 
+struct __attribute__((__packed__)) volume_ctrl_gain_ramp_params_t
+{
+    uint32_t period_ms;
+    uint32_t step_us;
+    uint32_t ramping_curve;
+};
+
 class Stream;
 class Session;
 
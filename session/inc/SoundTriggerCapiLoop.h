@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SOUNDTRIGGERCAPILOOP_H
+#define SOUNDTRIGGERCAPILOOP_H
+
+#include <stdio.h>
+#include <atomic>
+#include <functional>
+
+#include "capi_v2.h"
+#include "PalRingBuffer.h"
+
+/*
+ * Upper bound for one wait on the ring buffer reader, so that an exit
+ * request is still observed promptly when no data arrives.
+ */
+#define ST_CAPI_READ_WAIT_TIMEOUT_MS (5)
+
+struct st_capi_loop_config {
+    PalRingBufferReader *reader;
+    capi_v2_t *capi;
+    uint32_t start;            /* bytes to skip before the first chunk */
+    uint32_t end;              /* processing stops at end - start bytes */
+    uint32_t first_chunk;      /* size of the first process call */
+    uint32_t chunk;            /* size of every following process call */
+    uint32_t result_param_id;  /* get_param id read after every chunk */
+    void *result;
+    uint32_t result_size;
+    char *wrap_buff;           /* max(first_chunk, chunk) bytes, for wraps */
+    std::atomic<bool> *exit;   /* set by stop/restart to end the loop */
+    FILE *dump_fd;             /* optional copy of the processed data */
+    const char *trace_name;    /* ATRACE label of the process call */
+};
+
+struct st_capi_loop_stats {
+    uint32_t bytes_processed;
+    uint64_t process_us;       /* time spent in capi process */
+    uint64_t get_param_us;     /* time spent in capi get_param */
+    uint32_t stalls;           /* waits that timed out short of a chunk */
+    uint64_t stall_us;
+};
+
+/*
+ * Keyword detection window: start moves back by before bytes, end forward by
+ * after bytes, and the first chunk covers the keyword rounded down to align
+ * bytes, as the PDK requires. cfg->chunk is left to the caller.
+ */
+void SoundTriggerCapiKwWindow(struct st_capi_loop_config *cfg,
+                              uint32_t kw_start, uint32_t kw_end,
+                              uint32_t before, uint32_t after, uint32_t align);
+
+/* User verification window: the whole keyword is processed in one chunk */
+void SoundTriggerCapiUvWindow(struct st_capi_loop_config *cfg,
+                              uint32_t kw_start, uint32_t kw_end,
+                              uint32_t before, uint32_t after);
+
+/*
+ * Second stage processing of one detection: waits for chunks on the reader,
+ * hands them to capi process in place (copying only when the data wraps)
+ * and reads the result after each chunk. on_result is called with the
+ * fresh result and returns true on a detection, which ends the loop.
+ * Returns 0 when the loop ends by detection, end of data or exit request.
+ */
+int32_t SoundTriggerCapiLoop(const struct st_capi_loop_config *cfg,
+                             struct st_capi_loop_stats *stats,
+                             const std::function<bool()> &on_result);
+
+#endif  // SOUNDTRIGGERCAPILOOP_H
@@ -31,6 +31,7 @@
 #ifndef SOUNDTRIGGERENGINE_H
 #define SOUNDTRIGGERENGINE_H
 
+#include <atomic>
 #include <condition_variable>
 #include <thread>
 #include <mutex>
@@ -47,6 +48,7 @@ using ChronoSteadyClock_t = std::chrono::time_point<std::chrono::steady_clock>;
 
 #define BITS_PER_BYTE 8
 #define US_PER_SEC 1000000
+#define US_PER_MS 1000
 #define MS_PER_SEC 1000
 #define CNN_BUFFER_LENGTH 10000
 #define CNN_FRAME_SIZE 320
@@ -118,6 +120,8 @@ public:
     virtual void GetUpdatedBufConfig(uint32_t *hist_buffer_duration,
                                     uint32_t *pre_roll_duration) = 0;
     virtual void SetDetected(bool detected) = 0;
+    /* stop in-flight detection processing without waiting for it */
+    virtual void AbortDetection() {}
     virtual int32_t GetParameters(uint32_t param_id, void **payload) = 0;
     virtual int32_t ConnectSessionDevice(
         Stream* stream_handle,
@@ -170,11 +174,9 @@ protected:
     uint32_t bit_width_;
     uint32_t channels_;
 
-    std::thread buffer_thread_handler_;
     std::mutex mutex_;
-    std::condition_variable cv_;
-    bool exit_thread_;
-    bool exit_buffering_;
+    /* written by stop/restart without the processing thread's lock */
+    std::atomic<bool> exit_buffering_;
 };
 
 #endif  // SOUNDTRIGGERENGINE_H
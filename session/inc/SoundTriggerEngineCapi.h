@@ -31,6 +31,9 @@
 #ifndef SOUNDTRIGGERENGINECAPI_H
 #define SOUNDTRIGGERENGINECAPI_H
 
+#include <atomic>
+#include <vector>
+
 #include "capi_v2.h"
 #include "capi_v2_extn.h"
 
@@ -58,6 +61,7 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
         uint8_t *conf_levels,
         uint32_t num_conf_levels) override;
     void SetDetected(bool detected) override;
+    void AbortDetection() override;
 
     int32_t GetParameters(uint32_t param_id __unused, void **payload __unused) {
         return 0;
@@ -99,7 +103,8 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
     int32_t StopSoundEngine();
     int32_t StartKeywordDetection();
     int32_t StartUserVerification();
-    static void BufferThreadLoop(SoundTriggerEngineCapi *capi_engine);
+    char *GetProcessInputBuffer(size_t size);
+    static void ProcessDetection(SoundTriggerEngineCapi *capi_engine);
 
     std::string lib_name_;
     capi_v2_t *capi_handle_;
@@ -108,7 +113,7 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
 
     std::mutex event_mutex_;
     st_sound_model_type_t detection_type_;
-    bool processing_started_;
+    std::atomic<bool> processing_started_;
     bool keyword_detected_;
     int32_t confidence_threshold_;
     uint32_t buffer_size_;
@@ -131,6 +136,16 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
     int32_t detection_state_;
     stage2_uv_wrapper_scratch_param_t in_model_buffer_param_;
     stage2_uv_wrapper_scratch_param_t scratch_param_;
+    /*
+     * Reused across detections: only grows when a detection needs a
+     * larger wrapped-data copy than any before it.
+     */
+    std::vector<char> process_input_buff_;
+    sva_result_t kw_result_;
+    stage2_uv_wrapper_result uv_result_;
+    stage2_uv_wrapper_stage1_uv_score_t uv_score_;
+    /* set when a sibling engine rejected this detection */
+    std::atomic<bool> aborted_;
 };
 #endif  // SOUNDTRIGGERENGINECAPI_H
 
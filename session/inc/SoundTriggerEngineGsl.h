@@ -31,7 +31,10 @@
 #ifndef SOUNDTRIGGERENGINEGSL_H
 #define SOUNDTRIGGERENGINEGSL_H
 
+#include <list>
 #include <map>
+#include <memory>
+#include <unordered_map>
 
 #include "SoundTriggerEngine.h"
 #include "SoundTriggerUtils.h"
@@ -56,6 +59,13 @@ typedef enum {
     ENG_DETECTED,
 } eng_state_t;
 
+/* merged model blob cached by SoundTriggerEngineGsl, see LookupMergedModel */
+struct merged_model_entry {
+    uint64_t key;
+    std::shared_ptr<uint8_t> data;
+    uint32_t size;
+};
+
 class Session;
 class Stream;
 
@@ -119,6 +129,7 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
 
  private:
     int32_t StartBuffering(Stream *s);
+    size_t WriteMmapToRingBuffer(size_t offset, size_t size, FILE *dump_fd);
     int32_t RestartRecognition_l(Stream *s);
     int32_t UpdateSessionPayload(st_param_id_type_t param);
     int32_t ParseDetectionPayloadPDK(void *event_data);
@@ -146,6 +157,10 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
              listen_model_type *out_model);
     int32_t DeleteFromMergedModel(char **keyphrases, uint32_t num_keyphrases,
              listen_model_type *in_model, listen_model_type *out_model);
+    static uint64_t HashModelData(const uint8_t *data, uint32_t size,
+             uint64_t hash);
+    bool LookupMergedModel(uint64_t key, listen_model_type *out_model);
+    void StoreMergedModel(uint64_t key, listen_model_type *out_model);
     int32_t ConstructAPMPayload(uint32_t param_id, uint8_t** payload,
                                 uint8_t* data, uint32_t data_size);
     int32_t ProcessStartRecognition(Stream *s);
@@ -172,6 +187,19 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
     std::vector<uint32_t> updated_cfg_;
     SoundModelInfo *eng_sm_info_;
     bool sm_merged_;
+    /*
+     * Merge and delete results keyed by their inputs, most recent first.
+     * out_model data handed out by MergeSoundModels/DeleteFromMergedModel
+     * is owned here and stays valid until the next merge or delete.
+     */
+    std::list<merged_model_entry> merged_model_lru_;
+    std::unordered_map<uint64_t, std::list<merged_model_entry>::iterator>
+                                                      merged_model_index_;
+    std::shared_ptr<uint8_t> cur_merged_model_;
+    size_t merged_model_cache_bytes_;
+    size_t merged_model_cache_limit_;
+    uint32_t merged_model_cache_hits_;
+    uint32_t merged_model_cache_misses_;
     int32_t dev_disconnect_count_;
     eng_state_t eng_state_;
     struct detection_engine_config_voice_wakeup wakeup_config_;
@@ -203,5 +231,8 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
     std::mutex state_mutex_;
     std::mutex ec_ref_mutex_;
     std::shared_ptr<Device> rx_ec_dev_;
+    std::thread buffer_thread_handler_;
+    std::condition_variable cv_;
+    bool exit_thread_;
 };
 #endif  // SOUNDTRIGGERENGINEGSL_H
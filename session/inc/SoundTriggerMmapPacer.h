@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SOUNDTRIGGERMMAPPACER_H
+#define SOUNDTRIGGERMMAPPACER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAX_MMAP_POSITION_QUERY_RETRY_CNT 5
+/* wake up this long after the predicted DSP write to absorb jitter */
+#define MMAP_WAKEUP_MARGIN_US 500
+#define MMAP_MIN_WAIT_US 1000
+
+struct st_mmap_pacer {
+    int64_t last_update_ns;    /* CLOCK_MONOTONIC of the last pointer advance */
+    int64_t update_period_ns;  /* spacing of the last two advances, 0 unknown */
+    int64_t stall_timeout_ns;  /* no progress for this long is an error */
+    int64_t max_wait_ns;       /* one whole input buffer duration */
+    int64_t default_wait_ns;   /* one input buffer, while no spacing is known */
+};
+
+/*
+ * Starts pacing at now_ns for a lab buffer of buf_num input buffers lasting
+ * buffer_ms in total.
+ */
+void SoundTriggerMmapPacerInit(struct st_mmap_pacer *pacer, int64_t now_ns,
+                               uint32_t buffer_ms, size_t buf_num);
+
+/*
+ * Records a write pointer advance. pos_ns is the timestamp of the mmap
+ * position, now_ns is used instead if the driver leaves it 0. first is true
+ * for the first advance after start, whose spacing is not a DSP period.
+ */
+void SoundTriggerMmapPacerUpdate(struct st_mmap_pacer *pacer, int64_t pos_ns,
+                                 int64_t now_ns, bool first);
+
+/*
+ * Time to sleep after a poll found no new data: until just after the next
+ * predicted DSP write, clamped between MMAP_MIN_WAIT_US and max_wait_ns.
+ * Returns -EIO once no progress was seen for stall_timeout_ns.
+ */
+int64_t SoundTriggerMmapPacerWait(const struct st_mmap_pacer *pacer,
+                                  int64_t now_ns);
+
+#endif  // SOUNDTRIGGERMMAPPACER_H
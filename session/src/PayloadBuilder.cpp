@@ -44,6 +44,10 @@
 #include "sp_vi.h"
 #include "sp_rx.h"
 #include "fluence_ffv_common_calibration.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #if defined(FEATURE_IPQ_OPENWRT) || defined(LINUX_ENABLED)
 #define USECASE_XML_FILE "/etc/usecaseKvManager.xml"
@@ -52,6 +56,14 @@
 #endif
 
 #define USECASE_ARRAX_XML_FILE "/vendor/etc/usecaseKvManager_arrax.xml"
+
+#if defined(FEATURE_IPQ_OPENWRT) || defined(LINUX_ENABLED)
+#define USECASE_KV_SNAPSHOT_FILE "/var/cache/usecaseKvManager.bin"
+#else
+#define USECASE_KV_SNAPSHOT_FILE "/data/vendor/audio/usecaseKvManager.bin"
+#endif
+#define USECASE_KV_SNAPSHOT_MAGIC 0x53564b50 /* "PKVS" */
+#define USECASE_KV_SNAPSHOT_VERSION 3
 #define PARAM_ID_CHMIXER_COEFF 0x0800101F
 #define CUSTOM_STEREO_NUM_OUT_CH 0x0002
 #define CUSTOM_STEREO_NUM_IN_CH 0x0002
@@ -66,6 +78,8 @@
 
 /* ID of the Master Gain parameter used by MODULE_ID_VOL_CTRL. */
 #define PARAM_ID_VOL_CTRL_MASTER_GAIN 0x08001035
+/* Gain step used by MODULE_ID_VOL_CTRL while ramping, in microseconds. */
+#define VOL_CTRL_GAIN_RAMP_STEP_US 1000
 
 struct volume_ctrl_master_gain_t
 {
@@ -304,7 +318,7 @@ void PayloadBuilder::payloadDpAudioConfig(uint8_t** payload, size_t* size,
 
 #define PLAYBACK_VOLUME_MAX 0x2000
 void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct pal_volume_data* voldata)
+        uint32_t miid, struct pal_volume_data* voldata, PayloadWriter *writer)
 {
     struct apm_module_param_data_t* header = nullptr;
     volume_ctrl_master_gain_t *volConf = nullptr;
@@ -325,7 +339,10 @@ void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
     payloadSize = sizeof(struct apm_module_param_data_t) +
                   sizeof(struct volume_ctrl_master_gain_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    if (writer)
+        payloadInfo = writer->alloc(payloadSize + padBytes);
+    else
+        payloadInfo = (uint8_t *)calloc(1, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -346,7 +363,7 @@ void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
 }
 
 void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct pal_volume_data* voldata)
+        uint32_t miid, struct pal_volume_data* voldata, PayloadWriter *writer)
 {
      const uint32_t PLAYBACK_MULTI_VOLUME_GAIN = 1 << 28;
      struct apm_module_param_data_t* header = nullptr;
@@ -360,7 +377,10 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
                    sizeof(struct volume_ctrl_multichannel_gain_t) +
                    numChannels * sizeof(volume_ctrl_channels_gain_config_t);
      padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-     payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+     if (writer)
+         payloadInfo = writer->alloc(payloadSize + padBytes);
+     else
+         payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
      if (!payloadInfo) {
          PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
          return;
@@ -390,6 +410,50 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
      PAL_DBG(LOG_TAG, "payload %pK size %zu", *payload, *size);
 }
 
+/*
+ * Prepends the volume module ramp parameters to an already built gain
+ * payload, so the DSP ramps to the new gain within the same set param.
+ */
+void PayloadBuilder::payloadVolumeRampConfig(uint8_t** payload, size_t* size,
+        uint32_t miid, struct pal_volume_ramp_info *ramp,
+        uint8_t *gainPayload, size_t gainSize, PayloadWriter *writer)
+{
+    struct apm_module_param_data_t* header = nullptr;
+    volume_ctrl_gain_ramp_params_t *rampConf = nullptr;
+    uint8_t* payloadInfo = NULL;
+    size_t payloadSize = 0, padBytes = 0;
+
+    payloadSize = sizeof(struct apm_module_param_data_t) +
+                  sizeof(struct volume_ctrl_gain_ramp_params_t);
+    padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
+    if (writer)
+        payloadInfo = writer->alloc(payloadSize + padBytes + gainSize);
+    else
+        payloadInfo = (uint8_t *)calloc(1, payloadSize + padBytes + gainSize);
+    if (!payloadInfo) {
+        PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
+        return;
+    }
+    header = (struct apm_module_param_data_t*)payloadInfo;
+    header->module_instance_id = miid;
+    header->param_id = PARAM_ID_VOL_CTRL_GAIN_RAMP_PARAMETERS;
+    header->error_code = 0x0;
+    header->param_size = payloadSize -  sizeof(struct apm_module_param_data_t);
+    rampConf = (volume_ctrl_gain_ramp_params_t *)(payloadInfo +
+            sizeof(struct apm_module_param_data_t));
+    rampConf->period_ms = ramp->duration_ms;
+    rampConf->step_us = VOL_CTRL_GAIN_RAMP_STEP_US;
+    rampConf->ramping_curve = ramp->curve;
+    if (gainSize)
+        memcpy(payloadInfo + payloadSize + padBytes, gainPayload, gainSize);
+    PAL_VERBOSE(LOG_TAG, "header params IID:%x param_id:%x period %u ms curve %u",
+                  header->module_instance_id, header->param_id,
+                  rampConf->period_ms, rampConf->ramping_curve);
+    *size = payloadSize + padBytes + gainSize;
+    *payload = payloadInfo;
+    PAL_DBG(LOG_TAG, "payload %pK size %zu", *payload, *size);
+}
+
 void PayloadBuilder::payloadMFCConfig(uint8_t** payload, size_t* size,
         uint32_t miid, struct sessionToPayloadParam* data)
 {
@@ -731,6 +795,45 @@ bool PayloadBuilder::compareNumSelectors(struct kvInfo info_1, struct kvInfo inf
     return (info_1.selector_names.size() < info_2.selector_names.size());
 }
 
+/* selector pairs must be sorted, so that the key does not depend on xml order */
+std::string PayloadBuilder::getSelectorKey(
+    const std::vector<std::pair<selector_type_t, std::string>> &selector_pairs)
+{
+    std::string key;
+
+    for (auto &pair : selector_pairs) {
+        key += std::to_string(pair.first);
+        key += '=';
+        key += pair.second;
+        key += ';';
+    }
+    return key;
+}
+
+/*
+ * Called once per stream/device tag after its entries are sorted, and for
+ * every tag loaded from the snapshot. Keeps every entry's selector pairs
+ * sorted so lookups never sort them again, and records the first entry for
+ * each exact selector set so findKVs can resolve exact matches with a hash
+ * probe.
+ */
+void PayloadBuilder::buildSelectorIndex(struct allKVs &kvs)
+{
+    uint32_t max_pairs = 0;
+
+    kvs.exact_selector_idx.clear();
+    kvs.max_pairs_before.assign(kvs.keys_values.size(), 0);
+    for (uint32_t j = 0; j < kvs.keys_values.size(); j++) {
+        std::sort(kvs.keys_values[j].selector_pairs.begin(),
+            kvs.keys_values[j].selector_pairs.end());
+        kvs.exact_selector_idx.emplace(
+            getSelectorKey(kvs.keys_values[j].selector_pairs), j);
+        kvs.max_pairs_before[j] = max_pairs;
+        max_pairs = std::max(max_pairs,
+            (uint32_t)kvs.keys_values[j].selector_pairs.size());
+    }
+}
+
 void PayloadBuilder::startTag(void *userdata, const XML_Char *tag_name,
     const XML_Char **attr)
 {
@@ -804,33 +907,40 @@ void PayloadBuilder::endTag(void *userdata, const XML_Char *tag_name)
             std::sort(all_streams[size].keys_values.begin(),
                 all_streams[size].keys_values.end(),
                 compareNumSelectors);
+            buildSelectorIndex(all_streams[size]);
         }
         return;
     }
     if (!strcmp(tag_name, "streampp")){
         if (all_streampps.size() > 0) {
             size = all_streampps.size() - 1;
+            /* Sort the key value tags based on number of selectors in each tag */
             std::sort(all_streampps[size].keys_values.begin(),
                 all_streampps[size].keys_values.end(),
                 compareNumSelectors);
+            buildSelectorIndex(all_streampps[size]);
         }
         return;
     }
     if (!strcmp(tag_name, "device")) {
         if (all_devices.size() > 0) {
             size = all_devices.size() - 1;
+            /* Sort the key value tags based on number of selectors in each tag */
             std::sort(all_devices[size].keys_values.begin(),
                 all_devices[size].keys_values.end(),
                 compareNumSelectors);
+            buildSelectorIndex(all_devices[size]);
         }
         return;
     }
     if (!strcmp(tag_name, "devicepp")) {
         if (all_devicepps.size() > 0) {
             size = all_devicepps.size() - 1;
+            /* Sort the key value tags based on number of selectors in each tag */
             std::sort(all_devicepps[size].keys_values.begin(),
                 all_devicepps[size].keys_values.end(),
                 compareNumSelectors);
+            buildSelectorIndex(all_devicepps[size]);
         }
         return;
     }
@@ -850,71 +960,364 @@ void PayloadBuilder::handleData(void *userdata, const char *s, int len)
    }
 }
 
-int PayloadBuilder::init()
+struct usecase_kv_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t xml_hash;
+    uint64_t lut_hash;
+    uint64_t payload_size;
+    uint64_t payload_hash;     /* FNV-1a of the payload, catches a torn file */
+};
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+
+/* FNV-1a */
+static uint64_t fnvHash(uint64_t hash, const void *data, size_t size)
 {
-    XML_Parser parser;
-    FILE *file = NULL;
-    int ret = 0;
-    int bytes_read;
-    void *buf = NULL;
-    struct user_xml_data tag_data;
-    memset(&tag_data, 0, sizeof(tag_data));
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+static uint64_t hashLUT(uint64_t hash, const std::map<std::string, T> &lut)
+{
+    for (auto &entry : lut) {
+        uint32_t id = (uint32_t)entry.second;
+
+        hash = fnvHash(hash, entry.first.c_str(), entry.first.size() + 1);
+        hash = fnvHash(hash, &id, sizeof(id));
+    }
+    return hash;
+}
+
+/*
+ * The snapshot stores ids resolved through these tables rather than the
+ * names in the xml, so a build that renumbers or extends them must not
+ * load a snapshot written by another one even if the xml is unchanged.
+ */
+static uint64_t hashKVLUTs()
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    hash = hashLUT(hash, deviceIdLUT);
+    hash = hashLUT(hash, usecaseIdLUT);
+    hash = hashLUT(hash, selectorstypeLUT);
+    return hash;
+}
+
+static void putU32(std::vector<uint8_t> &out, uint32_t val)
+{
+    out.insert(out.end(), (uint8_t *)&val, (uint8_t *)&val + sizeof(val));
+}
+
+static void putString(std::vector<uint8_t> &out, const std::string &str)
+{
+    putU32(out, str.size());
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+struct snapshotReader {
+    const uint8_t *pos;
+    const uint8_t *end;
+
+    bool getU32(uint32_t *val) {
+        if (end - pos < (ptrdiff_t)sizeof(*val))
+            return false;
+        memcpy(val, pos, sizeof(*val));
+        pos += sizeof(*val);
+        return true;
+    }
+    bool getString(std::string *str) {
+        uint32_t len = 0;
+
+        if (!getU32(&len) || end - pos < (ptrdiff_t)len)
+            return false;
+        str->assign((const char *)pos, len);
+        pos += len;
+        return true;
+    }
+    /* element count, every element takes at least one u32 of what is left */
+    bool getCount(uint32_t *count) {
+        if (!getU32(count))
+            return false;
+        return *count <= (size_t)(end - pos) / sizeof(uint32_t);
+    }
+};
+
+static void putKVTable(std::vector<uint8_t> &out, const std::vector<allKVs> &table)
+{
+    putU32(out, table.size());
+    for (auto &kvs : table) {
+        putU32(out, kvs.id_type.size());
+        for (int id : kvs.id_type)
+            putU32(out, id);
+        putU32(out, kvs.keys_values.size());
+        for (auto &info : kvs.keys_values) {
+            putU32(out, info.selector_names.size());
+            for (auto &name : info.selector_names)
+                putString(out, name);
+            putU32(out, info.selector_pairs.size());
+            for (auto &pair : info.selector_pairs) {
+                putU32(out, pair.first);
+                putString(out, pair.second);
+            }
+            putU32(out, info.kv_pairs.size());
+            for (auto &kv : info.kv_pairs) {
+                putU32(out, kv.key);
+                putU32(out, kv.value);
+            }
+        }
+    }
+}
+
+static bool getKVTable(struct snapshotReader &in, std::vector<allKVs> &table)
+{
+    uint32_t count = 0, num = 0, val = 0;
+
+    if (!in.getCount(&count))
+        return false;
+    table.resize(count);
+    for (auto &kvs : table) {
+        if (!in.getCount(&num))
+            return false;
+        kvs.id_type.resize(num);
+        for (auto &id : kvs.id_type) {
+            if (!in.getU32(&val))
+                return false;
+            id = (int)val;
+        }
+        if (!in.getCount(&num))
+            return false;
+        kvs.keys_values.resize(num);
+        for (auto &info : kvs.keys_values) {
+            if (!in.getCount(&num))
+                return false;
+            info.selector_names.resize(num);
+            for (auto &name : info.selector_names) {
+                if (!in.getString(&name))
+                    return false;
+            }
+            if (!in.getCount(&num))
+                return false;
+            info.selector_pairs.resize(num);
+            for (auto &pair : info.selector_pairs) {
+                if (!in.getU32(&val) || !in.getString(&pair.second))
+                    return false;
+                pair.first = (selector_type_t)val;
+            }
+            if (!in.getCount(&num))
+                return false;
+            info.kv_pairs.resize(num);
+            for (auto &kv : info.kv_pairs) {
+                if (!in.getU32(&kv.key) || !in.getU32(&kv.value))
+                    return false;
+            }
+        }
+        PayloadBuilder::buildSelectorIndex(kvs);
+    }
+    return true;
+}
+
+int PayloadBuilder::loadKVSnapshot(const char *snapshotFile, uint64_t xmlHash)
+{
+    int fd = -1;
+    int ret = -EINVAL;
+    struct stat st;
+    void *map = MAP_FAILED;
+    struct usecase_kv_snapshot_header hdr;
+    struct snapshotReader in;
+
+    fd = open(snapshotFile, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -ENOENT;
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(hdr))
+        goto closeFd;
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        goto closeFd;
+
+    memcpy(&hdr, map, sizeof(hdr));
+    if (hdr.magic != USECASE_KV_SNAPSHOT_MAGIC ||
+        hdr.version != USECASE_KV_SNAPSHOT_VERSION ||
+        hdr.xml_hash != xmlHash ||
+        hdr.lut_hash != hashKVLUTs() ||
+        hdr.payload_size != st.st_size - sizeof(hdr)) {
+        PAL_INFO(LOG_TAG, "stale kv snapshot, parsing xml");
+        goto unmap;
+    }
+    if (hdr.payload_hash != fnvHash(FNV_OFFSET_BASIS,
+                                    (const uint8_t *)map + sizeof(hdr),
+                                    hdr.payload_size)) {
+        PAL_ERR(LOG_TAG, "kv snapshot checksum mismatch, parsing xml");
+        goto unmap;
+    }
+
+    in.pos = (const uint8_t *)map + sizeof(hdr);
+    in.end = (const uint8_t *)map + st.st_size;
     all_streams.clear();
     all_streampps.clear();
     all_devices.clear();
     all_devicepps.clear();
+    if (!getKVTable(in, all_streams) || !getKVTable(in, all_streampps) ||
+        !getKVTable(in, all_devices) || !getKVTable(in, all_devicepps) ||
+        in.pos != in.end) {
+        PAL_ERR(LOG_TAG, "corrupt kv snapshot, parsing xml");
+        all_streams.clear();
+        all_streampps.clear();
+        all_devices.clear();
+        all_devicepps.clear();
+        goto unmap;
+    }
+    ret = 0;
 
-    if (getSocId() == ARRAX_SOC_ID) {
-        PAL_INFO(LOG_TAG, "XML parsing started %s", USECASE_ARRAX_XML_FILE);
-        file = fopen(USECASE_ARRAX_XML_FILE, "r");
-    } else {
-        PAL_INFO(LOG_TAG, "XML parsing started %s", USECASE_XML_FILE);
-        file = fopen(USECASE_XML_FILE, "r");
+unmap:
+    munmap(map, st.st_size);
+closeFd:
+    close(fd);
+    return ret;
+}
+
+/* the four KV tables in snapshot payload format */
+void PayloadBuilder::serializeKVTables(std::vector<uint8_t> &out)
+{
+    putKVTable(out, all_streams);
+    putKVTable(out, all_streampps);
+    putKVTable(out, all_devices);
+    putKVTable(out, all_devicepps);
+}
+
+int PayloadBuilder::saveKVSnapshot(const char *snapshotFile, uint64_t xmlHash)
+{
+    std::vector<uint8_t> payload;
+    struct usecase_kv_snapshot_header hdr;
+    std::string tmpFile = std::string(snapshotFile) + ".tmp";
+    FILE *file = NULL;
+    bool ok = false;
+
+    serializeKVTables(payload);
+
+    hdr.magic = USECASE_KV_SNAPSHOT_MAGIC;
+    hdr.version = USECASE_KV_SNAPSHOT_VERSION;
+    hdr.xml_hash = xmlHash;
+    hdr.lut_hash = hashKVLUTs();
+    hdr.payload_size = payload.size();
+    hdr.payload_hash = fnvHash(FNV_OFFSET_BASIS, payload.data(), payload.size());
+
+    /* write to a temp file and rename, so a reader never sees a partial file */
+    file = fopen(tmpFile.c_str(), "wb");
+    if (!file) {
+        PAL_DBG(LOG_TAG, "cannot create kv snapshot %s", tmpFile.c_str());
+        return -errno;
+    }
+    ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1 &&
+         fwrite(payload.data(), 1, payload.size(), file) == payload.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmpFile.c_str(), snapshotFile)) {
+        PAL_ERR(LOG_TAG, "failed to write kv snapshot");
+        unlink(tmpFile.c_str());
+        return -EIO;
     }
+    PAL_INFO(LOG_TAG, "kv snapshot written, %zu bytes", payload.size());
+    return 0;
+}
+
+int PayloadBuilder::init()
+{
+    if (getSocId() == ARRAX_SOC_ID)
+        return initKVTables(USECASE_ARRAX_XML_FILE, USECASE_KV_SNAPSHOT_FILE);
+
+    return initKVTables(USECASE_XML_FILE, USECASE_KV_SNAPSHOT_FILE);
+}
+
+/* reads xmlFile whole, the snapshot is keyed by a hash of its contents */
+int PayloadBuilder::readKVXml(const char *xmlFile, std::vector<char> &xml,
+                              uint64_t *xmlHash)
+{
+    FILE *file = NULL;
+    int ret = 0;
+    size_t bytes_read;
+    char buf[1024];
+
+    xml.clear();
+    file = fopen(xmlFile, "r");
     if (!file) {
-        PAL_ERR(LOG_TAG, "Failed to open xml");
+        PAL_ERR(LOG_TAG, "Failed to open xml %s", xmlFile);
+        return -EINVAL;
+    }
+    while ((bytes_read = fread(buf, 1, sizeof(buf), file)) > 0)
+        xml.insert(xml.end(), buf, buf + bytes_read);
+    if (ferror(file)) {
+        PAL_ERR(LOG_TAG, "fread failed");
         ret = -EINVAL;
-        goto done;
     }
+    fclose(file);
+    *xmlHash = fnvHash(FNV_OFFSET_BASIS, xml.data(), xml.size());
+    return ret;
+}
+
+/* rebuilds the KV tables from the xml contents */
+int PayloadBuilder::parseKVXml(const std::vector<char> &xml)
+{
+    XML_Parser parser;
+    int ret = 0;
+    struct user_xml_data tag_data;
+    memset(&tag_data, 0, sizeof(tag_data));
+    all_streams.clear();
+    all_streampps.clear();
+    all_devices.clear();
+    all_devicepps.clear();
 
     parser = XML_ParserCreate(NULL);
     if (!parser) {
         PAL_ERR(LOG_TAG, "Failed to create XML");
-        goto closeFile;
+        return -ENOMEM;
     }
     XML_SetUserData(parser,&tag_data);
     XML_SetElementHandler(parser, startTag, endTag);
     XML_SetCharacterDataHandler(parser, handleData);
 
-    while (1) {
-        buf = XML_GetBuffer(parser, 1024);
-        if (buf == NULL) {
-            PAL_ERR(LOG_TAG, "XML_Getbuffer failed");
-            ret = -EINVAL;
-            goto freeParser;
-        }
+    if (XML_Parse(parser, xml.data(), xml.size(), 1) == XML_STATUS_ERROR) {
+        PAL_ERR(LOG_TAG, "XML ParseBuffer failed ");
+        ret = -EINVAL;
+    }
+    XML_ParserFree(parser);
+    return ret;
+}
 
-        bytes_read = fread(buf, 1, 1024, file);
-        if (bytes_read < 0) {
-            PAL_ERR(LOG_TAG, "fread failed");
-            ret = -EINVAL;
-            goto freeParser;
-        }
+/*
+ * Fills the KV tables from snapshotFile when it was built from the same
+ * xmlFile and LUTs, otherwise parses xmlFile and rewrites snapshotFile.
+ */
+int PayloadBuilder::initKVTables(const char *xmlFile, const char *snapshotFile)
+{
+    int ret = 0;
+    std::vector<char> xml;
+    uint64_t xml_hash = 0;
 
-        if (XML_ParseBuffer(parser, bytes_read, bytes_read == 0) == XML_STATUS_ERROR) {
-            PAL_ERR(LOG_TAG, "XML ParseBuffer failed ");
-            ret = -EINVAL;
-            goto freeParser;
-        }
-        if (bytes_read == 0)
-            break;
+    all_streams.clear();
+    all_streampps.clear();
+    all_devices.clear();
+    all_devicepps.clear();
+
+    PAL_INFO(LOG_TAG, "XML parsing started %s", xmlFile);
+    ret = readKVXml(xmlFile, xml, &xml_hash);
+    if (ret)
+        return ret;
+
+    if (loadKVSnapshot(snapshotFile, xml_hash) == 0) {
+        PAL_INFO(LOG_TAG, "usecase KVs loaded from snapshot");
+        return 0;
     }
 
-freeParser:
-    XML_ParserFree(parser);
-closeFile:
-    fclose(file);
-done:
+    ret = parseKVXml(xml);
+    if (!ret)
+        saveKVSnapshot(snapshotFile, xml_hash);
+
     return ret;
 }
 
@@ -2247,9 +2650,63 @@ bool PayloadBuilder::findKVs(std::vector<std::pair<selector_type_t, std::string>
     std::vector<std::pair<int, int>> &keyVector)
 {
     bool found = false;
+    bool has_duplicates = false;
+    std::string selector_key;
+    std::unordered_map<std::string, uint32_t>::iterator exact;
+    size_t first_match = 0;
+    size_t scan_end = 0;
+
+    /* entry selector pairs are kept sorted at init, sort the query once */
+    std::sort(filled_selector_pairs.begin(), filled_selector_pairs.end());
+    has_duplicates = std::adjacent_find(filled_selector_pairs.begin(),
+        filled_selector_pairs.end()) != filled_selector_pairs.end();
+    if (!filled_selector_pairs.empty() && !has_duplicates)
+        selector_key = getSelectorKey(filled_selector_pairs);
 
     for (int32_t i = 0; i < any_type.size(); i++) {
         if (isIdTypeAvailable(type, any_type[i].id_type)) {
+            if (!selector_key.empty()) {
+                /*
+                 * Without duplicate query selectors an entry matches either
+                 * exactly (hash probe) or as a strict superset of the query.
+                 * Keep the first one in table order, like the linear search.
+                 * Entries are sorted by selector count, so before an exact
+                 * match a superset is only possible when a multi-value
+                 * selector gave an earlier entry more pairs than the query.
+                 */
+                std::vector<kvInfo> &entries = any_type[i].keys_values;
+                exact = any_type[i].exact_selector_idx.find(selector_key);
+                first_match = entries.size();
+                scan_end = entries.size();
+                if (exact != any_type[i].exact_selector_idx.end()) {
+                    first_match = exact->second;
+                    scan_end = (any_type[i].max_pairs_before[first_match] >
+                        filled_selector_pairs.size()) ? first_match : 0;
+                }
+                for (size_t j = 0; j < scan_end; j++) {
+                    if (entries[j].selector_pairs.size() >
+                            filled_selector_pairs.size() &&
+                        std::includes(entries[j].selector_pairs.begin(),
+                            entries[j].selector_pairs.end(),
+                            filled_selector_pairs.begin(),
+                            filled_selector_pairs.end())) {
+                        first_match = j;
+                        break;
+                    }
+                }
+                if (first_match < entries.size()) {
+                    for (int32_t k = 0; k < entries[first_match].kv_pairs.size(); k++) {
+                        keyVector.push_back(
+                            std::make_pair(entries[first_match].kv_pairs[k].key,
+                            entries[first_match].kv_pairs[k].value));
+                        PAL_INFO(LOG_TAG, "key: 0x%x value: 0x%x\n",
+                            entries[first_match].kv_pairs[k].key,
+                            entries[first_match].kv_pairs[k].value);
+                    }
+                    found = true;
+                }
+                continue;
+            }
             for (int32_t j = 0; j < any_type[i].keys_values.size(); j++) {
                 if (filled_selector_pairs.empty() != true) {
                     if (compareSelectorPairs(any_type[i].keys_values[j].selector_pairs,
@@ -62,13 +62,39 @@ Session::~Session()
 
 }
 
+int Session::getCachedMIID(struct mixer *mixer, int device, const char *intf_name,
+                           int tag_id, uint32_t *miid)
+{
+    int status = 0;
+    std::tuple<int, std::string, int> key(device, intf_name ? intf_name : "", tag_id);
+
+    std::lock_guard<std::mutex> lock(miidCacheMutex);
+    auto it = miidCache.find(key);
+    if (it != miidCache.end()) {
+        *miid = it->second;
+        return 0;
+    }
+
+    status = SessionAlsaUtils::getModuleInstanceId(mixer, device, intf_name, tag_id, miid);
+    if (status == 0)
+        miidCache[key] = *miid;
+    return status;
+}
+
+void Session::invalidateMIIDCache()
+{
+    std::lock_guard<std::mutex> lock(miidCacheMutex);
+
+    miidCache.clear();
+}
+
 void Session::setPmQosMixerCtl(pmQosVote vote)
 {
     struct mixer *hwMixer;
     struct mixer_ctl *ctl;
 
     if (0 == rm->getHwAudioMixer(&hwMixer)) {
-        ctl = mixer_get_ctl_by_name(hwMixer, "PM_QOS Vote");
+        ctl = ResourceManager::getMixerCtl(hwMixer, "PM_QOS Vote");
         if (!ctl) {
             PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n",
                                                "PM_QOS Vote");
@@ -228,14 +254,14 @@ int Session::getEffectParameters(Stream *s __unused, effect_pal_payload_t *effec
     }
 
     if (!rxAifBackEnds.empty()) { /** search in RX GKV */
-        status = SessionAlsaUtils::getModuleInstanceId(mixer, device, rxAifBackEnds[0].second.data(),
+        status = getCachedMIID(mixer, device, rxAifBackEnds[0].second.data(),
                 effectPayload->tag, &miid);
         if (status) /** if not found, reset miid to 0 again */
             miid = 0;
     }
 
     if (!txAifBackEnds.empty()) { /** search in TX GKV */
-        status = SessionAlsaUtils::getModuleInstanceId(mixer, device, txAifBackEnds[0].second.data(),
+        status = getCachedMIID(mixer, device, txAifBackEnds[0].second.data(),
                 effectPayload->tag, &miid);
         if (status)
             miid = 0;
@@ -590,17 +616,17 @@ int Session::setSlotMask(const std::shared_ptr<ResourceManager>& rm, struct pal_
 
     // set FE ctl to BE first in case this is called from connectionSessionDevice
     rm->getBackendName(dAttr.id, backendname);
-    ctl = mixer_get_ctl_by_name(mixer, feName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, feName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", feName.str().data());
         status = -EINVAL;
         goto exit;
     }
-    mixer_ctl_set_enum_by_string(ctl, backendname.c_str());
+    ResourceManager::setMixerCtlEnum(ctl, backendname.c_str());
     ctl = NULL;
 
     // set tag data
-    ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
         status = -EINVAL;
@@ -942,7 +968,7 @@ int setConfig(Stream * s, pal_stream_type_t sType, configType type, uint32_t tag
                 goto exit;
             }
             tagCntrlName << stream << pcmDevIds.at(0) << " " << setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 return -ENOENT;
@@ -33,6 +33,7 @@
 #include "SessionAlsaUtils.h"
 #include "Stream.h"
 #include "ResourceManager.h"
+#include "PalTaskPool.h"
 #include "media_fmt_api.h"
 #include "gapless_api.h"
 #include <agm/agm_api.h>
@@ -41,6 +42,9 @@
 #include <fstream>
 #include <agm/agm_api.h>
 
+/* compress_wait polls in slices so close() can cut a wait nobody wakes */
+#define COMPRESS_WAIT_SLICE_MS 500
+
 void SessionAlsaCompress::updateCodecOptions(pal_param_payload *param_payload,pal_stream_direction_t stream_direction)
 {
 if (stream_direction == PAL_AUDIO_OUTPUT) {
@@ -586,85 +590,113 @@ int SessionAlsaCompress::setCustomFormatParam(pal_audio_fmt_t audio_fmt)
     return status;
 }
 
-void SessionAlsaCompress::offloadThreadLoop(SessionAlsaCompress* compressObj)
+std::mutex SessionAlsaCompress::cbLatencyMutex;
+uint64_t SessionAlsaCompress::cbLatencyCount = 0;
+uint64_t SessionAlsaCompress::cbLatencyTotalUs = 0;
+uint64_t SessionAlsaCompress::cbLatencyMaxUs = 0;
+
+void SessionAlsaCompress::getCallbackLatency(uint64_t *count, uint64_t *avgUs,
+                                             uint64_t *maxUs)
 {
-    std::shared_ptr<offload_msg> msg;
-    uint32_t event_id = 0;
-    int ret = 0;
-    bool is_drain_called = false;
-    std::unique_lock<std::mutex> lock(compressObj->cv_mutex_);
-
-    while (1) {
-        if (compressObj->msg_queue_.empty())
-            compressObj->cv_.wait(lock);  /* wait for incoming requests */
-
-        if (!compressObj->msg_queue_.empty()) {
-            msg = compressObj->msg_queue_.front();
-            compressObj->msg_queue_.pop();
-            lock.unlock();
-
-            if (msg && msg->cmd == OFFLOAD_CMD_EXIT)
-                break; // exit the thread
-
-            if (msg && msg->cmd == OFFLOAD_CMD_WAIT_FOR_BUFFER) {
-                if (compressObj->rm->cardState == CARD_STATUS_ONLINE) {
-                    PAL_VERBOSE(LOG_TAG, "calling compress_wait");
-                    ret = compress_wait(compressObj->compress, -1);
-                    PAL_VERBOSE(LOG_TAG, "out of compress_wait, ret %d", ret);
-                    event_id = PAL_STREAM_CBK_EVENT_WRITE_READY;
-                }
-            } else if (msg && msg->cmd == OFFLOAD_CMD_DRAIN) {
-                if (!is_drain_called) {
-                    PAL_INFO(LOG_TAG, "calling compress_drain");
-                    if (compressObj->rm->cardState == CARD_STATUS_ONLINE &&
-                        compressObj->compress != NULL) {
-                         ret = compress_drain(compressObj->compress);
-                         PAL_INFO(LOG_TAG, "out of compress_drain, ret %d", ret);
-                    }
-                }
-                if (ret == -ENETRESET) {
-                    PAL_ERR(LOG_TAG, "Block drain ready event during SSR");
-                    lock.lock();
-                    continue;
+    std::lock_guard<std::mutex> lock(cbLatencyMutex);
+
+    *count = cbLatencyCount;
+    *avgUs = cbLatencyCount ? cbLatencyTotalUs / cbLatencyCount : 0;
+    *maxUs = cbLatencyMaxUs;
+}
+
+void SessionAlsaCompress::postOffloadCmd(int cmd)
+{
+    std::chrono::steady_clock::time_point postTime = std::chrono::steady_clock::now();
+
+    PalTaskPool::getInstance()->post(this, [this, cmd, postTime]() {
+        handleOffloadCmd(cmd, postTime);
+    });
+}
+
+void SessionAlsaCompress::handleOffloadCmd(int cmd,
+                                           std::chrono::steady_clock::time_point postTime)
+{
+    std::chrono::steady_clock::time_point readyTime = postTime;
+    uint32_t event_id = PAL_STREAM_CBK_EVENT_WRITE_READY;
+    uint64_t latencyUs = 0;
+    int &ret = offloadRet;
+
+    /* close() is cutting the queue short, only the SSR error still goes out */
+    if (offloadClosing && cmd != OFFLOAD_CMD_ERROR)
+        return;
+
+    if (cmd == OFFLOAD_CMD_WAIT_FOR_BUFFER) {
+        if (rm->cardState == CARD_STATUS_ONLINE) {
+            PAL_VERBOSE(LOG_TAG, "calling compress_wait");
+            do {
+                ret = compress_wait(compress, COMPRESS_WAIT_SLICE_MS);
+            } while (ret && errno == ETIME && !offloadClosing &&
+                     rm->cardState == CARD_STATUS_ONLINE);
+            PAL_VERBOSE(LOG_TAG, "out of compress_wait, ret %d", ret);
+            if (offloadClosing) {
+                PAL_DBG(LOG_TAG, "session closing, drop write ready");
+                return;
+            }
+            event_id = PAL_STREAM_CBK_EVENT_WRITE_READY;
+        }
+    } else if (cmd == OFFLOAD_CMD_DRAIN) {
+        if (!isDrainCalled) {
+            PAL_INFO(LOG_TAG, "calling compress_drain");
+            if (rm->cardState == CARD_STATUS_ONLINE && compress != NULL) {
+                 ret = compress_drain(compress);
+                 PAL_INFO(LOG_TAG, "out of compress_drain, ret %d", ret);
+            }
+        }
+        if (ret == -ENETRESET) {
+            PAL_ERR(LOG_TAG, "Block drain ready event during SSR");
+            return;
+        }
+        isDrainCalled = false;
+        event_id = PAL_STREAM_CBK_EVENT_DRAIN_READY;
+    } else if (cmd == OFFLOAD_CMD_PARTIAL_DRAIN) {
+        if (rm->cardState == CARD_STATUS_ONLINE) {
+            if (isGaplessFmt) {
+                PAL_DBG(LOG_TAG, "calling partial compress_drain");
+                ret = compress_next_track(compress);
+                PAL_INFO(LOG_TAG, "out of compress next track, ret %d", ret);
+                if (ret == 0) {
+                    ret = compress_partial_drain(compress);
+                    PAL_INFO(LOG_TAG, "out of partial compress_drain, ret %d", ret);
                 }
-                is_drain_called = false;
+                event_id = PAL_STREAM_CBK_EVENT_PARTIAL_DRAIN_READY;
+            } else {
+                PAL_DBG(LOG_TAG, "calling compress_drain");
+                ret = compress_drain(compress);
+                PAL_INFO(LOG_TAG, "out of compress_drain, ret %d", ret);
+                isDrainCalled = true;
                 event_id = PAL_STREAM_CBK_EVENT_DRAIN_READY;
-            } else if (msg && msg->cmd == OFFLOAD_CMD_PARTIAL_DRAIN) {
-                if (compressObj->rm->cardState == CARD_STATUS_ONLINE) {
-                    if (compressObj->isGaplessFmt) {
-                        PAL_DBG(LOG_TAG, "calling partial compress_drain");
-                        ret = compress_next_track(compressObj->compress);
-                        PAL_INFO(LOG_TAG, "out of compress next track, ret %d", ret);
-                        if (ret == 0) {
-                            ret = compress_partial_drain(compressObj->compress);
-                            PAL_INFO(LOG_TAG, "out of partial compress_drain, ret %d", ret);
-                        }
-                        event_id = PAL_STREAM_CBK_EVENT_PARTIAL_DRAIN_READY;
-                    } else {
-                        PAL_DBG(LOG_TAG, "calling compress_drain");
-                        ret = compress_drain(compressObj->compress);
-                        PAL_INFO(LOG_TAG, "out of compress_drain, ret %d", ret);
-                        is_drain_called = true;
-                        event_id = PAL_STREAM_CBK_EVENT_DRAIN_READY;
-                    }
-                }
-                if (ret == -ENETRESET) {
-                    PAL_ERR(LOG_TAG, "Block drain ready event during SSR");
-                    lock.lock();
-                    continue;
-                }
-            }  else if (msg && msg->cmd == OFFLOAD_CMD_ERROR) {
-                PAL_ERR(LOG_TAG, "Sending error to PAL client");
-                event_id = PAL_STREAM_CBK_EVENT_ERROR;
             }
-            if (compressObj->sessionCb)
-                compressObj->sessionCb(compressObj->cbCookie, event_id, NULL, 0);
-
-            lock.lock();
         }
-
+        if (ret == -ENETRESET) {
+            PAL_ERR(LOG_TAG, "Block drain ready event during SSR");
+            return;
+        }
+    } else if (cmd == OFFLOAD_CMD_ERROR) {
+        PAL_ERR(LOG_TAG, "Sending error to PAL client");
+        event_id = PAL_STREAM_CBK_EVENT_ERROR;
     }
-    PAL_DBG(LOG_TAG, "exit offloadThreadLoop");
+
+    /* errors are ready when posted, the rest once the blocking call returns */
+    if (cmd != OFFLOAD_CMD_ERROR)
+        readyTime = std::chrono::steady_clock::now();
+    if (sessionCb)
+        sessionCb(cbCookie, event_id, NULL, 0);
+
+    latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - readyTime).count();
+    PAL_VERBOSE(LOG_TAG, "event %u callback latency %llu us", event_id,
+                (unsigned long long)latencyUs);
+    std::lock_guard<std::mutex> lock(cbLatencyMutex);
+    cbLatencyCount++;
+    cbLatencyTotalUs += latencyUs;
+    if (latencyUs > cbLatencyMaxUs)
+        cbLatencyMaxUs = latencyUs;
 }
 
 SessionAlsaCompress::SessionAlsaCompress(std::shared_ptr<ResourceManager> Rm)
@@ -703,6 +735,8 @@ int SessionAlsaCompress::open(Stream * s)
     std::vector<std::shared_ptr<Device>> associatedDevices;
     std::vector<std::pair<int32_t, std::string>> emptyBackEnds;
 
+    invalidateMIIDCache();
+    offloadClosing = false;
     PAL_DBG(LOG_TAG, "Enter");
     status = s->getStreamAttributes(&sAttr);
     streamHandle = s;
@@ -801,6 +835,7 @@ int SessionAlsaCompress::disconnectSessionDevice(Stream* streamHandle, pal_strea
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToDisconnect;
     int32_t status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToDisconnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToDisconnect,
             txAifBackEndsToDisconnect);
@@ -854,6 +889,7 @@ int SessionAlsaCompress::setupSessionDevice(Stream* streamHandle, pal_stream_typ
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToConnect;
     int32_t status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToConnect,
             txAifBackEndsToConnect);
@@ -879,6 +915,7 @@ int SessionAlsaCompress::connectSessionDevice(Stream* streamHandle, pal_stream_t
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToConnect;
     int32_t status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToConnect,
             txAifBackEndsToConnect);
@@ -947,7 +984,7 @@ int SessionAlsaCompress::setTKV(Stream * s __unused, configType type, effect_pal
                 goto exit;
             }
             tagCntrlName<<stream<<compressDevIds.at(0)<<" "<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -994,6 +1031,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, uint32_t tag1,
     struct mixer_ctl *ctl = nullptr;
     uint32_t tkv_size = 0;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG, "Enter");
     switch (type) {
         case MODULE:
@@ -1020,7 +1058,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, uint32_t tag1,
                 goto exit;
             }
             tagCntrlName << stream << compressDevIds.at(0) << " " << setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -1066,6 +1104,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
     int tkv_size = 0;
     int ckv_size = 0;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG, "Enter");
     status = s->getStreamAttributes(&sAttr);
     if (0 != status) {
@@ -1082,12 +1121,12 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
     if (compressDevIds.size() > 0)
         beCntrlName<<stream<<compressDevIds.at(0)<<" "<<setBEControl;
 
-    ctl = mixer_get_ctl_by_name(mixer, beCntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, beCntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", beCntrlName.str().data());
         return -ENOENT;
     }
-    mixer_ctl_set_enum_by_string(ctl, (sAttr.direction == PAL_AUDIO_OUTPUT) ?
+    ResourceManager::setMixerCtlEnum(ctl, (sAttr.direction == PAL_AUDIO_OUTPUT) ?
                                  rxAifBackEnds[0].second.data() : txAifBackEnds[0].second.data());
 
     switch (type) {
@@ -1118,7 +1157,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
             }
             //TODO: how to get the id '5'
             tagCntrlName<<stream<<compressDevIds.at(0)<<" "<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 return -ENOENT;
@@ -1157,7 +1196,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
             status = SessionAlsaUtils::getCalMetadata(ckv, calConfig);
             //TODO: how to get the id '0'
             calCntrlName<<stream<<compressDevIds.at(0)<<" "<<setCalibrationControl;
-            ctl = mixer_get_ctl_by_name(mixer, calCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, calCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", calCntrlName.str().data());
                 return -ENOENT;
@@ -1248,6 +1287,7 @@ int SessionAlsaCompress::start(Stream * s)
     memset(&streamData, 0, sizeof(struct sessionToPayloadParam));
 
     PAL_DBG(LOG_TAG, "Enter");
+    invalidateMIIDCache();
 
     rm->voteSleepMonitor(s, true);
     s->getStreamAttributes(&sAttr);
@@ -1256,8 +1296,8 @@ int SessionAlsaCompress::start(Stream * s)
 
     switch (sAttr.direction) {
         case PAL_AUDIO_OUTPUT:
-            /** create an offload thread for posting callbacks */
-            worker_thread = std::make_unique<std::thread>(offloadThreadLoop, this);
+            isDrainCalled = false;
+            offloadRet = 0;
             compress_config.fragment_size = out_buf_size;
             compress_config.fragments = out_buf_count;
             compress_config.codec = &codec;
@@ -1496,6 +1536,7 @@ int SessionAlsaCompress::stop(Stream * s __unused)
     struct agm_event_reg_cfg event_cfg;
     struct pal_stream_attributes sAttr;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG, "Enter");
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
@@ -1549,6 +1590,8 @@ int SessionAlsaCompress::close(Stream * s)
     std::vector<std::pair<std::string, int>> freeDeviceMetadata;
     int32_t beDevId = 0;
 
+    invalidateMIIDCache();
+    volumeRampSet = false;
     PAL_DBG(LOG_TAG, "Enter");
 
     s->getStreamAttributes(&sAttr);
@@ -1581,27 +1624,21 @@ int SessionAlsaCompress::close(Stream * s)
         PAL_ERR(LOG_TAG, "session alsa close failed with %d", status);
     }
     if (compress) {
+        if (rm->cardState == CARD_STATUS_OFFLINE)
+            postOffloadCmd(OFFLOAD_CMD_ERROR);
+
+        /*
+         * posted commands use the handle, let them finish before closing it.
+         * After SSR or a failed stop nothing wakes them: waits give up on
+         * offloadClosing within a slice, a stop wakes a drain. The stop just
+         * fails if stop() already stopped the stream.
+         */
+        offloadClosing = true;
+        if (compress_stop(compress))
+            PAL_VERBOSE(LOG_TAG, "compress_stop before close: %s",
+                        compress_get_error(compress));
+        PalTaskPool::getInstance()->drain(this);
         compress_close(compress);
-        if (rm->cardState == CARD_STATUS_OFFLINE) {
-            std::shared_ptr<offload_msg> msg = std::make_shared<offload_msg>(OFFLOAD_CMD_ERROR);
-            std::lock_guard<std::mutex> lock(cv_mutex_);
-            msg_queue_.push(msg);
-            cv_.notify_all();
-        }
-        {
-            std::shared_ptr<offload_msg> msg = std::make_shared<offload_msg>(OFFLOAD_CMD_EXIT);
-            std::lock_guard<std::mutex> lock(cv_mutex_);
-            msg_queue_.push(msg);
-            cv_.notify_all();
-        }
-
-        /* wait for handler to exit */
-        worker_thread->join();
-        worker_thread.reset(NULL);
-
-        /* empty the pending messages in queue */
-        while (!msg_queue_.empty())
-            msg_queue_.pop();
     }
     PAL_DBG(LOG_TAG, "out of compress close");
 
@@ -1722,11 +1759,7 @@ int SessionAlsaCompress::write(Stream *s __unused, int tag __unused, struct pal_
 
     if (bytes_written >= 0 && bytes_written < (ssize_t)buf->size && non_blocking) {
         PAL_DBG(LOG_TAG, "No space available in compress driver, post msg to cb thread");
-        std::shared_ptr<offload_msg> msg = std::make_shared<offload_msg>(OFFLOAD_CMD_WAIT_FOR_BUFFER);
-        std::lock_guard<std::mutex> lock(cv_mutex_);
-        msg_queue_.push(msg);
-
-        cv_.notify_all();
+        postOffloadCmd(OFFLOAD_CMD_WAIT_FOR_BUFFER);
     }
 
     if (!playback_started && bytes_written > 0) {
@@ -1764,7 +1797,7 @@ struct mixer_ctl* SessionAlsaCompress::getFEMixerCtl(const char *controlName, in
 
     *device = compressDevIds.at(0);
     CntrlName << "COMPRESS" << compressDevIds.at(0) << " " << controlName;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         return nullptr;
@@ -1778,9 +1811,9 @@ uint32_t SessionAlsaCompress::getMIID(const char *backendName, uint32_t tagId, u
     int status = 0;
     int device = compressDevIds.at(0);
 
-    status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                   backendName,
-                                                   tagId, miid);
+    status = getCachedMIID(mixer, device,
+                           backendName,
+                           tagId, miid);
     if (0 != status)
         PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
 
@@ -1817,9 +1850,9 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
             pal_effect_custom_payload_t *customPayload;
             param_payload = (pal_param_payload *)payload;
             effectPalPayload = (effect_pal_payload_t *)(param_payload->payload);
-            status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                           rxAifBackEnds[0].second.data(),
-                                                           tagId, &miid);
+            status = getCachedMIID(mixer, device,
+                                   rxAifBackEnds[0].second.data(),
+                                   tagId, &miid);
             if (0 != status) {
                 PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
                 break;
@@ -1846,7 +1879,7 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
         case PAL_PARAM_ID_BT_A2DP_TWS_CONFIG:
         {
             pal_bt_tws_payload *tws_payload = (pal_bt_tws_payload *)payload;
-            status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+            status = getCachedMIID(mixer, device,
                                rxAifBackEnds[0].second.data(), tagId, &miid);
             if (0 != status) {
                 PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
@@ -1866,7 +1899,7 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
         case PAL_PARAM_ID_BT_A2DP_LC3_CONFIG:
         {
             pal_bt_lc3_payload *lc3_payload = (pal_bt_lc3_payload *)payload;
-            status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+            status = getCachedMIID(mixer, device,
                                rxAifBackEnds[0].second.data(), tagId, &miid);
             if (0 != status) {
                 PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
@@ -1931,13 +1964,29 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
         }
         break;
         case PAL_PARAM_ID_VOLUME_USING_SET_PARAM:
+        case PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM:
         {
             pal_param_payload *param_payload = (pal_param_payload *)payload;
             pal_volume_data *vdata = (struct pal_volume_data *)param_payload->payload;
+            struct pal_volume_ramp_info *ramp = nullptr;
+            struct pal_volume_ramp_info noRamp = {0, PAL_VOLUME_RAMP_LINEAR};
+            PayloadWriter volWriter;
+            PayloadWriter rampWriter;
+            uint8_t *rampData = NULL;
+            size_t rampSize = 0;
+
+            if (param_id == PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM) {
+                ramp = (struct pal_volume_ramp_info *)param_payload->payload;
+                vdata = (struct pal_volume_data *)(param_payload->payload +
+                        sizeof(struct pal_volume_ramp_info));
+            }
+            /* the module keeps the last ramp, so clear it for a plain volume */
+            if (!ramp && volumeRampSet)
+                ramp = &noRamp;
             status = streamHandle->getStreamAttributes(&sAttr);
             if (sAttr.direction == PAL_AUDIO_OUTPUT) {
                 device = compressDevIds.at(0);
-                status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+                status = getCachedMIID(mixer, device,
                         rxAifBackEnds[0].second.data(), TAG_STREAM_VOLUME, &miid);
             } else {
                 status = 0;
@@ -1951,16 +2000,34 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
             }
 
             if (vdata->no_of_volpair == 2 && sAttr.out_media_config.ch_info.channels == 2) {
-                builder->payloadMultichVolumemConfig(&alsaParamData, &alsaPayloadSize, miid, vdata);
+                builder->payloadMultichVolumemConfig(&alsaParamData, &alsaPayloadSize, miid, vdata,
+                                                     &volWriter);
             } else {
-                builder->payloadVolumeConfig(&alsaParamData, &alsaPayloadSize, miid, vdata);
+                builder->payloadVolumeConfig(&alsaParamData, &alsaPayloadSize, miid, vdata,
+                                             &volWriter);
+            }
+
+            /* ramp and target gain go down in a single set param */
+            if (ramp && alsaPayloadSize) {
+                builder->payloadVolumeRampConfig(&rampData, &rampSize, miid, ramp,
+                                                 alsaParamData, alsaPayloadSize, &rampWriter);
+                volWriter.release(alsaParamData);
+                alsaParamData = rampData;
+                alsaPayloadSize = rampSize;
             }
 
             if (alsaPayloadSize) {
                 status = SessionAlsaUtils::setMixerParameter(mixer, device,
                                                alsaParamData, alsaPayloadSize);
                 PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
-                freeCustomPayload(&alsaParamData, &alsaPayloadSize);
+                if (!status)
+                    volumeRampSet = ramp && ramp->duration_ms;
+                if (ramp)
+                    rampWriter.release(alsaParamData);
+                else
+                    volWriter.release(alsaParamData);
+                alsaParamData = NULL;
+                alsaPayloadSize = 0;
             }
             break;
         }
@@ -2000,8 +2067,6 @@ int SessionAlsaCompress::flush()
 
 int SessionAlsaCompress::drain(pal_drain_type_t type)
 {
-    std::shared_ptr<offload_msg> msg;
-
     if (!compress) {
        PAL_ERR(LOG_TAG, "compress is invalid");
        return -EINVAL;
@@ -2011,22 +2076,12 @@ int SessionAlsaCompress::drain(pal_drain_type_t type)
 
     switch (type) {
     case PAL_DRAIN:
-    {
-        msg = std::make_shared<offload_msg>(OFFLOAD_CMD_DRAIN);
-        std::lock_guard<std::mutex> drain_lock(cv_mutex_);
-        msg_queue_.push(msg);
-        cv_.notify_all();
-    }
-    break;
+        postOffloadCmd(OFFLOAD_CMD_DRAIN);
+        break;
 
     case PAL_DRAIN_PARTIAL:
-    {
-        msg = std::make_shared<offload_msg>(OFFLOAD_CMD_PARTIAL_DRAIN);
-        std::lock_guard<std::mutex> partial_lock(cv_mutex_);
-        msg_queue_.push(msg);
-        cv_.notify_all();
-    }
-    break;
+        postOffloadCmd(OFFLOAD_CMD_PARTIAL_DRAIN);
+        break;
 
     default:
         PAL_ERR(LOG_TAG, "invalid drain type = %d", type);
@@ -2061,6 +2116,7 @@ int SessionAlsaCompress::setECRef(Stream *s __unused, std::shared_ptr<Device> rx
     struct pal_device rxDevAttr = {};
     struct pal_device_info rxDevInfo = {};
     PAL_DBG(LOG_TAG, "Enter");
+    invalidateMIIDCache();
     if (!s) {
         PAL_ERR(LOG_TAG, "Invalid stream or rx device");
         status = -EINVAL;
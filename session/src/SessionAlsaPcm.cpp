@@ -68,6 +68,7 @@
 #include "SessionAlsaUtils.h"
 #include "Stream.h"
 #include "ResourceManager.h"
+#include "PalIoReactor.h"
 #include "detection_cmn_api.h"
 #include "acd_api.h"
 #include <agm/agm_api.h>
@@ -125,6 +126,7 @@ int SessionAlsaPcm::open(Stream * s)
     int ldir = 0;
     std::vector<int> pcmId;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG, "Enter");
     status = s->getStreamAttributes(&sAttr);
     streamHandle = s;
@@ -273,6 +275,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, uint32_t tag1,
     struct mixer_ctl *ctl = nullptr;
     uint32_t tkv_size = 0;
     PAL_DBG(LOG_TAG, "Enter tags: %d %d %d", tag1, tag2, tag3);
+    invalidateMIIDCache();
     switch (type) {
         case MODULE:
             tkv.clear();
@@ -304,7 +307,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, uint32_t tag1,
                 status = -EINVAL;
                 goto exit;
             }
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 return -ENOENT;
@@ -344,7 +347,7 @@ struct mixer_ctl* SessionAlsaPcm::getFEMixerCtl(const char *controlName, int *de
 
     *device = pcmDevIds.at(0);
     CntrlName << "PCM" <<pcmDevIds.at(0) << " " << controlName;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         return nullptr;
@@ -426,10 +429,10 @@ uint32_t SessionAlsaPcm::getMIID(const char *backendName, uint32_t tagId, uint32
     }
     /* REPLACE THIS WITH STORED INFO DURING INITIAL SETUP */
     if (backendName) {
-        status = SessionAlsaUtils::getModuleInstanceId(mixer,
+        status = getCachedMIID(mixer,
             device, backendName, tagId, miid);
     } else {
-        status = SessionAlsaUtils::getModuleInstanceId(mixer,
+        status = getCachedMIID(mixer,
             device, txAifBackEnds[0].second.data(), tagId, miid);
     }
 
@@ -458,6 +461,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
     int tag_config_size = 0;
     int cal_config_size = 0;
 
+    invalidateMIIDCache();
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
         PAL_ERR(LOG_TAG, "stream get attributes failed");
@@ -481,12 +485,12 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 beCntrlName << stream << pcmDevIds.at(0) << " " << setBEControl;
         }
 
-        ctl = mixer_get_ctl_by_name(mixer, beCntrlName.str().data());
+        ctl = ResourceManager::getMixerCtl(mixer, beCntrlName.str().data());
         if (!ctl) {
             PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", beCntrlName.str().data());
             return -ENOENT;
         }
-        mixer_ctl_set_enum_by_string(ctl, (sAttr.direction == PAL_AUDIO_INPUT) ?
+        ResourceManager::setMixerCtlEnum(ctl, (sAttr.direction == PAL_AUDIO_INPUT) ?
                                      txAifBackEnds[0].second.data() : rxAifBackEnds[0].second.data());
     }
 
@@ -532,7 +536,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 goto exit;
             }
 
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -582,7 +586,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 goto exit;
             }
 
-            ctl = mixer_get_ctl_by_name(mixer, calCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, calCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", calCntrlName.str().data());
                 status = -ENOENT;
@@ -659,19 +663,19 @@ int SessionAlsaPcm::setTKV(Stream * s, configType type, effect_pal_payload_t *ef
             status = -EINVAL;
             if (sAttr.direction == PAL_AUDIO_OUTPUT) {
                 if (pcmDevIds.size() && rxAifBackEnds.size())
-                    status = SessionAlsaUtils::getModuleInstanceId(mixer,
+                    status = getCachedMIID(mixer,
                         pcmDevIds.at(0), rxAifBackEnds[0].second.data(), tagsent, &miid);
             } else if (sAttr.direction == PAL_AUDIO_INPUT) {
                 if (pcmDevIds.size() && txAifBackEnds.size())
-                    status = SessionAlsaUtils::getModuleInstanceId(mixer,
+                    status = getCachedMIID(mixer,
                         pcmDevIds.at(0), txAifBackEnds[0].second.data(), tagsent, &miid);
             } else if (sAttr.direction == (PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT)) {
                 if (pcmDevRxIds.size() && rxAifBackEnds.size()) {
-                    status = SessionAlsaUtils::getModuleInstanceId(mixer, pcmDevRxIds.at(0),
+                    status = getCachedMIID(mixer, pcmDevRxIds.at(0),
                             rxAifBackEnds[0].second.data(), tagsent, &miid);
                     if (status) {
                         if (pcmDevTxIds.size() && txAifBackEnds.size())
-                            status = SessionAlsaUtils::getModuleInstanceId(mixer,
+                            status = getCachedMIID(mixer,
                                 pcmDevTxIds.at(0), txAifBackEnds[0].second.data(), tagsent, &miid);
                     }
                 }
@@ -699,7 +703,7 @@ int SessionAlsaPcm::setTKV(Stream * s, configType type, effect_pal_payload_t *ef
                 goto exit;
             }
 
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -814,9 +818,16 @@ int SessionAlsaPcm::start(Stream * s)
     struct volume_set_param_info vol_set_param_info;
     uint16_t volSize = 0;
     uint8_t *volPayload = nullptr;
+    pal_stream_callback clientCb = NULL;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG, "Enter");
 
+    if (isNonBlocking) {
+        std::lock_guard<std::mutex> lock(ioArmLock);
+        ioArmBlocked = false;
+    }
+    pcmWoken = false;
     rm->voteSleepMonitor(s, true);
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
@@ -848,6 +859,17 @@ int SessionAlsaPcm::start(Stream * s)
         config.start_threshold = 0;
         config.stop_threshold = 0;
         config.silence_threshold = 0;
+        /*
+         * Readiness is only reported through the client callback, so clients
+         * that set the flag without one keep the blocking path they had.
+         * A short transfer is only reported by the pcm_readi/pcm_writei of
+         * tinyalsa 2.x, other tinyalsa builds always block.
+         */
+#ifdef TINYALSA_PCM_FRAMES_API
+        isNonBlocking = !SessionAlsaUtils::isMmapUsecase(sAttr) &&
+                (sAttr.flags & PAL_STREAM_FLAG_NON_BLOCKING_MASK) &&
+                s->getCallBack(&clientCb) == 0 && clientCb;
+#endif
 
         switch(sAttr.direction) {
             case PAL_AUDIO_INPUT:
@@ -865,7 +887,8 @@ int SessionAlsaPcm::start(Stream * s)
                     pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
                         PCM_IN |PCM_MMAP| PCM_NOIRQ, &config);
                 } else {
-                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0), PCM_IN, &config);
+                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
+                        PCM_IN | (isNonBlocking ? PCM_NONBLOCK : 0), &config);
                 }
 
                 if (!pcm) {
@@ -895,7 +918,8 @@ int SessionAlsaPcm::start(Stream * s)
                     pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
                         PCM_OUT |PCM_MMAP| PCM_NOIRQ, &config);
                 } else {
-                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0), PCM_OUT, &config);
+                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
+                        PCM_OUT | (isNonBlocking ? PCM_NONBLOCK : 0), &config);
                 }
 
                 if (!pcm) {
@@ -1416,6 +1440,9 @@ int SessionAlsaPcm::stop(Stream * s)
     int tagId;
     int DeviceId;
 
+    invalidateMIIDCache();
+    if (isNonBlocking)
+        PalIoReactor::getInstance()->disarm(this);
     PAL_DBG(LOG_TAG, "Enter");
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
@@ -1424,7 +1451,7 @@ int SessionAlsaPcm::stop(Stream * s)
     }
     switch (sAttr.direction) {
         case PAL_AUDIO_INPUT:
-            if (pcm && isActive()) {
+            if (pcm && isActive() && !pcmWoken) {
                 status = pcm_stop(pcm);
                 if (status) {
                     status = errno;
@@ -1433,7 +1460,7 @@ int SessionAlsaPcm::stop(Stream * s)
             }
         break;
         case PAL_AUDIO_OUTPUT:
-            if (pcm && isActive()) {
+            if (pcm && isActive() && !pcmWoken) {
                 status = pcm_stop(pcm);
                 if (status) {
                     status = errno;
@@ -1546,6 +1573,38 @@ exit:
     return status;
 }
 
+/*
+ * A pcm_write on a starved pcm sleeps in the driver until it times out.
+ * Dropping the pcm wakes it with an error, so stop does not wait that long
+ * for the data path. This is the stop of the pcm, stop() does not drop it
+ * a second time.
+ */
+void SessionAlsaPcm::wakeDataPath(Stream *s __unused)
+{
+    if (pcm && isActive() && !pcmWoken) {
+        if (pcm_stop(pcm))
+            PAL_ERR(LOG_TAG, "pcm_stop failed %d", errno);
+        pcmWoken = true;
+    }
+}
+
+/*
+ * The readiness handler calls the client, which typically writes or reads
+ * from the callback and so takes the stream lock. Streams cancel here
+ * before taking that lock on stop/close; once this returns nothing is
+ * armed and the disarm in stop() and close() does not wait anymore.
+ */
+void SessionAlsaPcm::cancelIoReady(Stream *s __unused)
+{
+    if (!isNonBlocking)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(ioArmLock);
+        ioArmBlocked = true;
+    }
+    PalIoReactor::getInstance()->disarm(this);
+}
+
 int SessionAlsaPcm::close(Stream * s)
 {
     int status = 0;
@@ -1558,6 +1617,10 @@ int SessionAlsaPcm::close(Stream * s)
     struct disable_lpm_info lpm_info;
     bool isStreamAvail = false;
 
+    invalidateMIIDCache();
+    volumeRampSet = false;
+    if (isNonBlocking)
+        PalIoReactor::getInstance()->disarm(this);
     PAL_DBG(LOG_TAG, "Enter");
     if (!frontEndIdAllocated) {
         PAL_DBG(LOG_TAG, "Session not opened or already closed");
@@ -1759,6 +1822,7 @@ int SessionAlsaPcm::disconnectSessionDevice(Stream *streamHandle,
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToDisconnect;
     int32_t status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToDisconnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToDisconnect,
             txAifBackEndsToDisconnect);
@@ -1818,6 +1882,7 @@ int SessionAlsaPcm::setupSessionDevice(Stream* streamHandle, pal_stream_type_t s
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToConnect;
     int32_t status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToConnect,
             txAifBackEndsToConnect);
@@ -1843,6 +1908,7 @@ int SessionAlsaPcm::connectSessionDevice(Stream* streamHandle, pal_stream_type_t
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToConnect;
     int32_t status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToConnect,
             txAifBackEndsToConnect);
@@ -1886,17 +1952,58 @@ int SessionAlsaPcm::connectSessionDevice(Stream* streamHandle, pal_stream_type_t
     return status;
 }
 
+void SessionAlsaPcm::armIoReady(short events, uint32_t eventId)
+{
+    int32_t status = 0;
+    std::lock_guard<std::mutex> lock(ioArmLock);
+
+    if (ioArmBlocked)
+        return;
+    status = PalIoReactor::getInstance()->arm(this, pcm_get_poll_fd(pcm), events,
+            [this, eventId](short revents __unused) {
+                if (sessionCb)
+                    sessionCb(cbCookie, eventId, NULL, 0);
+            });
+    if (status)
+        PAL_ERR(LOG_TAG, "failed to arm readiness event %u, status %d",
+                eventId, status);
+}
+
 int SessionAlsaPcm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int * size)
 {
     int status = 0, bytesRead = 0, bytesToRead = 0, offset = 0, pcmReadSize = 0;
-    struct pal_stream_attributes sAttr;
+    int frames = 0;
+    std::shared_ptr<const StreamHotInfo> info = s->getHotInfo();
 
     PAL_VERBOSE(LOG_TAG, "Enter")
-    status = s->getStreamAttributes(&sAttr);
-    if (status != 0) {
+    if (!info) {
         PAL_ERR(LOG_TAG, "stream get attributes failed");
-        return status;
+        return -EINVAL;
     }
+
+    /*
+     * Take whatever is captured already and ask the reactor to report
+     * PAL_STREAM_CBK_EVENT_READ_DONE once more data is available.
+     */
+#ifdef TINYALSA_PCM_FRAMES_API
+    if (isNonBlocking) {
+        bytesToRead = buf->size - buf->offset;
+        frames = pcm_readi(pcm, static_cast<char *>(buf->buffer) + buf->offset,
+                pcm_bytes_to_frames(pcm, bytesToRead));
+        /* pcm_readi returns the negative error, errno is not always set */
+        if (frames < 0 && frames != -EAGAIN) {
+            PAL_ERR(LOG_TAG, "Failed to read data %d", frames);
+            *size = 0;
+            return frames;
+        }
+        bytesRead = (frames > 0) ? pcm_frames_to_bytes(pcm, frames) : 0;
+        if (bytesRead < bytesToRead)
+            armIoReady(POLLIN, PAL_STREAM_CBK_EVENT_READ_DONE);
+        *size = bytesRead;
+        PAL_VERBOSE(LOG_TAG, "exit bytesRead:%d", bytesRead);
+        return bytesRead ? 0 : -EAGAIN;
+    }
+#endif
     while (1) {
         offset = bytesRead + buf->offset;
         bytesToRead = buf->size - offset;
@@ -1909,12 +2016,12 @@ int SessionAlsaPcm::read(Stream *s, int tag __unused, struct pal_buffer *buf, in
         void *data = buf->buffer;
         data = static_cast<char*>(data) + offset;
 
-        if(SessionAlsaUtils::isMmapUsecase(sAttr))
+        if (info->isMmap)
         {
             long ns = 0;
-            if (sAttr.in_media_config.sample_rate)
+            if (info->sampleRate)
                 ns = pcm_bytes_to_frames(pcm, pcmReadSize)*1000000000LL/
-                    sAttr.in_media_config.sample_rate;
+                    info->sampleRate;
             requestAdmFocus(s, ns);
             status =  pcm_mmap_read(pcm, data,  pcmReadSize);
             releaseAdmFocus(s);
@@ -1939,17 +2046,19 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
                           int flag)
 {
     int status = 0, bytesWritten = 0, bytesRemaining = 0, offset = 0;
+    int frames = 0;
     uint32_t sizeWritten = 0;
-    struct pal_stream_attributes sAttr;
+    std::shared_ptr<const StreamHotInfo> info = s->getHotInfo();
+    uint32_t sampleRate = 0;
 
 
     PAL_VERBOSE(LOG_TAG, "Enter buf:%p tag:%d flag:%d", buf, tag, flag);
 
-    status = s->getStreamAttributes(&sAttr);
-    if (status != 0) {
+    if (!info) {
         PAL_ERR(LOG_TAG, "stream get attributes failed");
-        return status;
+        return -EINVAL;
     }
+    sampleRate = info->sampleRate;
 
     if (pcm == NULL) {
         PAL_ERR(LOG_TAG, "PCM is NULL");
@@ -1960,6 +2069,41 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
 
     bytesRemaining = buf->size;
 
+    /*
+     * Hand the whole buffer to a single pcm_write, it only returns once the
+     * ring has taken every period, so a multi-period buffer costs one call.
+     */
+    if (!info->isMmap) {
+        data = static_cast<char *>(buf->buffer) + buf->offset;
+        /*
+         * Non-blocking streams queue what fits and ask the reactor to report
+         * PAL_STREAM_CBK_EVENT_WRITE_READY once the ring has room again.
+         */
+#ifdef TINYALSA_PCM_FRAMES_API
+        if (isNonBlocking) {
+            frames = pcm_writei(pcm, data, pcm_bytes_to_frames(pcm, bytesRemaining));
+            if (frames < 0 && frames != -EAGAIN) {
+                status = frames;
+                PAL_ERR(LOG_TAG, "Error! pcm_writei failed %d", status);
+                goto exit;
+            }
+            bytesWritten = (frames > 0) ? pcm_frames_to_bytes(pcm, frames) : 0;
+            if (bytesWritten < bytesRemaining)
+                armIoReady(POLLOUT, PAL_STREAM_CBK_EVENT_WRITE_READY);
+            *size = bytesWritten;
+            status = bytesWritten ? 0 : -EAGAIN;
+            goto exit;
+        }
+#endif
+        status = pcm_write(pcm, data, bytesRemaining);
+        if (status != 0) {
+            PAL_ERR(LOG_TAG, "Error! pcm_write failed");
+            goto exit;
+        }
+        *size = bytesRemaining;
+        goto exit;
+    }
+
     while ((bytesRemaining / out_buf_size) > 1) {
         offset = bytesWritten + buf->offset;
         data = buf->buffer;
@@ -1972,18 +2116,13 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
             goto exit;
         }
 
-        if (SessionAlsaUtils::isMmapUsecase(sAttr)) {
-            long ns = 0;
-            if (sAttr.out_media_config.sample_rate)
-                ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/
-                    sAttr.out_media_config.sample_rate;
-            PAL_DBG(LOG_TAG, "1.bufsize:%u ns:%ld", sizeWritten, ns);
-            requestAdmFocus(s, ns);
-            status =  pcm_mmap_write(pcm, data,  sizeWritten);
-            releaseAdmFocus(s);
-        } else {
-            status =  pcm_write(pcm, data,  sizeWritten);
-        }
+        long ns = 0;
+        if (sampleRate)
+            ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/sampleRate;
+        PAL_DBG(LOG_TAG, "1.bufsize:%u ns:%ld", sizeWritten, ns);
+        requestAdmFocus(s, ns);
+        status =  pcm_mmap_write(pcm, data,  sizeWritten);
+        releaseAdmFocus(s);
 
         if (0 != status) {
             PAL_ERR(LOG_TAG, "Failed to write the data");
@@ -2003,25 +2142,16 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
     }
 
     data = static_cast<char *>(data) + offset;
-    if (SessionAlsaUtils::isMmapUsecase(sAttr)) {
-        if (sizeWritten) {
-            long ns = 0;
-            if (sAttr.out_media_config.sample_rate)
-                ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/
-                    sAttr.out_media_config.sample_rate;
-            PAL_DBG(LOG_TAG, "2.bufsize:%u ns:%ld", sizeWritten, ns);
-            requestAdmFocus(s, ns);
-            status =  pcm_mmap_write(pcm, data,  sizeWritten);
-            releaseAdmFocus(s);
-            if (status != 0) {
-                PAL_ERR(LOG_TAG, "Error! pcm_mmap_write failed");
-                goto exit;
-            }
-        }
-    } else {
-        status =  pcm_write(pcm, data,  sizeWritten);
+    if (sizeWritten) {
+        long ns = 0;
+        if (sampleRate)
+            ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/sampleRate;
+        PAL_DBG(LOG_TAG, "2.bufsize:%u ns:%ld", sizeWritten, ns);
+        requestAdmFocus(s, ns);
+        status =  pcm_mmap_write(pcm, data,  sizeWritten);
+        releaseAdmFocus(s);
         if (status != 0) {
-            PAL_ERR(LOG_TAG, "Error! pcm_write failed");
+            PAL_ERR(LOG_TAG, "Error! pcm_mmap_write failed");
             goto exit;
         }
     }
@@ -2139,26 +2269,26 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             }
 
             if (PAL_AUDIO_INPUT == sAttr.direction)
-                status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                               txAifBackEnds[0].second.data(),
-                                                               tagId, &miid);
+                status = getCachedMIID(mixer, device,
+                                       txAifBackEnds[0].second.data(),
+                                       tagId, &miid);
             else if (PAL_AUDIO_OUTPUT == sAttr.direction)
-                status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                               rxAifBackEnds[0].second.data(),
-                                                               tagId, &miid);
+                status = getCachedMIID(mixer, device,
+                                       rxAifBackEnds[0].second.data(),
+                                       tagId, &miid);
             else {
                 status = -EINVAL;
                 if (pcmDevRxIds.size() > 0) {
                     device = pcmDevRxIds.at(0);
-                    status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                                   rxAifBackEnds[0].second.data(),
-                                                                   tagId, &miid);
+                    status = getCachedMIID(mixer, device,
+                                           rxAifBackEnds[0].second.data(),
+                                           tagId, &miid);
                     if (status) {
                         if (pcmDevTxIds.size() > 0)
                             device = pcmDevTxIds.at(0);
-                        status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                                       txAifBackEnds[0].second.data(),
-                                                                       tagId, &miid);
+                        status = getCachedMIID(mixer, device,
+                                               txAifBackEnds[0].second.data(),
+                                               tagId, &miid);
                     }
                 }
             }
@@ -2187,7 +2317,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
         case PAL_PARAM_ID_BT_A2DP_TWS_CONFIG:
         {
             pal_bt_tws_payload *tws_payload = (pal_bt_tws_payload *)payload;
-            status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+            status = getCachedMIID(mixer, device,
                                rxAifBackEnds[0].second.data(), tagId, &miid);
             if (0 != status) {
                 PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
@@ -2207,7 +2337,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
         case PAL_PARAM_ID_BT_A2DP_LC3_CONFIG:
         {
             pal_bt_lc3_payload *lc3_payload = (pal_bt_lc3_payload *)payload;
-            status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+            status = getCachedMIID(mixer, device,
                                rxAifBackEnds[0].second.data(), tagId, &miid);
             if (0 != status) {
                 PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
@@ -2244,28 +2374,44 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             return 0;
         }
         case PAL_PARAM_ID_VOLUME_USING_SET_PARAM:
+        case PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM:
         {
             pal_param_payload *param_payload = (pal_param_payload *)payload;
             pal_volume_data *vdata = (struct pal_volume_data *)param_payload->payload;
+            struct pal_volume_ramp_info *ramp = nullptr;
+            struct pal_volume_ramp_info noRamp = {0, PAL_VOLUME_RAMP_LINEAR};
+            PayloadWriter volWriter;
+            PayloadWriter rampWriter;
+            uint8_t *rampData = NULL;
+            size_t rampSize = 0;
+
+            if (param_id == PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM) {
+                ramp = (struct pal_volume_ramp_info *)param_payload->payload;
+                vdata = (struct pal_volume_data *)(param_payload->payload +
+                        sizeof(struct pal_volume_ramp_info));
+            }
+            /* the module keeps the last ramp, so clear it for a plain volume */
+            if (!ramp && volumeRampSet)
+                ramp = &noRamp;
             status = streamHandle->getStreamAttributes(&sAttr);
             if (sAttr.direction == PAL_AUDIO_OUTPUT) {
-                status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+                status = getCachedMIID(mixer, device,
                         rxAifBackEnds[0].second.data(), TAG_STREAM_VOLUME, &miid);
             } else if (sAttr.direction == PAL_AUDIO_INPUT) {
-                status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+                status = getCachedMIID(mixer, device,
                         txAifBackEnds[0].second.data(), TAG_STREAM_VOLUME, &miid);
             } else if (sAttr.direction == (PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT)) {
                 status = -EINVAL;
                 if (pcmDevRxIds.size()) {
                     device = pcmDevRxIds.at(0);
-                    status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
+                    status = getCachedMIID(mixer, device,
                             rxAifBackEnds[0].second.data(), TAG_STREAM_VOLUME, &miid);
                     if (status) {
                         if (pcmDevTxIds.size() > 0)
                             device = pcmDevTxIds.at(0);
-                        status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                                       txAifBackEnds[0].second.data(),
-                                                                       tagId, &miid);
+                        status = getCachedMIID(mixer, device,
+                                               txAifBackEnds[0].second.data(),
+                                               tagId, &miid);
                     }
                 }
             } else {
@@ -2280,16 +2426,34 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             }
 
             if (vdata->no_of_volpair == 2 && sAttr.out_media_config.ch_info.channels == 2) {
-                builder->payloadMultichVolumemConfig(&paramData, &paramSize, miid, vdata);
+                builder->payloadMultichVolumemConfig(&paramData, &paramSize, miid, vdata,
+                                                     &volWriter);
             } else {
-                builder->payloadVolumeConfig(&paramData, &paramSize, miid, vdata);
+                builder->payloadVolumeConfig(&paramData, &paramSize, miid, vdata,
+                                             &volWriter);
+            }
+
+            /* ramp and target gain go down in a single set param */
+            if (ramp && paramSize) {
+                builder->payloadVolumeRampConfig(&rampData, &rampSize, miid, ramp,
+                                                 paramData, paramSize, &rampWriter);
+                volWriter.release(paramData);
+                paramData = rampData;
+                paramSize = rampSize;
             }
 
             if (paramSize) {
                 status = SessionAlsaUtils::setMixerParameter(mixer, device,
                                                paramData, paramSize);
                 PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
-                freeCustomPayload(&paramData, &paramSize);
+                if (!status)
+                    volumeRampSet = ramp && ramp->duration_ms;
+                if (ramp)
+                    rampWriter.release(paramData);
+                else
+                    volWriter.release(paramData);
+                paramData = NULL;
+                paramSize = 0;
             }
             return 0;
 
@@ -2363,6 +2527,7 @@ int SessionAlsaPcm::setECRef(Stream *s, std::shared_ptr<Device> rx_dev, bool is_
     std::vector <std::shared_ptr<Device>> tx_devs;
     std::shared_ptr<Device> ec_rx_dev = nullptr;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG, "Enter");
     if (!s) {
         PAL_ERR(LOG_TAG, "Invalid stream or rx device");
@@ -2547,7 +2712,7 @@ int SessionAlsaPcm::getParameters(Stream *s __unused, int tagId, uint32_t param_
         status = -EINVAL;
         goto exit;
     }
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         status = -ENOENT;
@@ -2555,14 +2720,14 @@ int SessionAlsaPcm::getParameters(Stream *s __unused, int tagId, uint32_t param_
     }
 
     if (!rxAifBackEnds.empty()) { /** search in RX GKV */
-        status = SessionAlsaUtils::getModuleInstanceId(mixer, device, rxAifBackEnds[0].second.data(),
+        status = getCachedMIID(mixer, device, rxAifBackEnds[0].second.data(),
                 tagId, &miid);
         if (status) /** if not found, reset miid to 0 again */
             miid = 0;
     }
 
     if (!txAifBackEnds.empty()) { /** search in TX GKV */
-        status = SessionAlsaUtils::getModuleInstanceId(mixer, device, txAifBackEnds[0].second.data(),
+        status = getCachedMIID(mixer, device, txAifBackEnds[0].second.data(),
                 tagId, &miid);
         if (status)
             miid = 0;
@@ -2876,7 +3041,7 @@ int SessionAlsaPcm::createMmapBuffer(Stream *s, int32_t min_size_frames,
 
 
         CntrlName << stream << pcmDevIds.at(0) << " " << control;
-        ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+        ctl = ResourceManager::getMixerCtl(mixer, CntrlName.str().data());
         if (!ctl) {
             PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
             status = -ENOENT;
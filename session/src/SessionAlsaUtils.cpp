@@ -86,6 +86,13 @@ struct agmMetaData {
         :buf(b),size(s) {}
 };
 
+#define AGM_METADATA_CACHE_MAX_ENTRIES 64
+
+std::mutex SessionAlsaUtils::mdCacheMutex;
+std::list<std::pair<std::string, AgmMetaDataBlob>> SessionAlsaUtils::mdCacheLru;
+std::unordered_map<std::string,
+    std::list<std::pair<std::string, AgmMetaDataBlob>>::iterator> SessionAlsaUtils::mdCacheIndex;
+
 SessionAlsaUtils::~SessionAlsaUtils()
 {
 
@@ -185,29 +192,23 @@ error:
 
 }
 
-void SessionAlsaUtils::getAgmMetaData(const std::vector <std::pair<int, int>> &kv,
-        const std::vector <std::pair<int, int>> &ckv, struct prop_data *propData,
-        struct agmMetaData &md)
+static uint32_t getAgmMetaDataSize(const std::vector <std::pair<int, int>> &kv,
+        const std::vector <std::pair<int, int>> &ckv, struct prop_data *propData)
 {
-    uint8_t *metaData = NULL;
-    uint8_t *ptr = NULL;
-    struct agm_key_value *kvPtr = NULL;
-    uint32_t mdSize = 0;
-
-    md.buf = nullptr;
-    md.size = 0;
-
     // kv/ckv/propData may be empty when clearing metadata, skip size check
-    mdSize = sizeof(uint32_t) * 4 +
+    uint32_t mdSize = sizeof(uint32_t) * 4 +
         ((kv.size() + ckv.size()) * sizeof(struct agm_key_value));
     if (propData)
         mdSize += sizeof(uint32_t) * propData->num_values;
+    return mdSize;
+}
 
-    metaData = (uint8_t*)calloc(1, mdSize);
-    if (!metaData) {
-        PAL_ERR(LOG_TAG, "Failed to allocate memory for agm meta data");
-        return;
-    }
+static void fillAgmMetaData(const std::vector <std::pair<int, int>> &kv,
+        const std::vector <std::pair<int, int>> &ckv, struct prop_data *propData,
+        uint8_t *metaData)
+{
+    uint8_t *ptr = NULL;
+    struct agm_key_value *kvPtr = NULL;
 
     // Fill in gkv part
     ptr = metaData;
@@ -239,10 +240,153 @@ void SessionAlsaUtils::getAgmMetaData(const std::vector <std::pair<int, int>> &k
         if (propData->num_values != 0)
             memcpy(ptr, (uint8_t *)propData->values, sizeof(uint32_t) * propData->num_values);
     }
+}
+
+void SessionAlsaUtils::getAgmMetaData(const std::vector <std::pair<int, int>> &kv,
+        const std::vector <std::pair<int, int>> &ckv, struct prop_data *propData,
+        struct agmMetaData &md)
+{
+    uint8_t *metaData = NULL;
+    uint32_t mdSize = 0;
+
+    md.buf = nullptr;
+    md.size = 0;
+
+    mdSize = getAgmMetaDataSize(kv, ckv, propData);
+    metaData = (uint8_t*)calloc(1, mdSize);
+    if (!metaData) {
+        PAL_ERR(LOG_TAG, "Failed to allocate memory for agm meta data");
+        return;
+    }
+
+    fillAgmMetaData(kv, ckv, propData, metaData);
     md.buf = metaData;
     md.size = mdSize;
 }
 
+AgmMetaDataBlob SessionAlsaUtils::makeAgmMetaData(const std::vector <std::pair<int, int>> &kv,
+        const std::vector <std::pair<int, int>> &ckv, struct prop_data *propData)
+{
+    std::shared_ptr<std::vector<uint8_t>> blob =
+        std::make_shared<std::vector<uint8_t>>(getAgmMetaDataSize(kv, ckv, propData));
+
+    fillAgmMetaData(kv, ckv, propData, blob->data());
+    return blob;
+}
+
+static void appendAgmMetaDataKey(std::string &key, uint32_t val)
+{
+    key.append((const char *)&val, sizeof(val));
+}
+
+static void appendAgmMetaDataKey(std::string &key, const std::string &val)
+{
+    appendAgmMetaDataKey(key, (uint32_t)val.size());
+    key.append(val);
+}
+
+/*
+ * Builds the cache key for the metadata that open() pushes for a stream.
+ * It has to cover every input the PayloadBuilder selectors and ckv helpers
+ * consult for the stream types allowed below, i.e. stream attributes,
+ * instance id, stream/devicePP selectors and the attributes of every
+ * associated device. Returns false when the stream must not be cached.
+ */
+bool SessionAlsaUtils::getAgmMetaDataKey(Stream *s, struct pal_stream_attributes &sAttr,
+        std::vector<std::shared_ptr<Device>> &associatedDevices, std::string &key)
+{
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    struct pal_device dAttr;
+    int instanceId = 0;
+
+    switch (sAttr.type) {
+        case PAL_STREAM_LOW_LATENCY:
+        case PAL_STREAM_DEEP_BUFFER:
+        case PAL_STREAM_COMPRESSED:
+        case PAL_STREAM_GENERIC:
+        case PAL_STREAM_RAW:
+        case PAL_STREAM_PCM_OFFLOAD:
+        case PAL_STREAM_ULTRA_LOW_LATENCY:
+        case PAL_STREAM_VOIP_RX:
+        case PAL_STREAM_VOIP_TX:
+            break;
+        default:
+            return false;
+    }
+
+    /* same id the INSTANCE selector resolves to, assigned once per stream */
+    instanceId = rm->getStreamInstanceID(s);
+    if (instanceId <= 0)
+        return false;
+
+    key.clear();
+    appendAgmMetaDataKey(key, sAttr.type);
+    appendAgmMetaDataKey(key, sAttr.direction);
+    appendAgmMetaDataKey(key, sAttr.flags);
+    appendAgmMetaDataKey(key, sAttr.out_media_config.sample_rate);
+    appendAgmMetaDataKey(key, sAttr.out_media_config.bit_width);
+    appendAgmMetaDataKey(key, sAttr.out_media_config.ch_info.channels);
+    appendAgmMetaDataKey(key, sAttr.out_media_config.aud_fmt_id);
+    appendAgmMetaDataKey(key, sAttr.in_media_config.ch_info.channels);
+    appendAgmMetaDataKey(key, instanceId);
+    appendAgmMetaDataKey(key, s->getSoundCardId());
+    appendAgmMetaDataKey(key, s->getStreamSelector());
+    appendAgmMetaDataKey(key, s->getDevicePPSelector());
+    appendAgmMetaDataKey(key, ResourceManager::isSpeakerProtectionEnabled |
+            ResourceManager::isHandsetProtectionEnabled << 1 |
+            ResourceManager::isRasEnabled << 2);
+
+    for (int i = 0; i < associatedDevices.size(); i++) {
+        memset(&dAttr, 0, sizeof(struct pal_device));
+        if (associatedDevices[i]->getDeviceAttributes(&dAttr))
+            return false;
+        appendAgmMetaDataKey(key, dAttr.id);
+        appendAgmMetaDataKey(key, dAttr.config.sample_rate);
+        appendAgmMetaDataKey(key, dAttr.config.bit_width);
+        appendAgmMetaDataKey(key, dAttr.config.ch_info.channels);
+        appendAgmMetaDataKey(key, std::string(dAttr.custom_config.custom_key));
+    }
+    return true;
+}
+
+AgmMetaDataBlob SessionAlsaUtils::lookupAgmMetaData(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mdCacheMutex);
+    auto it = mdCacheIndex.find(key);
+
+    if (it == mdCacheIndex.end())
+        return nullptr;
+    mdCacheLru.splice(mdCacheLru.begin(), mdCacheLru, it->second);
+    return it->second->second;
+}
+
+void SessionAlsaUtils::storeAgmMetaData(const std::string &key, AgmMetaDataBlob blob)
+{
+    std::lock_guard<std::mutex> lock(mdCacheMutex);
+    auto it = mdCacheIndex.find(key);
+
+    if (it != mdCacheIndex.end()) {
+        it->second->second = blob;
+        mdCacheLru.splice(mdCacheLru.begin(), mdCacheLru, it->second);
+        return;
+    }
+    mdCacheLru.emplace_front(key, blob);
+    mdCacheIndex[key] = mdCacheLru.begin();
+    if (mdCacheLru.size() > AGM_METADATA_CACHE_MAX_ENTRIES) {
+        mdCacheIndex.erase(mdCacheLru.back().first);
+        mdCacheLru.pop_back();
+    }
+}
+
+void SessionAlsaUtils::invalidateAgmMetaDataCache()
+{
+    std::lock_guard<std::mutex> lock(mdCacheMutex);
+
+    PAL_DBG(LOG_TAG, "dropping %zu cached metadata blobs", mdCacheLru.size());
+    mdCacheIndex.clear();
+    mdCacheLru.clear();
+}
+
 int SessionAlsaUtils::getTagMetadata(int32_t tagsent, std::vector <std::pair<int, int>> &tkv,
         struct agm_tag_config *tagConfig)
 {
@@ -297,25 +441,21 @@ bool SessionAlsaUtils::isMmapUsecase(struct pal_stream_attributes sAttr)
 
 struct mixer_ctl *SessionAlsaUtils::getStaticMixerControl(struct mixer *am, std::string name)
 {
-    std::ostringstream cntrlName;
-
-    cntrlName << name;
-    PAL_DBG(LOG_TAG, "mixer control name is %s", cntrlName.str().data());
+    PAL_DBG(LOG_TAG, "mixer control name is %s", name.c_str());
 
-    return mixer_get_ctl_by_name(am, cntrlName.str().data());
+    return ResourceManager::getMixerCtl(am, name);
 }
 
 struct mixer_ctl *SessionAlsaUtils::getFeMixerControl(struct mixer *am, std::string feName,
         uint32_t idx)
 {
-    std::ostringstream cntrlName;
     struct mixer_ctl *ctl = NULL;
 
-    cntrlName << feName << feCtrlNames[idx];
-    PAL_DBG(LOG_TAG, "mixer control %s", cntrlName.str().data());
-    ctl = mixer_get_ctl_by_name(am, cntrlName.str().data());
+    feName += feCtrlNames[idx];
+    PAL_DBG(LOG_TAG, "mixer control %s", feName.c_str());
+    ctl = ResourceManager::getMixerCtl(am, feName);
     if (!ctl)
-        PAL_FATAL(LOG_TAG, "invalid mixer control: %s", cntrlName.str().data());
+        PAL_FATAL(LOG_TAG, "invalid mixer control: %s", feName.c_str());
 
     return ctl;
 }
@@ -323,11 +463,9 @@ struct mixer_ctl *SessionAlsaUtils::getFeMixerControl(struct mixer *am, std::str
 struct mixer_ctl *SessionAlsaUtils::getBeMixerControl(struct mixer *am, std::string beName,
         uint32_t idx)
 {
-    std::ostringstream cntrlName;
-
-    cntrlName << beName << beCtrlNames[idx];
-    PAL_DBG(LOG_TAG, "mixer control %s", cntrlName.str().data());
-    return mixer_get_ctl_by_name(am, cntrlName.str().data());
+    beName += beCtrlNames[idx];
+    PAL_DBG(LOG_TAG, "mixer control %s", beName.c_str());
+    return ResourceManager::getMixerCtl(am, beName);
 }
 
 int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManager> rmHandle,
@@ -342,9 +480,13 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
     std::vector <std::pair<int, int>> emptyKV;
     int status = 0;
     struct pal_stream_attributes sAttr;
-    struct agmMetaData streamMetaData(nullptr, 0);
-    struct agmMetaData deviceMetaData(nullptr, 0);
-    struct agmMetaData streamDeviceMetaData(nullptr, 0);
+    AgmMetaDataBlob streamMetaData;
+    AgmMetaDataBlob deviceMetaData;
+    AgmMetaDataBlob streamDeviceMetaData;
+    std::string mdKey;
+    bool mdCacheable = false;
+    bool beCacheable = false;
+    std::string beKey;
     std::ostringstream feName;
     struct mixer_ctl *feMixerCtrls[FE_MAX_NUM_MIXER_CONTROLS] = { nullptr };
     struct mixer_ctl *beMetaDataMixerCtrl = nullptr;
@@ -377,29 +519,33 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
     }
 
     builder = new PayloadBuilder();
-    // get streamKV
-    if ((status = builder->populateStreamKV(streamHandle, streamKV)) != 0) {
-        PAL_ERR(LOG_TAG, "get stream KV failed %d", status);
-        goto exit;
-    }
-    if (sAttr.type != PAL_STREAM_ACD &&
-        sAttr.type != PAL_STREAM_CONTEXT_PROXY &&
-        sAttr.type != PAL_STREAM_SENSOR_PCM_DATA) {
-        status = builder->populateStreamCkv(streamHandle, streamCKV, 0,
-                (struct pal_volume_data **)nullptr);
-        if (status) {
-            PAL_ERR(LOG_TAG, "get stream ckv failed %d", status);
+    /* resolved metadata only depends on the key inputs, reuse it across opens */
+    mdCacheable = getAgmMetaDataKey(streamHandle, sAttr, associatedDevices, mdKey);
+    if (mdCacheable)
+        streamMetaData = lookupAgmMetaData(mdKey + 'S');
+    if (!streamMetaData) {
+        // get streamKV
+        if ((status = builder->populateStreamKV(streamHandle, streamKV)) != 0) {
+            PAL_ERR(LOG_TAG, "get stream KV failed %d", status);
             goto exit;
         }
-    }
-    if ((streamKV.size() > 0) || (streamCKV.size() > 0)) {
-        getAgmMetaData(streamKV, streamCKV, (struct prop_data *)streamPropId,
-                streamMetaData);
-        if (!streamMetaData.size) {
-            PAL_ERR(LOG_TAG, "stream metadata is zero");
-            status = -ENOMEM;
-            goto exit;
+        if (sAttr.type != PAL_STREAM_ACD &&
+            sAttr.type != PAL_STREAM_CONTEXT_PROXY &&
+            sAttr.type != PAL_STREAM_SENSOR_PCM_DATA) {
+            status = builder->populateStreamCkv(streamHandle, streamCKV, 0,
+                    (struct pal_volume_data **)nullptr);
+            if (status) {
+                PAL_ERR(LOG_TAG, "get stream ckv failed %d", status);
+                goto exit;
+            }
         }
+        if ((streamKV.size() > 0) || (streamCKV.size() > 0))
+            streamMetaData = makeAgmMetaData(streamKV, streamCKV,
+                    (struct prop_data *)streamPropId);
+        else
+            streamMetaData = std::make_shared<std::vector<uint8_t>>();
+        if (mdCacheable)
+            storeAgmMetaData(mdKey + 'S', streamMetaData);
     }
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
 
@@ -415,100 +561,115 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
             PAL_ERR(LOG_TAG, "invalid mixer control: %s%s", feName.str().data(),
                    feCtrlNames[i]);
             status = -EINVAL;
-            goto freeStreamMetaData;
+            goto exit;
         }
     }
-    mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL], "ZERO");
-    if (streamMetaData.size)
-        mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void *)streamMetaData.buf,
-                streamMetaData.size);
+    ResourceManager::setMixerCtlEnum(feMixerCtrls[FE_CONTROL], "ZERO");
+    if (streamMetaData->size())
+        mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void *)streamMetaData->data(),
+                streamMetaData->size());
 
     for (std::vector<std::pair<int32_t, std::string>>::const_iterator be = BackEnds.begin();
            be != BackEnds.end(); ++be) {
-        if ((status = builder->populateDeviceKV(streamHandle, be->first, deviceKV)) != 0) {
-            PAL_ERR(LOG_TAG, "get device KV failed %d", status);
-            goto freeStreamMetaData;
+        /*
+         * Only single backend opens are cached since devicePPCKV accumulates
+         * across backends, and speaker/handset protection ckv is resolved
+         * from live stream state that is not part of the key.
+         */
+        beCacheable = mdCacheable && BackEnds.size() == 1 &&
+            getDeviceObj(be->first, associatedDevices) != nullptr &&
+            !(ResourceManager::isSpeakerProtectionEnabled &&
+              (be->first == PAL_DEVICE_OUT_SPEAKER ||
+               be->first == PAL_DEVICE_OUT_HANDSET));
+        if (beCacheable) {
+            beKey = mdKey;
+            beKey.append((const char *)&be->first, sizeof(be->first));
+            deviceMetaData = lookupAgmMetaData(beKey + 'D');
+            streamDeviceMetaData = lookupAgmMetaData(beKey + 'P');
         }
+        if (!deviceMetaData || !streamDeviceMetaData) {
+            if ((status = builder->populateDeviceKV(streamHandle, be->first, deviceKV)) != 0) {
+                PAL_ERR(LOG_TAG, "get device KV failed %d", status);
+                goto exit;
+            }
+
+            if (sAttr.direction == PAL_AUDIO_OUTPUT)
+                status = builder->populateDevicePPKV(streamHandle, be->first, streamDeviceKV, 0,
+                        emptyKV);
+            else {
+                for (i = 0; i < associatedDevices.size(); i++) {
+                    associatedDevices[i]->getDeviceAttributes(&dAttr);
+                    if (be->first == dAttr.id) {
+                        break;
+                    }
+                }
+                if (i >= associatedDevices.size() ) {
+                    PAL_ERR(LOG_TAG, "could not find associated device kv cannot be set");
 
-        if (sAttr.direction == PAL_AUDIO_OUTPUT)
-            status = builder->populateDevicePPKV(streamHandle, be->first, streamDeviceKV, 0,
-                    emptyKV);
-        else {
-            for (i = 0; i < associatedDevices.size(); i++) {
-                associatedDevices[i]->getDeviceAttributes(&dAttr);
-                if (be->first == dAttr.id) {
-                    break;
+                } else{
+                    rmHandle->getDeviceInfo((pal_device_id_t)be->first, sAttr.type,
+                                            dAttr.custom_config.custom_key, &devinfo);
                 }
+                status = builder->populateDevicePPKV(streamHandle, 0, emptyKV, be->first,
+                         streamDeviceKV);
+            }
+            if (status != 0) {
+                PAL_VERBOSE(LOG_TAG, "get device PP KV failed %d", status);
+                status = 0; /**< ignore device PP KV failures */
+            }
+            status = builder->populateDevicePPCkv(streamHandle, devicePPCKV);
+            if (status) {
+                PAL_ERR(LOG_TAG, "populateDevicePP Ckv failed %d", status);
+                status = 0; /**< ignore device PP CKV failures */
             }
-            if (i >= associatedDevices.size() ) {
-                PAL_ERR(LOG_TAG, "could not find associated device kv cannot be set");
 
-            } else{
-                rmHandle->getDeviceInfo((pal_device_id_t)be->first, sAttr.type,
-                                        dAttr.custom_config.custom_key, &devinfo);
+            status = builder->populateStreamDeviceKV(streamHandle, be->first, streamDeviceKV);
+            if (status) {
+                PAL_VERBOSE(LOG_TAG, "get stream device KV failed %d", status);
+                status = 0; /**< ignore stream device KV failures */
             }
-            status = builder->populateDevicePPKV(streamHandle, 0, emptyKV, be->first,
-                     streamDeviceKV);
-        }
-        if (status != 0) {
-            PAL_VERBOSE(LOG_TAG, "get device PP KV failed %d", status);
-            status = 0; /**< ignore device PP KV failures */
-        }
-        status = builder->populateDevicePPCkv(streamHandle, devicePPCKV);
-        if (status) {
-            PAL_ERR(LOG_TAG, "populateDevicePP Ckv failed %d", status);
-            status = 0; /**< ignore device PP CKV failures */
-        }
 
-        status = builder->populateStreamDeviceKV(streamHandle, be->first, streamDeviceKV);
-        if (status) {
-            PAL_VERBOSE(LOG_TAG, "get stream device KV failed %d", status);
-            status = 0; /**< ignore stream device KV failures */
-        }
+            deviceCKV.clear();
 
-        deviceCKV.clear();
+            if (ResourceManager::isSpeakerProtectionEnabled) {
+                PAL_DBG(LOG_TAG, "Speaker protection enabled");
+                if (be->first == PAL_DEVICE_OUT_SPEAKER) {
+                    status = builder->populateCalKeyVector(streamHandle, deviceCKV,
+                                    SPKR_PROT_ENABLE);
+                    if (status != 0) {
+                        PAL_VERBOSE(LOG_TAG, "Unable to populate SP cal");
+                        status = 0; /**< ignore device SP CKV failures */
+                    }
+                }
+            }
 
-        if (ResourceManager::isSpeakerProtectionEnabled) {
-            PAL_DBG(LOG_TAG, "Speaker protection enabled");
-            if (be->first == PAL_DEVICE_OUT_SPEAKER) {
-                status = builder->populateCalKeyVector(streamHandle, deviceCKV,
-                                SPKR_PROT_ENABLE);
+            if (ResourceManager::isHandsetProtectionEnabled &&
+                 ResourceManager::isSpeakerProtectionEnabled) {
+               PAL_DBG(LOG_TAG, "Handset enabled");
+               if (be->first == PAL_DEVICE_OUT_HANDSET) {
+                   status = builder->populateCalKeyVector(streamHandle, deviceCKV,
+                                HANDSET_PROT_ENABLE);
                 if (status != 0) {
                     PAL_VERBOSE(LOG_TAG, "Unable to populate SP cal");
                     status = 0; /**< ignore device SP CKV failures */
                 }
-            }
-        }
+             }
+          }
+            if (deviceKV.size() > 0)
+                deviceMetaData = makeAgmMetaData(deviceKV, deviceCKV,
+                        (struct prop_data *)devicePropId);
+            else
+                deviceMetaData = std::make_shared<std::vector<uint8_t>>();
 
-        if (ResourceManager::isHandsetProtectionEnabled &&
-             ResourceManager::isSpeakerProtectionEnabled) {
-           PAL_DBG(LOG_TAG, "Handset enabled");
-           if (be->first == PAL_DEVICE_OUT_HANDSET) {
-               status = builder->populateCalKeyVector(streamHandle, deviceCKV,
-                            HANDSET_PROT_ENABLE);
-            if (status != 0) {
-                PAL_VERBOSE(LOG_TAG, "Unable to populate SP cal");
-                status = 0; /**< ignore device SP CKV failures */
-            }
-         }
-      }
-        if (deviceKV.size() > 0) {
-            getAgmMetaData(deviceKV, deviceCKV, (struct prop_data *)devicePropId,
-                    deviceMetaData);
-            if (!deviceMetaData.size) {
-                PAL_ERR(LOG_TAG, "device metadata is zero");
-                status = -ENOMEM;
-                goto freeMetaData;
-            }
-        }
+            if (streamDeviceKV.size() > 0 || devicePPCKV.size() > 0)
+                streamDeviceMetaData = makeAgmMetaData(streamDeviceKV, devicePPCKV,
+                        (struct prop_data *)streamDevicePropId);
+            else
+                streamDeviceMetaData = std::make_shared<std::vector<uint8_t>>();
 
-        if (streamDeviceKV.size() > 0 || devicePPCKV.size() > 0) {
-            getAgmMetaData(streamDeviceKV, devicePPCKV, (struct prop_data *)streamDevicePropId,
-                    streamDeviceMetaData);
-            if (!streamDeviceMetaData.size) {
-                PAL_ERR(LOG_TAG, "stream/device metadata is zero");
-                status = -ENOMEM;
-                goto freeMetaData;
+            if (beCacheable) {
+                storeAgmMetaData(beKey + 'D', deviceMetaData);
+                storeAgmMetaData(beKey + 'P', streamDeviceMetaData);
             }
         }
         beMetaDataMixerCtrl = SessionAlsaUtils::getBeMixerControl(mixerHandle, be->second, BE_METADATA);
@@ -516,35 +677,25 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
             PAL_FATAL(LOG_TAG, "invalid mixer control: %s %s", be->second.data(),
                     beCtrlNames[BE_METADATA]);
             status = -EINVAL;
-            goto freeMetaData;
+            goto exit;
         }
 
         /** set mixer controls */
-        if (deviceMetaData.size)
-            mixer_ctl_set_array(beMetaDataMixerCtrl, (void *)deviceMetaData.buf,
-                    deviceMetaData.size);
-        mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL], be->second.data());
-        if (streamDeviceMetaData.size) {
-            mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void *)streamDeviceMetaData.buf,
-                    streamDeviceMetaData.size);
+        if (deviceMetaData->size())
+            mixer_ctl_set_array(beMetaDataMixerCtrl, (void *)deviceMetaData->data(),
+                    deviceMetaData->size());
+        ResourceManager::setMixerCtlEnum(feMixerCtrls[FE_CONTROL], be->second.data());
+        if (streamDeviceMetaData->size()) {
+            mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void *)streamDeviceMetaData->data(),
+                    streamDeviceMetaData->size());
         }
         mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONNECT], (be->second).data());
 
         deviceKV.clear();
         streamDeviceKV.clear();
-        free(streamDeviceMetaData.buf);
-        free(deviceMetaData.buf);
-        streamDeviceMetaData.buf = nullptr;
-        deviceMetaData.buf = nullptr;
+        deviceMetaData = nullptr;
+        streamDeviceMetaData = nullptr;
     }
-freeMetaData:
-    if (streamDeviceMetaData.buf)
-        free(streamDeviceMetaData.buf);
-    if (deviceMetaData.buf)
-        free(deviceMetaData.buf);
-freeStreamMetaData:
-    if (streamMetaData.buf)
-        free(streamMetaData.buf);
 exit:
     if(builder) {
        delete builder;
@@ -640,7 +791,7 @@ int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManag
             }
         }
 
-        mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL], be->second.data());
+        ResourceManager::setMixerCtlEnum(feMixerCtrls[FE_CONTROL], be->second.data());
         mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void *)streamDeviceMetaData.buf,
                 streamDeviceMetaData.size);
 
@@ -651,7 +802,7 @@ int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManag
     }
 
     // clear stream metadata
-    mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL], "ZERO");
+    ResourceManager::setMixerCtlEnum(feMixerCtrls[FE_CONTROL], "ZERO");
     getAgmMetaData(emptyKV, emptyKV, (struct prop_data *)streamPropId,
             streamMetaData);
     if (streamMetaData.size)
@@ -944,7 +1095,7 @@ int SessionAlsaUtils::setDeviceMediaConfig(std::shared_ptr<ResourceManager> rmHa
         aif_group_atrr_config[3] = AGM_DATA_FORMAT_FIXED_POINT;
         aif_group_atrr_config[4] = rmHandle->activeGroupDevConfig->grp_dev_hwep_cfg.slot_mask;
 
-        mixer_ctl_set_array(ctl, &aif_group_atrr_config,
+        ResourceManager::setMixerCtlArray(ctl, &aif_group_atrr_config,
                                sizeof(aif_group_atrr_config)/sizeof(aif_group_atrr_config[0]));
         PAL_INFO(LOG_TAG, "%s rate ch fmt data_fmt slot_mask %ld %ld %ld %ld %ld\n", truncatedBeName.c_str(),
                 aif_group_atrr_config[0], aif_group_atrr_config[1], aif_group_atrr_config[2],
@@ -962,7 +1113,7 @@ int SessionAlsaUtils::setDeviceMediaConfig(std::shared_ptr<ResourceManager> rmHa
                      aif_media_config[0], aif_media_config[1],
                      aif_media_config[2], aif_media_config[3]);
 
-    return mixer_ctl_set_array(ctl, &aif_media_config,
+    return ResourceManager::setMixerCtlArray(ctl, &aif_media_config,
                                sizeof(aif_media_config)/sizeof(aif_media_config[0]));
 }
 
@@ -991,7 +1142,7 @@ int SessionAlsaUtils::getTimestamp(struct mixer *mixer, const std::vector<int> &
         return -EINVAL;
     }
     CntrlName<<pcmDeviceName<<" "<<getParamControl;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = ResourceManager::getMixerCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         return -ENOENT;
@@ -1064,7 +1215,7 @@ int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
 
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -1148,7 +1299,7 @@ int SessionAlsaUtils::getTagsWithModuleInfo(struct mixer *mixer, int device, con
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
 
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -1180,9 +1331,10 @@ int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
 {
     char *pcmDeviceName = NULL;
     char const *control = "setParam";
-    char *mixer_str;
+    /* runs on every runtime param push, so build the name on the stack */
+    char mixer_str[128];
     struct mixer_ctl *ctl;
-    int ctl_len = 0,ret = 0;
+    int ret = 0;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
 
     pcmDeviceName = rm->getDeviceNameFromID(device);
@@ -1192,24 +1344,17 @@ int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
     }
 
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", pcmDeviceName);
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if (!mixer_str) {
-        return -ENOMEM;
-    }
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
+    snprintf(mixer_str, sizeof(mixer_str), "%s %s", pcmDeviceName, control);
 
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
         return ENOENT;
     }
     ret = mixer_ctl_set_array(ctl, payload, size);
 
     PAL_DBG(LOG_TAG, "ret = %d, cnt = %d\n", ret, size);
-    free(mixer_str);
     return ret;
 }
 
@@ -1236,14 +1381,14 @@ int SessionAlsaUtils::setStreamMetadataType(struct mixer *mixer, int device, con
     }
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
         return ENOENT;
     }
 
-    ret = mixer_ctl_set_enum_by_string(ctl, val);
+    ret = ResourceManager::setMixerCtlEnum(ctl, val);
     free(mixer_str);
     return ret;
 }
@@ -1290,7 +1435,7 @@ int SessionAlsaUtils::registerMixerEvent(struct mixer *mixer, int device, void *
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
 
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -1329,7 +1474,7 @@ int SessionAlsaUtils::setECRefPath(struct mixer *mixer, int device, const char *
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
 
     printf("%s mixer -%s-\n", __func__, mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         printf("Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -1366,7 +1511,7 @@ int SessionAlsaUtils::mixerWriteDatapathParams(struct mixer *mixer, int device,
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
 
     PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -1641,7 +1786,7 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
     txDevNum = !rxDevNum;
 
     /** set TX mixer controls */
-    mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_CONTROL], "ZERO");
+    ResourceManager::setMixerCtlEnum(txFeMixerCtrls[FE_CONTROL], "ZERO");
     if (streamTxMetaData.size)
         mixer_ctl_set_array(txFeMixerCtrls[FE_METADATA], (void *)streamTxMetaData.buf,
                 streamTxMetaData.size);
@@ -1649,14 +1794,14 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
         mixer_ctl_set_array(txBeMixerCtrl, (void *)deviceTxMetaData.buf,
                 deviceTxMetaData.size);
     if (streamDeviceTxMetaData.size) {
-        mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_CONTROL], txBackEnds[0].second.data());
+        ResourceManager::setMixerCtlEnum(txFeMixerCtrls[FE_CONTROL], txBackEnds[0].second.data());
         mixer_ctl_set_array(txFeMixerCtrls[FE_METADATA], (void *)streamDeviceTxMetaData.buf,
                 streamDeviceTxMetaData.size);
     }
     mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_CONNECT], txBackEnds[0].second.data());
 
     /** set RX mixer controls */
-    mixer_ctl_set_enum_by_string(rxFeMixerCtrls[FE_CONTROL], "ZERO");
+    ResourceManager::setMixerCtlEnum(rxFeMixerCtrls[FE_CONTROL], "ZERO");
     if (streamRxMetaData.size)
         mixer_ctl_set_array(rxFeMixerCtrls[FE_METADATA], (void *)streamRxMetaData.buf,
                 streamRxMetaData.size);
@@ -1664,7 +1809,7 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
         mixer_ctl_set_array(rxBeMixerCtrl, (void *)deviceRxMetaData.buf,
                 deviceRxMetaData.size);
     if (streamDeviceRxMetaData.size) {
-        mixer_ctl_set_enum_by_string(rxFeMixerCtrls[FE_CONTROL], rxBackEnds[0].second.data());
+        ResourceManager::setMixerCtlEnum(rxFeMixerCtrls[FE_CONTROL], rxBackEnds[0].second.data());
         mixer_ctl_set_array(rxFeMixerCtrls[FE_METADATA], (void *)streamDeviceRxMetaData.buf,
                 streamDeviceRxMetaData.size);
     }
@@ -1740,7 +1885,7 @@ int SessionAlsaUtils::openDev(std::shared_ptr<ResourceManager> rmHandle,
             goto freeMetaData;
         }
     }
-    mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL], "ZERO");
+    ResourceManager::setMixerCtlEnum(feMixerCtrls[FE_CONTROL], "ZERO");
 
     if ((status = builder->populateDeviceKV(NULL, backEndId, deviceKV)) != 0) {
         PAL_ERR(LOG_TAG, "get device KV failed %d", status);
@@ -1915,19 +2060,19 @@ int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManag
 
     /** set TX mixer controls */
     mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_DISCONNECT], txBackEnds[0].second.data());
-    mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_CONTROL], "ZERO");
+    ResourceManager::setMixerCtlEnum(txFeMixerCtrls[FE_CONTROL], "ZERO");
     mixer_ctl_set_array(txFeMixerCtrls[FE_METADATA], (void *)streamTxMetaData.buf,
             streamTxMetaData.size);
-    mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_CONTROL], txBackEnds[0].second.data());
+    ResourceManager::setMixerCtlEnum(txFeMixerCtrls[FE_CONTROL], txBackEnds[0].second.data());
     mixer_ctl_set_array(txFeMixerCtrls[FE_METADATA], (void *)streamDeviceTxMetaData.buf,
             streamDeviceTxMetaData.size);
 
     /** set RX mixer controls */
     mixer_ctl_set_enum_by_string(rxFeMixerCtrls[FE_DISCONNECT], rxBackEnds[0].second.data());
-    mixer_ctl_set_enum_by_string(rxFeMixerCtrls[FE_CONTROL], "ZERO");
+    ResourceManager::setMixerCtlEnum(rxFeMixerCtrls[FE_CONTROL], "ZERO");
     mixer_ctl_set_array(rxFeMixerCtrls[FE_METADATA], (void *)streamRxMetaData.buf,
             streamRxMetaData.size);
-    mixer_ctl_set_enum_by_string(rxFeMixerCtrls[FE_CONTROL], rxBackEnds[0].second.data());
+    ResourceManager::setMixerCtlEnum(rxFeMixerCtrls[FE_CONTROL], rxBackEnds[0].second.data());
     mixer_ctl_set_array(rxFeMixerCtrls[FE_METADATA], (void *)streamDeviceRxMetaData.buf,
             streamDeviceRxMetaData.size);
 
@@ -2022,7 +2167,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
             break;
     }
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
-    disconnectCtrl = mixer_get_ctl_by_name(mixerHandle, disconnectCtrlName.str().data());
+    disconnectCtrl = ResourceManager::getMixerCtl(mixerHandle, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", disconnectCtrlName.str().data());
         return -EINVAL;
@@ -2070,7 +2215,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
             deviceMetaData.size);
     }
 
-    mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL],
+    ResourceManager::setMixerCtlEnum(feMixerCtrls[FE_CONTROL],
         aifBackEndsToDisconnect[0].second.data());
     mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void*)streamDeviceMetaData.buf,
         streamDeviceMetaData.size);
@@ -2120,7 +2265,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
             break;
     }
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
-    disconnectCtrl = mixer_get_ctl_by_name(mixerHandle, disconnectCtrlName.str().data());
+    disconnectCtrl = ResourceManager::getMixerCtl(mixerHandle, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", disconnectCtrlName.str().data());
         return -EINVAL;
@@ -2259,7 +2404,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
          }
     }
 
-    connectCtrl = mixer_get_ctl_by_name(mixerHandle, connectCtrlName.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(mixerHandle, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         status = -EINVAL;
@@ -2329,7 +2474,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
         }
     }
 
-    connectCtrl = mixer_get_ctl_by_name(mixerHandle, connectCtrlName.str().data());
+    connectCtrl = ResourceManager::getMixerCtl(mixerHandle, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         status = -EINVAL;
@@ -2547,7 +2692,7 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
 
-    aifMdCtrl = mixer_get_ctl_by_name(mixerHandle, aifMdName.str().data());
+    aifMdCtrl = ResourceManager::getMixerCtl(mixerHandle, aifMdName.str().data());
     PAL_DBG(LOG_TAG, "mixer control %s", aifMdName.str().data());
     if (!aifMdCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", aifMdName.str().data());
@@ -2557,16 +2702,16 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
     if (deviceMetaData.size)
         mixer_ctl_set_array(aifMdCtrl, (void *)deviceMetaData.buf, deviceMetaData.size);
 
-    feCtrl = mixer_get_ctl_by_name(mixerHandle, cntrlName.str().data());
+    feCtrl = ResourceManager::getMixerCtl(mixerHandle, cntrlName.str().data());
     PAL_DBG(LOG_TAG, "mixer control %s", cntrlName.str().data());
     if (!feCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", cntrlName.str().data());
         status = -EINVAL;
         goto freeMetaData;
     }
-    mixer_ctl_set_enum_by_string(feCtrl, aifBackEndsToConnect[0].second.data());
+    ResourceManager::setMixerCtlEnum(feCtrl, aifBackEndsToConnect[0].second.data());
 
-    feMdCtrl = mixer_get_ctl_by_name(mixerHandle, feMdName.str().data());
+    feMdCtrl = ResourceManager::getMixerCtl(mixerHandle, feMdName.str().data());
     PAL_DBG(LOG_TAG, "mixer control %s", feMdName.str().data());
     if (!feMdCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", feMdName.str().data());
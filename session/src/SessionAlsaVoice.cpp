@@ -148,9 +148,9 @@ uint32_t SessionAlsaVoice::getMIID(const char *backendName, uint32_t tagId, uint
         return -EINVAL;
     }
 
-    status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
-                                                   backendName,
-                                                   tagId, miid);
+    status = getCachedMIID(mixer, device,
+                           backendName,
+                           tagId, miid);
     if (0 != status)
         PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", tagId, status);
 
@@ -169,6 +169,7 @@ int SessionAlsaVoice::open(Stream * s)
     struct pal_stream_attributes sAttr;
     std::vector<std::shared_ptr<Device>> associatedDevices;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG,"Enter");
     status = s->getStreamAttributes(&sAttr);
     streamHandle = s;
@@ -664,6 +665,7 @@ int SessionAlsaVoice::start(Stream * s)
     struct pal_volume_data *volume = NULL;
     bool isTxStarted = false, isRxStarted = false;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG,"Enter");
 
     rm->voteSleepMonitor(s, true);
@@ -870,6 +872,7 @@ int SessionAlsaVoice::stop(Stream * s)
     int txDevId = PAL_DEVICE_NONE;
     std::shared_ptr<Device> rxDevice = nullptr;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG,"Enter");
     /*disable sidetone*/
     if (sideTone_cnt > 0) {
@@ -919,6 +922,7 @@ int SessionAlsaVoice::close(Stream * s)
     std::vector<std::shared_ptr<Device>> associatedDevices;
     std::vector<std::pair<std::string, int>> freeDeviceMetadata;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG,"Enter");
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
@@ -1101,6 +1105,7 @@ int SessionAlsaVoice::setConfig(Stream * s, configType type, int tag)
     uint8_t* paramData = NULL;
     size_t paramSize = 0;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG,"Enter setConfig called with tag: %d ", tag);
 
     switch (static_cast<uint32_t>(tag)) {
@@ -1158,6 +1163,7 @@ int SessionAlsaVoice::setConfig(Stream * s, configType type __unused, int tag, i
     uint8_t* paramData = NULL;
     size_t paramSize = 0;
 
+    invalidateMIIDCache();
     PAL_DBG(LOG_TAG,"Enter setConfig called with tag: %d ", tag);
 
     switch (static_cast<uint32_t>(tag)) {
@@ -1287,7 +1293,7 @@ int SessionAlsaVoice::payloadTaged(Stream * s, configType type, int tag,
                 goto exit;
             }
             tagCntrlName<<stream<<" "<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = ResourceManager::getMixerCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 return -ENOENT;
@@ -1604,6 +1610,7 @@ int SessionAlsaVoice::disconnectSessionDevice(Stream *streamHandle,
     int status = 0;
     int txDevId = PAL_DEVICE_NONE;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToDisconnect);
     rm->getBackEndNames(deviceList, rxAifBackEnds,txAifBackEnds);
 
@@ -1660,6 +1667,7 @@ int SessionAlsaVoice::setupSessionDevice(Stream* streamHandle,
     struct pal_device dAttr;
     int status = 0;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEnds, txAifBackEnds);
     deviceToConnect->getDeviceAttributes(&dAttr);
@@ -1699,6 +1707,7 @@ int SessionAlsaVoice::connectSessionDevice(Stream* streamHandle,
     int status = 0;
     int txDevId = PAL_DEVICE_NONE;
 
+    invalidateMIIDCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEnds, txAifBackEnds);
     deviceToConnect->getDeviceAttributes(&dAttr);
@@ -1787,7 +1796,7 @@ int SessionAlsaVoice::setVoiceMixerParameter(Stream * s, struct mixer *mixer,
     snprintf(mixer_str, ctl_len, "%s %s", stream, control);
 
     PAL_VERBOSE(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = ResourceManager::getMixerCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -1930,9 +1939,9 @@ int SessionAlsaVoice::setPopSuppressorMute(Stream *s)
         goto exit;
     }
 
-    status = SessionAlsaUtils::getModuleInstanceId(mixer, pcmDevRxIds.at(0),
-                                                   rxAifBackEnds[0].second.c_str(),
-                                                   DEVICE_POP_SUPPRESSOR, &miid);
+    status = getCachedMIID(mixer, pcmDevRxIds.at(0),
+                           rxAifBackEnds[0].second.c_str(),
+                           DEVICE_POP_SUPPRESSOR, &miid);
     if (status != 0) {
         PAL_ERR(LOG_TAG,"getModuleInstanceId failed for Rx pop suppressor: 0x%x status: %d",
             DEVICE_POP_SUPPRESSOR, status);
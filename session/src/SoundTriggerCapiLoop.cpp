@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define ATRACE_TAG (ATRACE_TAG_AUDIO | ATRACE_TAG_HAL)
+#define LOG_TAG "PAL: SoundTriggerCapiLoop"
+
+#include "SoundTriggerCapiLoop.h"
+
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <cutils/trace.h>
+
+#include "PalCommon.h"
+
+static uint64_t ElapsedUs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void SoundTriggerCapiKwWindow(struct st_capi_loop_config *cfg,
+                              uint32_t kw_start, uint32_t kw_end,
+                              uint32_t before, uint32_t after, uint32_t align)
+{
+    cfg->start = kw_start > before ? kw_start - before : 0;
+    cfg->first_chunk = kw_end - cfg->start;
+    if (align)
+        cfg->first_chunk -= cfg->first_chunk % align;
+    cfg->end = kw_end + after;
+}
+
+void SoundTriggerCapiUvWindow(struct st_capi_loop_config *cfg,
+                              uint32_t kw_start, uint32_t kw_end,
+                              uint32_t before, uint32_t after)
+{
+    cfg->start = kw_start > before ? kw_start - before : 0;
+    cfg->end = kw_end + after;
+    cfg->first_chunk = cfg->end - cfg->start;
+    cfg->chunk = cfg->first_chunk;
+}
+
+int32_t SoundTriggerCapiLoop(const struct st_capi_loop_config *cfg,
+                             struct st_capi_loop_stats *stats,
+                             const std::function<bool()> &on_result)
+{
+    int32_t status = 0;
+    PalRingBufferReader *reader = cfg->reader;
+    capi_v2_t *capi = cfg->capi;
+    struct pal_ring_buffer_span span;
+    capi_v2_stream_data_t stream_input;
+    capi_v2_stream_data_t *stream_input_ptr = &stream_input;
+    capi_v2_buf_t stream_buf;
+    capi_v2_buf_t capi_result;
+    capi_v2_err_t rc = CAPI_V2_EOK;
+    std::chrono::steady_clock::time_point call_start;
+    uint32_t total = cfg->end - cfg->start;
+    uint32_t chunk = cfg->first_chunk;
+    bool buffer_advanced = cfg->start == 0;
+    char *process_data = nullptr;
+    size_t read_size = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!cfg->first_chunk || !cfg->chunk || cfg->start >= cfg->end) {
+        PAL_ERR(LOG_TAG, "Invalid window %u-%u, chunks %u/%u", cfg->start,
+                cfg->end, cfg->first_chunk, cfg->chunk);
+        return -EINVAL;
+    }
+    memset(&stream_input, 0, sizeof(stream_input));
+    memset(&stream_buf, 0, sizeof(stream_buf));
+    stream_input.buf_ptr = &stream_buf;
+
+    while (!cfg->exit->load() && stats->bytes_processed < total) {
+        if (!reader->isEnabled()) {
+            status = -EINVAL;
+            break;
+        }
+
+        /* skip to the start of the keyword once enough data is buffered */
+        if (!buffer_advanced) {
+            reader->waitForData(cfg->start, ST_CAPI_READ_WAIT_TIMEOUT_MS);
+            buffer_advanced = reader->advanceReadOffset(cfg->start) != 0;
+            continue;
+        }
+
+        call_start = std::chrono::steady_clock::now();
+        if (reader->waitForData(chunk, ST_CAPI_READ_WAIT_TIMEOUT_MS) < chunk) {
+            stats->stalls++;
+            stats->stall_us += ElapsedUs(call_start);
+            continue;
+        }
+
+        read_size = reader->peek(chunk, &span);
+        if (read_size == 0)
+            continue;
+
+        /* hand ring buffer memory to capi directly unless data wraps */
+        if (span.size[1] == 0) {
+            process_data = span.data[0];
+        } else {
+            ar_mem_cpy(cfg->wrap_buff, chunk, span.data[0], span.size[0]);
+            ar_mem_cpy(cfg->wrap_buff + span.size[0], chunk - span.size[0],
+                span.data[1], span.size[1]);
+            process_data = cfg->wrap_buff;
+        }
+
+        PAL_INFO(LOG_TAG, "Processed: %u, start: %u, end: %u",
+                 stats->bytes_processed, cfg->start, cfg->end);
+        stream_input.bufs_num = 1;
+        stream_buf.max_data_len = chunk;
+        stream_buf.actual_data_len = read_size;
+        stream_buf.data_ptr = (int8_t *)process_data;
+
+        if (cfg->dump_fd) {
+            fwrite(process_data, 1, read_size, cfg->dump_fd);
+            fflush(cfg->dump_fd);
+        }
+
+        call_start = std::chrono::steady_clock::now();
+        ATRACE_BEGIN(cfg->trace_name);
+        rc = capi->vtbl_ptr->process(capi, &stream_input_ptr, nullptr);
+        ATRACE_END();
+        stats->process_us += ElapsedUs(call_start);
+        /* releases the peeked span, a pending reader reset may go on now */
+        reader->advanceReadOffset(read_size);
+        if (CAPI_V2_EFAILED == rc) {
+            status = -EINVAL;
+            PAL_ERR(LOG_TAG, "capi process failed, status %d", status);
+            break;
+        }
+        stats->bytes_processed += read_size;
+
+        capi_result.data_ptr = (int8_t *)cfg->result;
+        capi_result.actual_data_len = cfg->result_size;
+        capi_result.max_data_len = cfg->result_size;
+        call_start = std::chrono::steady_clock::now();
+        rc = capi->vtbl_ptr->get_param(capi, cfg->result_param_id, nullptr,
+            &capi_result);
+        stats->get_param_us += ElapsedUs(call_start);
+        if (CAPI_V2_EFAILED == rc) {
+            status = -EINVAL;
+            PAL_ERR(LOG_TAG, "capi get param failed, status %d", status);
+            break;
+        }
+
+        if (on_result())
+            break;
+        chunk = cfg->chunk;
+    }
+
+    return status;
+}
@@ -39,93 +39,89 @@
 #include "StreamSoundTrigger.h"
 #include "Stream.h"
 #include "SoundTriggerPlatformInfo.h"
+#include "PalTaskPool.h"
+#include "SoundTriggerCapiLoop.h"
 
 ST_DBG_DECLARE(static int keyword_detection_cnt = 0);
 ST_DBG_DECLARE(static int user_verification_cnt = 0);
 
-void SoundTriggerEngineCapi::BufferThreadLoop(
+/*
+ * Runs on the shared PalTaskPool once per first stage detection. Each
+ * second stage engine posts under its own owner, so the KW and UV engines
+ * of a stream verify in parallel without parking a thread each for the
+ * lifetime of the sound model.
+ */
+void SoundTriggerEngineCapi::ProcessDetection(
     SoundTriggerEngineCapi *capi_engine)
 {
     StreamSoundTrigger *s = nullptr;
     int32_t status = 0;
     int32_t detection_state = ENGINE_IDLE;
+    int32_t reject_state = ENGINE_IDLE;
 
     PAL_DBG(LOG_TAG, "Enter");
-    if (!capi_engine) {
-        PAL_ERR(LOG_TAG, "Invalid sound trigger capi engine");
-        return;
+    std::unique_lock<std::mutex> lck(capi_engine->event_mutex_);
+    /*
+     * If 1st stage buffering overflows before 2nd stage starts processing,
+     * stop/restart may already have cleared processing_started_ or set
+     * exit_buffering_ by the time the pool runs this task.
+     */
+    if (!capi_engine->processing_started_ || capi_engine->exit_buffering_) {
+        PAL_DBG(LOG_TAG, "processing cancelled");
+        goto exit;
     }
 
-    std::unique_lock<std::mutex> lck(capi_engine->event_mutex_);
-    while (!capi_engine->exit_thread_) {
-        PAL_VERBOSE(LOG_TAG, "waiting on cond, processing started  = %d",
-                    capi_engine->processing_started_);
-        // Wait for keyword buffer data from DSP
-        if (!capi_engine->processing_started_)
-            capi_engine->cv_.wait(lck);
-        PAL_VERBOSE(LOG_TAG, "done waiting on cond, exit buffering = %d",
-                    capi_engine->exit_buffering_);
-
-        if (capi_engine->exit_thread_) {
-            break;
-        }
+    s = dynamic_cast<StreamSoundTrigger *>(capi_engine->stream_handle_);
+    capi_engine->bytes_processed_ = 0;
+    if (capi_engine->detection_type_ == ST_SM_TYPE_KEYWORD_DETECTION) {
+        status = capi_engine->StartKeywordDetection();
+        reject_state = KEYWORD_DETECTION_REJECT;
+    } else if (capi_engine->detection_type_ ==
+        ST_SM_TYPE_USER_VERIFICATION) {
+        status = capi_engine->StartUserVerification();
+        reject_state = USER_VERIFICATION_REJECT;
+    }
 
-        /*
-         * If 1st stage buffering overflows before 2nd stage starts processing,
-         * the below functions need to be called to reset the 1st stage session
-         * for the next detection. We might be able to check states of the engine
-         * to avoid this buffering flag.
-         */
-        if (capi_engine->exit_buffering_) {
-            continue;  // skip over processing if we want to exit already
-        }
+    /*
+     * StreamSoundTrigger may call stop recognition to second stage
+     * engines when one of the second stage engine reject detection.
+     * So check processing_started_ before notify stream in case
+     * stream has already stopped recognition. An engine aborted by
+     * its sibling's reject has no verdict to report.
+     */
+    if (reject_state != ENGINE_IDLE && capi_engine->processing_started_ &&
+        !capi_engine->aborted_) {
+        if (status)
+            detection_state = reject_state;
+        else
+            detection_state = capi_engine->detection_state_;
+        lck.unlock();
+        if (detection_state == reject_state)
+            s->AbortSecondStage(capi_engine);
+        s->SetEngineDetectionState(detection_state);
+        lck.lock();
+    }
 
-        if (capi_engine->processing_started_) {
-            s = dynamic_cast<StreamSoundTrigger *>(capi_engine->stream_handle_);
-            capi_engine->bytes_processed_ = 0;
-            if (capi_engine->detection_type_ ==
-                ST_SM_TYPE_KEYWORD_DETECTION) {
-                status = capi_engine->StartKeywordDetection();
-                /*
-                 * StreamSoundTrigger may call stop recognition to second stage
-                 * engines when one of the second stage engine reject detection.
-                 * So check processing_started_ before notify stream in case
-                 * stream has already stopped recognition.
-                 */
-                if (capi_engine->processing_started_) {
-                    if (status)
-                        detection_state = KEYWORD_DETECTION_REJECT;
-                    else
-                        detection_state = capi_engine->detection_state_;
-                    lck.unlock();
-                    s->SetEngineDetectionState(detection_state);
-                    lck.lock();
-                }
-            } else if (capi_engine->detection_type_ ==
-                ST_SM_TYPE_USER_VERIFICATION) {
-                status = capi_engine->StartUserVerification();
-                /*
-                 * StreamSoundTrigger may call stop recognition to second stage
-                 * engines when one of the second stage engine reject detection.
-                 * So check processing_started_ before notify stream in case
-                 * stream has already stopped recognition.
-                 */
-                if (capi_engine->processing_started_) {
-                    if (status)
-                        detection_state = USER_VERIFICATION_REJECT;
-                    else
-                        detection_state = capi_engine->detection_state_;
-                    lck.unlock();
-                    s->SetEngineDetectionState(detection_state);
-                    lck.lock();
-                }
-            }
-            capi_engine->detection_state_ = ENGINE_IDLE;
-            capi_engine->keyword_detected_ = false;
-            capi_engine->processing_started_ = false;
+exit:
+    /* clear on every exit, or the next SetDetected(true) reads as busy */
+    capi_engine->detection_state_ = ENGINE_IDLE;
+    capi_engine->keyword_detected_ = false;
+    capi_engine->processing_started_ = false;
+    PAL_DBG(LOG_TAG, "Exit");
+}
+
+char *SoundTriggerEngineCapi::GetProcessInputBuffer(size_t size)
+{
+    if (process_input_buff_.size() < size) {
+        try {
+            process_input_buff_.resize(size);
+        } catch (const std::bad_alloc &) {
+            PAL_ERR(LOG_TAG, "failed to grow process input buff to %zu", size);
+            return nullptr;
         }
     }
-    PAL_DBG(LOG_TAG, "Exit");
+
+    return process_input_buff_.data();
 }
 
 int32_t SoundTriggerEngineCapi::StartKeywordDetection()
@@ -133,25 +129,19 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
     int32_t status = 0;
     char *process_input_buff = nullptr;
     capi_v2_err_t rc = CAPI_V2_EOK;
-    capi_v2_stream_data_t *stream_input = nullptr;
     sva_result_t *result_cfg_ptr = nullptr;
-    int32_t read_size = 0;
     size_t start_idx = 0;
     size_t end_idx = 0;
-    capi_v2_buf_t capi_result;
-    bool buffer_advanced = false;
-    size_t lab_buffer_size = 0;
-    bool first_buffer_processed = false;
+    struct st_capi_loop_config loop_cfg;
+    struct st_capi_loop_stats loop_stats;
     FILE *keyword_detection_fd = nullptr;
     ChronoSteadyClock_t process_start;
     ChronoSteadyClock_t process_end;
-    ChronoSteadyClock_t capi_call_start;
-    ChronoSteadyClock_t capi_call_end;
     uint64_t process_duration = 0;
-    uint64_t total_capi_process_duration = 0;
-    uint64_t total_capi_get_param_duration = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
+    memset(&loop_stats, 0, sizeof(loop_stats));
+    memset(&loop_cfg, 0, sizeof(loop_cfg));
     if (!reader_) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid ring buffer reader");
@@ -165,22 +155,17 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
         goto exit;
     }
 
-    // calculate start and end index including tolerance
-    if (buffer_start_ > UsToBytes(kw_start_tolerance_)) {
-        buffer_start_ -= UsToBytes(kw_start_tolerance_);
-    } else {
-        buffer_start_ = 0;
-    }
-
-    lab_buffer_size = buffer_size_;
-    buffer_size_ = buffer_end_ - buffer_start_;
     /*
-     * As per requirement in PDK, input buffer size for
-     * second stage should be in multiple of 10 ms(10000us).
+     * calculate start and end index including tolerance, as per
+     * requirement in PDK, input buffer size for second stage should
+     * be in multiple of 10 ms(10000us).
      */
-    buffer_size_ -= buffer_size_ % (UsToBytes(10000));
-
-    buffer_end_ += UsToBytes(kw_end_tolerance_ + data_after_kw_end_);
+    SoundTriggerCapiKwWindow(&loop_cfg, buffer_start_, buffer_end_,
+        UsToBytes(kw_start_tolerance_),
+        UsToBytes(kw_end_tolerance_ + data_after_kw_end_),
+        UsToBytes(10000));
+    buffer_start_ = loop_cfg.start;
+    buffer_end_ = loop_cfg.end;
     PAL_DBG(LOG_TAG, "buffer_start_: %u, buffer_end_: %u",
         buffer_start_, buffer_end_);
     if (st_info_->GetEnableDebugDumps()) {
@@ -191,8 +176,8 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
         keyword_detection_cnt++;
     }
 
-    memset(&capi_result, 0, sizeof(capi_result));
-    process_input_buff = (char*)calloc(1, buffer_size_);
+    process_input_buff = GetProcessInputBuffer(
+        std::max(loop_cfg.first_chunk, buffer_size_));
     if (!process_input_buff) {
         status = -ENOMEM;
         PAL_ERR(LOG_TAG, "failed to allocate process input buff, status %d",
@@ -200,128 +185,42 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
         goto exit;
     }
 
-    stream_input = (capi_v2_stream_data_t *)
-                   calloc(1, sizeof(capi_v2_stream_data_t));
-    if (!stream_input) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate stream input, status %d", status);
-        goto exit;
-    }
+    memset(&kw_result_, 0, sizeof(kw_result_));
+    result_cfg_ptr = &kw_result_;
 
-    stream_input->buf_ptr = (capi_v2_buf_t*)calloc(1, sizeof(capi_v2_buf_t));
-    if (!stream_input->buf_ptr) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate stream_input->buf_ptr, status %d",
-                status);
-        goto exit;
-    }
-
-    result_cfg_ptr = (sva_result_t*)calloc(1, sizeof(sva_result_t));
-    if (!result_cfg_ptr) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate result cfg ptr status %d", status);
-        goto exit;
-    }
+    loop_cfg.reader = reader_;
+    loop_cfg.capi = capi_handle_;
+    loop_cfg.chunk = buffer_size_;
+    loop_cfg.result_param_id = SVA_ID_RESULT;
+    loop_cfg.result = result_cfg_ptr;
+    loop_cfg.result_size = sizeof(sva_result_t);
+    loop_cfg.wrap_buff = process_input_buff;
+    loop_cfg.exit = &exit_buffering_;
+    loop_cfg.dump_fd = keyword_detection_fd;
+    loop_cfg.trace_name = "Second stage KW process";
 
     process_start = std::chrono::steady_clock::now();
-    while (!exit_buffering_ &&
-        (bytes_processed_ < buffer_end_ - buffer_start_)) {
-        /* Original code had some time of wait will need to revisit*/
-        /* need to take into consideration the start and end buffer*/
-        if (!reader_->isEnabled()) {
-            status = -EINVAL;
-            goto exit;
-        }
-
-        /* advance the offset to ensure we are reading at the right place */
-        if (!buffer_advanced && buffer_start_ > 0) {
-            if (reader_->advanceReadOffset(buffer_start_)) {
-                buffer_advanced = true;
-            } else {
-                continue;
-            }
-        }
-
-        if (reader_->getUnreadSize() < buffer_size_)
-            continue;
-
-        read_size = reader_->read((void*)process_input_buff, buffer_size_);
-        if (read_size == 0) {
-            continue;
-        } else if (read_size < 0) {
-            status = read_size;
-            PAL_ERR(LOG_TAG, "Failed to read from buffer, status %d", status);
-            goto exit;
-        }
-
-        PAL_INFO(LOG_TAG, "Processed: %u, start: %u, end: %u",
-                 bytes_processed_, buffer_start_, buffer_end_);
-        stream_input->bufs_num = 1;
-        stream_input->buf_ptr->max_data_len = buffer_size_;
-        stream_input->buf_ptr->actual_data_len = read_size;
-        stream_input->buf_ptr->data_ptr = (int8_t *)process_input_buff;
-
-        if (st_info_->GetEnableDebugDumps()) {
-            ST_DBG_FILE_WRITE(keyword_detection_fd,
-                process_input_buff, read_size);
-        }
-
-        PAL_VERBOSE(LOG_TAG, "Calling Capi Process");
-        capi_call_start = std::chrono::steady_clock::now();
-        ATRACE_BEGIN("Second stage KW process");
-        rc = capi_handle_->vtbl_ptr->process(capi_handle_,
-            &stream_input, nullptr);
-        ATRACE_END();
-        capi_call_end = std::chrono::steady_clock::now();
-        total_capi_process_duration +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                capi_call_end - capi_call_start).count();
-        if (CAPI_V2_EFAILED == rc) {
-            status = -EINVAL;
-            PAL_ERR(LOG_TAG, "capi process failed, status %d", status);
-            goto exit;
-        }
-
-        bytes_processed_ += read_size;
-
-        capi_result.data_ptr = (int8_t*)result_cfg_ptr;
-        capi_result.actual_data_len = sizeof(sva_result_t);
-        capi_result.max_data_len = sizeof(sva_result_t);
-
-        PAL_VERBOSE(LOG_TAG, "Calling Capi get param for status");
-        capi_call_start = std::chrono::steady_clock::now();
-        rc = capi_handle_->vtbl_ptr->get_param(capi_handle_,
-            SVA_ID_RESULT, nullptr, &capi_result);
-        capi_call_end = std::chrono::steady_clock::now();
-        total_capi_get_param_duration +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                capi_call_end - capi_call_start).count();
-        if (CAPI_V2_EFAILED == rc) {
-            status = -EINVAL;
-            PAL_ERR(LOG_TAG, "capi get param failed, status %d", status);
-            goto exit;
-        }
-
-        if (result_cfg_ptr->is_detected) {
-            exit_buffering_ = true;
-            detection_state_ = KEYWORD_DETECTION_SUCCESS;
-            __builtin_add_overflow(result_cfg_ptr->start_position * CNN_FRAME_SIZE,
-                                   buffer_start_, &start_idx);
-            __builtin_add_overflow(result_cfg_ptr->end_position * CNN_FRAME_SIZE,
-                                   buffer_start_, &end_idx);
-            PAL_INFO(LOG_TAG, "KW Second Stage Detected, start index %zu, end index %zu",
-                start_idx, end_idx);
-        } else if (bytes_processed_ >= buffer_end_ - buffer_start_) {
-            detection_state_ = KEYWORD_DETECTION_REJECT;
-            PAL_INFO(LOG_TAG, "KW Second Stage rejected");
-        }
+    status = SoundTriggerCapiLoop(&loop_cfg, &loop_stats, [&]() {
         det_conf_score_ = result_cfg_ptr->best_confidence;
         PAL_INFO(LOG_TAG, "KW second stage conf level %d", det_conf_score_);
+        if (!result_cfg_ptr->is_detected)
+            return false;
 
-        if (!first_buffer_processed) {
-            buffer_size_ = lab_buffer_size;
-            first_buffer_processed = true;
-        }
+        exit_buffering_ = true;
+        detection_state_ = KEYWORD_DETECTION_SUCCESS;
+        __builtin_add_overflow(result_cfg_ptr->start_position * CNN_FRAME_SIZE,
+                               buffer_start_, &start_idx);
+        __builtin_add_overflow(result_cfg_ptr->end_position * CNN_FRAME_SIZE,
+                               buffer_start_, &end_idx);
+        PAL_INFO(LOG_TAG, "KW Second Stage Detected, start index %zu, end index %zu",
+            start_idx, end_idx);
+        return true;
+    });
+    bytes_processed_ = loop_stats.bytes_processed;
+    if (!status && detection_state_ != KEYWORD_DETECTION_SUCCESS &&
+        bytes_processed_ >= buffer_end_ - buffer_start_) {
+        detection_state_ = KEYWORD_DETECTION_REJECT;
+        PAL_INFO(LOG_TAG, "KW Second Stage rejected");
     }
 
 exit:
@@ -343,8 +242,8 @@ exit:
     PAL_INFO(LOG_TAG, "KW processing time: Bytes processed %u, Total processing "
         "time %llums, Algo process time %llums, get result time %llums",
         bytes_processed_, (long long)process_duration,
-        (long long)total_capi_process_duration,
-        (long long)total_capi_get_param_duration);
+        (long long)(loop_stats.process_us / US_PER_MS),
+        (long long)(loop_stats.get_param_us / US_PER_MS));
     if (st_info_->GetEnableDebugDumps()) {
         ST_DBG_FILE_CLOSE(keyword_detection_fd);
     }
@@ -352,16 +251,6 @@ exit:
     if (reader_)
         reader_->updateState(READER_DISABLED);
 
-    if (process_input_buff)
-        free(process_input_buff);
-    if (stream_input) {
-        if (stream_input->buf_ptr)
-            free(stream_input->buf_ptr);
-        free(stream_input);
-    }
-    if (result_cfg_ptr)
-        free(result_cfg_ptr);
-
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
     return status;
@@ -372,25 +261,21 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     int32_t status = 0;
     char *process_input_buff = nullptr;
     capi_v2_err_t rc = CAPI_V2_EOK;
-    capi_v2_stream_data_t *stream_input = nullptr;
     capi_v2_buf_t capi_uv_ptr;
     stage2_uv_wrapper_result *result_cfg_ptr = nullptr;
     stage2_uv_wrapper_stage1_uv_score_t *uv_cfg_ptr = nullptr;
-    int32_t read_size = 0;
-    capi_v2_buf_t capi_result;
-    bool buffer_advanced = false;
     StreamSoundTrigger *str = nullptr;
     struct detection_event_info *info = nullptr;
+    struct st_capi_loop_config loop_cfg;
+    struct st_capi_loop_stats loop_stats;
     FILE *user_verification_fd = nullptr;
     ChronoSteadyClock_t process_start;
     ChronoSteadyClock_t process_end;
-    ChronoSteadyClock_t capi_call_start;
-    ChronoSteadyClock_t capi_call_end;
     uint64_t process_duration = 0;
-    uint64_t total_capi_process_duration = 0;
-    uint64_t total_capi_get_param_duration = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
+    memset(&loop_stats, 0, sizeof(loop_stats));
+    memset(&loop_cfg, 0, sizeof(loop_cfg));
     if (!reader_) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid ring buffer reader");
@@ -405,14 +290,11 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     }
 
     // calculate start and end index including tolerance
-    if (buffer_start_ > UsToBytes(data_before_kw_start_)) {
-        buffer_start_ -= UsToBytes(data_before_kw_start_);
-    } else {
-        buffer_start_ = 0;
-    }
-
-    buffer_end_ += UsToBytes(kw_end_tolerance_);
-    buffer_size_ = buffer_end_ - buffer_start_;
+    SoundTriggerCapiUvWindow(&loop_cfg, buffer_start_, buffer_end_,
+        UsToBytes(data_before_kw_start_), UsToBytes(kw_end_tolerance_));
+    buffer_start_ = loop_cfg.start;
+    buffer_end_ = loop_cfg.end;
+    buffer_size_ = loop_cfg.first_chunk;
 
     if (st_info_->GetEnableDebugDumps()) {
         ST_DBG_FILE_OPEN_WR(user_verification_fd, ST_DEBUG_DUMP_LOCATION,
@@ -423,45 +305,18 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     }
 
     memset(&capi_uv_ptr, 0, sizeof(capi_uv_ptr));
-    memset(&capi_result, 0, sizeof(capi_result));
 
-    process_input_buff = (char*)calloc(1, buffer_size_);
+    process_input_buff = GetProcessInputBuffer(buffer_size_);
     if (!process_input_buff) {
         PAL_ERR(LOG_TAG, "failed to allocate process input buff");
         status = -ENOMEM;
         goto exit;
     }
 
-    stream_input = (capi_v2_stream_data_t *)
-                   calloc(1, sizeof(capi_v2_stream_data_t));
-    if (!stream_input) {
-        PAL_ERR(LOG_TAG, "failed to allocate stream input");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    stream_input->buf_ptr = (capi_v2_buf_t*)calloc(1, sizeof(capi_v2_buf_t));
-    if (!stream_input->buf_ptr) {
-        PAL_ERR(LOG_TAG, "failed to allocate buf ptr");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    result_cfg_ptr = (stage2_uv_wrapper_result*)
-                     calloc(1, sizeof(stage2_uv_wrapper_result));
-    if (!result_cfg_ptr) {
-        PAL_ERR(LOG_TAG, "failed to allocate result cfg ptr");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    uv_cfg_ptr = (stage2_uv_wrapper_stage1_uv_score_t *)
-                 calloc(1, sizeof(stage2_uv_wrapper_stage1_uv_score_t));
-    if (!uv_cfg_ptr) {
-        PAL_ERR(LOG_TAG, "failed to allocate uv cfg ptr");
-        status = -ENOMEM;
-        goto exit;
-    }
+    memset(&uv_result_, 0, sizeof(uv_result_));
+    result_cfg_ptr = &uv_result_;
+    memset(&uv_score_, 0, sizeof(uv_score_));
+    uv_cfg_ptr = &uv_score_;
 
     str = dynamic_cast<StreamSoundTrigger *>(stream_handle_);
     if (str->GetModelType() == ST_MODULE_TYPE_GMM) {
@@ -496,96 +351,35 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     if (kw_start_timestamp_ > 0)
         buffer_start_ = UsToBytes(kw_start_timestamp_);
 
-    process_start = std::chrono::steady_clock::now();
-    while (!exit_buffering_ &&
-        (bytes_processed_ < buffer_end_ - buffer_start_)) {
-        /* Original code had some time of wait will need to revisit*/
-        /* need to take into consideration the start and end buffer*/
-        if (!reader_->isEnabled()) {
-            status = -EINVAL;
-            goto exit;
-        }
-
-        /* advance the offset to ensure we are reading at the right place */
-        if (!buffer_advanced && buffer_start_ > 0) {
-            if (reader_->advanceReadOffset(buffer_start_)) {
-                buffer_advanced = true;
-            } else {
-                continue;
-            }
-        }
-
-        if (reader_->getUnreadSize() < buffer_size_)
-            continue;
-
-        read_size = reader_->read((void*)process_input_buff, buffer_size_);
-        if (read_size == 0) {
-            continue;
-        } else if (read_size < 0) {
-            status = read_size;
-            PAL_ERR(LOG_TAG, "Failed to read from buffer, status %d", status);
-            goto exit;
-        }
-        PAL_INFO(LOG_TAG, "Processed: %u, start: %u, end: %u",
-                 bytes_processed_, buffer_start_, buffer_end_);
-        stream_input->bufs_num = 1;
-        stream_input->buf_ptr->max_data_len = buffer_size_;
-        stream_input->buf_ptr->actual_data_len = read_size;
-        stream_input->buf_ptr->data_ptr = (int8_t *)process_input_buff;
-
-        if (st_info_->GetEnableDebugDumps()) {
-            ST_DBG_FILE_WRITE(user_verification_fd,
-                process_input_buff, read_size);
-        }
-
-        PAL_VERBOSE(LOG_TAG, "Calling Capi Process\n");
-        capi_call_start = std::chrono::steady_clock::now();
-        ATRACE_BEGIN("Second stage uv process");
-        rc = capi_handle_->vtbl_ptr->process(capi_handle_,
-            &stream_input, nullptr);
-        ATRACE_END();
-        capi_call_end = std::chrono::steady_clock::now();
-        total_capi_process_duration +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                capi_call_end - capi_call_start).count();
-        if (CAPI_V2_EFAILED == rc) {
-            PAL_ERR(LOG_TAG, "capi process failed\n");
-            status = -EINVAL;
-            goto exit;
-        }
-
-        bytes_processed_ += read_size;
-
-        capi_result.data_ptr = (int8_t*)result_cfg_ptr;
-        capi_result.actual_data_len = sizeof(stage2_uv_wrapper_result);
-        capi_result.max_data_len = sizeof(stage2_uv_wrapper_result);
+    loop_cfg.reader = reader_;
+    loop_cfg.capi = capi_handle_;
+    loop_cfg.start = buffer_start_;
+    loop_cfg.end = buffer_end_;
+    loop_cfg.result_param_id = STAGE2_UV_WRAPPER_ID_RESULT;
+    loop_cfg.result = result_cfg_ptr;
+    loop_cfg.result_size = sizeof(stage2_uv_wrapper_result);
+    loop_cfg.wrap_buff = process_input_buff;
+    loop_cfg.exit = &exit_buffering_;
+    loop_cfg.dump_fd = user_verification_fd;
+    loop_cfg.trace_name = "Second stage uv process";
 
-        PAL_VERBOSE(LOG_TAG, "Calling Capi get param for result\n");
-        capi_call_start = std::chrono::steady_clock::now();
-        ATRACE_BEGIN("Second stage uv get result");
-        rc = capi_handle_->vtbl_ptr->get_param(capi_handle_,
-            STAGE2_UV_WRAPPER_ID_RESULT, nullptr, &capi_result);
-        ATRACE_END();
-        capi_call_end = std::chrono::steady_clock::now();
-        total_capi_get_param_duration +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                capi_call_end - capi_call_start).count();
-        if (CAPI_V2_EFAILED == rc) {
-            PAL_ERR(LOG_TAG, "capi get param failed\n");
-            status = -EINVAL;
-            goto exit;
-        }
-
-        if (result_cfg_ptr->is_detected) {
-            exit_buffering_ = true;
-            detection_state_ = USER_VERIFICATION_SUCCESS;
-            PAL_INFO(LOG_TAG, "UV Second Stage Detected");
-        } else if (bytes_processed_ >= buffer_end_ - buffer_start_) {
-            detection_state_ = USER_VERIFICATION_REJECT;
-            PAL_INFO(LOG_TAG, "UV Second Stage Rejected");
-        }
+    process_start = std::chrono::steady_clock::now();
+    status = SoundTriggerCapiLoop(&loop_cfg, &loop_stats, [&]() {
         det_conf_score_ = (int32_t)result_cfg_ptr->final_user_score;
         PAL_INFO(LOG_TAG, "UV second stage conf level %d", det_conf_score_);
+        if (!result_cfg_ptr->is_detected)
+            return false;
+
+        exit_buffering_ = true;
+        detection_state_ = USER_VERIFICATION_SUCCESS;
+        PAL_INFO(LOG_TAG, "UV Second Stage Detected");
+        return true;
+    });
+    bytes_processed_ = loop_stats.bytes_processed;
+    if (!status && detection_state_ != USER_VERIFICATION_SUCCESS &&
+        bytes_processed_ >= buffer_end_ - buffer_start_) {
+        detection_state_ = USER_VERIFICATION_REJECT;
+        PAL_INFO(LOG_TAG, "UV Second Stage Rejected");
     }
 
 exit:
@@ -595,8 +389,8 @@ exit:
     PAL_INFO(LOG_TAG, "UV processing time: Bytes processed %u, Total processing "
         "time %llums, Algo process time %llums, get result time %llums",
         bytes_processed_, (long long)process_duration,
-        (long long)total_capi_process_duration,
-        (long long)total_capi_get_param_duration);
+        (long long)(loop_stats.process_us / US_PER_MS),
+        (long long)(loop_stats.get_param_us / US_PER_MS));
     if (st_info_->GetEnableDebugDumps()) {
         ST_DBG_FILE_CLOSE(user_verification_fd);
     }
@@ -615,18 +409,6 @@ exit:
     if (reader_)
         reader_->updateState(READER_DISABLED);
 
-    if (process_input_buff)
-        free(process_input_buff);
-    if (stream_input) {
-        if (stream_input->buf_ptr)
-            free(stream_input->buf_ptr);
-        free(stream_input);
-    }
-    if (result_cfg_ptr)
-        free(result_cfg_ptr);
-    if (uv_cfg_ptr)
-        free(uv_cfg_ptr);
-
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
     return status;
@@ -644,7 +426,6 @@ SoundTriggerEngineCapi::SoundTriggerEngineCapi(
     sm_cfg_ = sm_cfg;
     processing_started_ = false;
     sm_data_ = nullptr;
-    exit_thread_ = false;
     exit_buffering_ = false;
     kw_start_timestamp_ = 0;
     kw_end_timestamp_ = 0;
@@ -664,6 +445,10 @@ SoundTriggerEngineCapi::SoundTriggerEngineCapi(
     det_conf_score_ = 0;
     memset(&in_model_buffer_param_, 0, sizeof(in_model_buffer_param_));
     memset(&scratch_param_, 0, sizeof(scratch_param_));
+    memset(&kw_result_, 0, sizeof(kw_result_));
+    memset(&uv_result_, 0, sizeof(uv_result_));
+    memset(&uv_score_, 0, sizeof(uv_score_));
+    aborted_ = false;
 
     st_info_ = SoundTriggerPlatformInfo::GetInstance();
     if (!st_info_) {
@@ -740,20 +525,15 @@ SoundTriggerEngineCapi::~SoundTriggerEngineCapi()
 {
     PAL_DBG(LOG_TAG, "Enter");
     /*
-     * join thread if it is not joined, sometimes
+     * drain pending processing, sometimes
      * stop/unload may fail before deconstruction.
      */
-    if (buffer_thread_handler_.joinable()) {
-        processing_started_ = false;
-        std::unique_lock<std::mutex> lck(event_mutex_);
-        exit_thread_ = true;
+    processing_started_ = false;
+    {
+        std::lock_guard<std::mutex> lck(event_mutex_);
         exit_buffering_ = true;
-        cv_.notify_one();
-        lck.unlock();
-        buffer_thread_handler_.join();
-        lck.lock();
-        PAL_INFO(LOG_TAG, "Thread joined");
     }
+    PalTaskPool::getInstance()->drain(this);
     if (buffer_) {
         delete buffer_;
     }
@@ -776,7 +556,6 @@ int32_t SoundTriggerEngineCapi::StartSoundEngine()
 {
     int32_t status = 0;
     processing_started_ = false;
-    exit_thread_ = false;
     exit_buffering_ = false;
     capi_v2_err_t rc = CAPI_V2_EOK;
     capi_v2_buf_t capi_buf;
@@ -873,15 +652,9 @@ int32_t SoundTriggerEngineCapi::StopSoundEngine()
     {
         processing_started_ = false;
         std::lock_guard<std::mutex> lck(event_mutex_);
-        exit_thread_ = true;
         exit_buffering_ = true;
-
-        cv_.notify_one();
-    }
-    if (buffer_thread_handler_.joinable()) {
-        PAL_DBG(LOG_TAG, "Thread joined");
-        buffer_thread_handler_.join();
     }
+    PalTaskPool::getInstance()->drain(this);
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
     return status;
@@ -941,12 +714,9 @@ int32_t SoundTriggerEngineCapi::LoadSoundModel(Stream *s __unused,
         goto exit;
     }
 
-    buffer_thread_handler_ =
-        std::thread(SoundTriggerEngineCapi::BufferThreadLoop, this);
-
-    if (!buffer_thread_handler_.joinable()) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "failed to create buffer thread = %d", status);
+    /* first detection then only grows the buffer if the keyword is long */
+    if (!GetProcessInputBuffer(buffer_size_)) {
+        status = -ENOMEM;
         goto exit;
     }
 
@@ -1041,6 +811,7 @@ exit:
         free(scratch_param_.scratch_ptr);
         scratch_param_.scratch_ptr = NULL;
     }
+    std::vector<char>().swap(process_input_buff_);
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
 }
@@ -1138,13 +909,26 @@ void SoundTriggerEngineCapi::SetDetected(bool detected)
     PAL_DBG(LOG_TAG, "SetDetected %d", detected);
     std::lock_guard<std::mutex> lck(event_mutex_);
     if (detected != processing_started_) {
-        if (detected)
+        if (detected) {
             reader_->updateState(READER_ENABLED);
+            aborted_ = false;
+        }
         processing_started_ = detected;
         exit_buffering_ = !processing_started_;
         PAL_INFO(LOG_TAG, "setting processing started %d", detected);
-        cv_.notify_one();
+        if (detected)
+            PalTaskPool::getInstance()->post(this,
+                [this] { ProcessDetection(this); });
     } else {
         PAL_VERBOSE(LOG_TAG, "processing started unchanged");
     }
 }
+
+void SoundTriggerEngineCapi::AbortDetection()
+{
+    PAL_DBG(LOG_TAG, "abort detection, processing started %d",
+        processing_started_.load());
+    /* no event_mutex_: the processing loop holds it until it sees this */
+    aborted_ = true;
+    exit_buffering_ = true;
+}
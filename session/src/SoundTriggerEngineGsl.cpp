@@ -33,6 +33,7 @@
 
 #include "SoundTriggerEngineGsl.h"
 
+#include <algorithm>
 #include <cutils/trace.h>
 
 #include "Session.h"
@@ -40,6 +41,7 @@
 #include "StreamSoundTrigger.h"
 #include "ResourceManager.h"
 #include "SoundTriggerPlatformInfo.h"
+#include "SoundTriggerMmapPacer.h"
 
 // TODO: find another way to print debug logs by default
 #define ST_DBG_LOGS
@@ -47,7 +49,8 @@
 #define PAL_DBG(LOG_TAG,...)  PAL_INFO(LOG_TAG,__VA_ARGS__)
 #endif
 
-#define MAX_MMAP_POSITION_QUERY_RETRY_CNT 5
+#define FNV1A_64_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV1A_64_PRIME 0x100000001b3ULL
 
 ST_DBG_DECLARE(static int dsp_output_cnt = 0);
 
@@ -195,6 +198,36 @@ void SoundTriggerEngineGsl::CheckAndSetDetectionConfLevels(Stream *s) {
             st->GetSoundModelInfo()->GetDetConfLevels()[i]);
 }
 
+/*
+ * Copy size bytes starting at offset of the shared MMAP buffer directly
+ * into the ring buffer memory, without an intermediate bounce buffer.
+ */
+size_t SoundTriggerEngineGsl::WriteMmapToRingBuffer(size_t offset,
+    size_t size, FILE *dump_fd)
+{
+    struct pal_ring_buffer_span span;
+    size_t written = 0;
+    size_t copied = 0;
+    size_t chunk = 0;
+
+    written = buffer_->acquireWrite(size, &span);
+    for (int i = 0; i < 2; i++) {
+        copied = 0;
+        while (copied < span.size[i]) {
+            chunk = std::min(span.size[i] - copied, mmap_buffer_size_ - offset);
+            ar_mem_cpy(span.data[i] + copied, chunk,
+                (uint8_t *)mmap_buffer_.buffer + offset, chunk);
+            copied += chunk;
+            offset = (offset + chunk) % mmap_buffer_size_;
+        }
+        if (st_info_->GetEnableDebugDumps() && span.size[i]) {
+            ST_DBG_FILE_WRITE(dump_fd, span.data[i], span.size[i]);
+        }
+    }
+
+    return buffer_->commitWrite(written);
+}
+
 int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
     int32_t status = 0;
     int32_t size = 0;
@@ -215,7 +248,10 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
     FILE *dsp_output_fd = nullptr;
     ChronoSteadyClock_t kw_transfer_begin;
     ChronoSteadyClock_t kw_transfer_end;
-    size_t retry_cnt = 0;
+    struct st_mmap_pacer mmap_pacer;
+    int64_t mmap_now_ns = 0;
+    int64_t mmap_wait_ns = 0;
+    float ftrt_drain_rate = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
     UpdateState(ENG_BUFFERING);
@@ -227,11 +263,14 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
 
     std::memset(&buf, 0, sizeof(struct pal_buffer));
     buf.size = input_buf_size * input_buf_num;
-    buf.buffer = (uint8_t *)calloc(1, buf.size);
-    if (!buf.buffer) {
-        PAL_ERR(LOG_TAG, "buf.buffer allocation failed");
-        status = -ENOMEM;
-        goto exit;
+    /* MMAP data is copied straight from the shared buffer to ring buffer */
+    if (mmap_buffer_size_ == 0) {
+        buf.buffer = (uint8_t *)calloc(1, buf.size);
+        if (!buf.buffer) {
+            PAL_ERR(LOG_TAG, "buf.buffer allocation failed");
+            status = -ENOMEM;
+            goto exit;
+        }
     }
 
     if (!IS_MODULE_TYPE_PDK(module_type_)) {
@@ -253,6 +292,10 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
 
     ATRACE_ASYNC_BEGIN("stEngine: read FTRT data", (int32_t)module_type_);
     kw_transfer_begin = std::chrono::steady_clock::now();
+    SoundTriggerMmapPacerInit(&mmap_pacer,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            kw_transfer_begin.time_since_epoch()).count(),
+        sleep_ms, input_buf_num);
     while (!exit_buffering_) {
         /*
          * When RestartRecognition is called during buffering thread
@@ -286,16 +329,34 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                     status = -EINVAL;
                     goto exit;
                 }
+                mmap_now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
                 if (bytes_written > total_read_size) {
                     size_to_read = bytes_written - total_read_size;
-                    retry_cnt = 0;
+                    /*
+                     * Track when the DSP last advanced the write pointer and
+                     * how far apart its updates are, to predict the next one.
+                     */
+                    SoundTriggerMmapPacerUpdate(&mmap_pacer,
+                        mmap_pos.time_nanoseconds, mmap_now_ns,
+                        total_read_size == 0);
                 } else {
-                    retry_cnt++;
-                    if (retry_cnt > MAX_MMAP_POSITION_QUERY_RETRY_CNT) {
+                    /*
+                     * Sleep until just after the next expected DSP write
+                     * instead of a whole input buffer duration, so FTRT and
+                     * real time data reach the ring buffer with low latency.
+                     */
+                    mmap_wait_ns = SoundTriggerMmapPacerWait(&mmap_pacer,
+                        mmap_now_ns);
+                    if (mmap_wait_ns < 0) {
+                        PAL_ERR(LOG_TAG, "No mmap progress for %lldns",
+                            (long long)(mmap_now_ns -
+                            mmap_pacer.last_update_ns));
                         status = -EIO;
                         goto exit;
                     }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+                    std::this_thread::sleep_for(
+                        std::chrono::nanoseconds(mmap_wait_ns));
                     continue;
                 }
                 if (size_to_read > (2 * mmap_buffer_size_) - read_offset) {
@@ -311,35 +372,21 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                 goto exit;
             }
 
-            if (size_to_read != buf.size) {
-                buf.buffer = (uint8_t *)realloc(buf.buffer, size_to_read);
-                if (!buf.buffer) {
-                    PAL_ERR(LOG_TAG, "buf.buffer allocation failed");
-                    status = -ENOMEM;
-                    goto exit;
-                }
-                buf.size = size_to_read;
-            }
-
-            // TODO: directly write to PalRingBuffer with shared buffer pointer
-            if (read_offset + size_to_read <= mmap_buffer_size_) {
-                ar_mem_cpy(buf.buffer, size_to_read,
-                    (uint8_t *)mmap_buffer_.buffer + read_offset,
-                    size_to_read);
-                read_offset += size_to_read;
+            if (bytes_to_drop >= size_to_read) {
+                bytes_to_drop -= size_to_read;
             } else {
-                ar_mem_cpy(buf.buffer, mmap_buffer_size_ - read_offset,
-                    (uint8_t *)mmap_buffer_.buffer + read_offset,
-                    mmap_buffer_size_ - read_offset);
-                ar_mem_cpy(buf.buffer + mmap_buffer_size_ - read_offset,
-                    size_to_read + read_offset - mmap_buffer_size_,
-                    (uint8_t *)mmap_buffer_.buffer,
-                    size_to_read + read_offset - mmap_buffer_size_);
-                read_offset = size_to_read + read_offset - mmap_buffer_size_;
+                size_t ret = WriteMmapToRingBuffer(
+                    (read_offset + bytes_to_drop) % mmap_buffer_size_,
+                    size_to_read - bytes_to_drop, dsp_output_fd);
+                bytes_to_drop = 0;
+                PAL_VERBOSE(LOG_TAG, "%zu written to ring buffer", ret);
             }
-            size = size_to_read;
-            PAL_VERBOSE(LOG_TAG, "read %d bytes from shared buffer", size);
-            total_read_size += size;
+            read_offset = (read_offset + size_to_read) % mmap_buffer_size_;
+            PAL_VERBOSE(LOG_TAG, "read %zu bytes from shared buffer",
+                size_to_read);
+            total_read_size += size_to_read;
+            /* already in ring buffer, nothing left to write below */
+            size = 0;
         } else if (buffer_->getFreeSize() >= buf.size) {
             if (total_read_size < ftrt_size &&
                 ftrt_size - total_read_size < buf.size) {
@@ -387,8 +434,13 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                 ATRACE_ASYNC_END("stEngine: read FTRT data", (int32_t)module_type_);
                 kw_transfer_latency_ = std::chrono::duration_cast<std::chrono::milliseconds>(
                     kw_transfer_end - kw_transfer_begin).count();
-                PAL_INFO(LOG_TAG, "FTRT data read done! total_read_size %zu, ftrt_size %zu, read latency %llums",
-                        total_read_size, ftrt_size, (long long)kw_transfer_latency_);
+                /* FTRT drain rate as a multiple of real time */
+                if (kw_transfer_latency_ && UsToBytes(US_PER_SEC))
+                    ftrt_drain_rate = (float)ftrt_size * MS_PER_SEC /
+                        ((float)UsToBytes(US_PER_SEC) * kw_transfer_latency_);
+                PAL_INFO(LOG_TAG, "FTRT data read done! total_read_size %zu, ftrt_size %zu, read latency %llums, drain rate %.2fx",
+                        total_read_size, ftrt_size, (long long)kw_transfer_latency_,
+                        ftrt_drain_rate);
 
                 if (!IS_MODULE_TYPE_PDK(module_type_)) {
                     StreamSoundTrigger *s = dynamic_cast<StreamSoundTrigger *>
@@ -437,7 +489,9 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                 }
                 event_notified = true;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+            /* mmap reads are paced by the predicted DSP write position */
+            if (mmap_buffer_size_ == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
         }
     }
 
@@ -869,6 +923,11 @@ SoundTriggerEngineGsl::SoundTriggerEngineGsl(
     nlpi_miid_ = 0;
     ec_ref_count_ = 0;
     is_crr_dev_using_ext_ec_ = false;
+    cur_merged_model_ = nullptr;
+    merged_model_cache_bytes_ = 0;
+    merged_model_cache_limit_ = 0;
+    merged_model_cache_hits_ = 0;
+    merged_model_cache_misses_ = 0;
 
     UpdateState(ENG_IDLE);
 
@@ -887,6 +946,8 @@ SoundTriggerEngineGsl::SoundTriggerEngineGsl(
         PAL_ERR(LOG_TAG, "No sound trigger platform info present");
         throw std::runtime_error("No sound trigger platform info present");
     }
+    merged_model_cache_limit_ =
+        (size_t)st_info_->GetMergedModelCacheSizeKb() * 1024;
 
     if (sm_cfg) {
         sample_rate_ = sm_cfg_->GetSampleRate();
@@ -1059,12 +1120,76 @@ cleanup_1:
     return status;
 }
 
+uint64_t SoundTriggerEngineGsl::HashModelData(const uint8_t *data,
+             uint32_t size, uint64_t hash) {
+
+    for (uint32_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= FNV1A_64_PRIME;
+    }
+
+    return hash;
+}
+
+bool SoundTriggerEngineGsl::LookupMergedModel(uint64_t key,
+             listen_model_type *out_model) {
+
+    if (!merged_model_cache_limit_)
+        return false;
+
+    auto it = merged_model_index_.find(key);
+    if (it == merged_model_index_.end()) {
+        merged_model_cache_misses_++;
+        PAL_DBG(LOG_TAG, "merged model cache miss, hits %u misses %u",
+            merged_model_cache_hits_, merged_model_cache_misses_);
+        return false;
+    }
+
+    merged_model_lru_.splice(merged_model_lru_.begin(), merged_model_lru_,
+                             it->second);
+    cur_merged_model_ = it->second->data;
+    out_model->data = it->second->data.get();
+    out_model->size = it->second->size;
+    merged_model_cache_hits_++;
+    PAL_DBG(LOG_TAG, "merged model cache hit, size %u, hits %u misses %u",
+        out_model->size, merged_model_cache_hits_, merged_model_cache_misses_);
+
+    return true;
+}
+
+void SoundTriggerEngineGsl::StoreMergedModel(uint64_t key,
+             listen_model_type *out_model) {
+
+    std::shared_ptr<uint8_t> blob(out_model->data, free);
+
+    /* keep the result alive for the caller even if it is not cached */
+    cur_merged_model_ = blob;
+    if (!merged_model_cache_limit_ ||
+        out_model->size > merged_model_cache_limit_)
+        return;
+
+    merged_model_lru_.push_front({key, blob, out_model->size});
+    merged_model_index_[key] = merged_model_lru_.begin();
+    merged_model_cache_bytes_ += out_model->size;
+
+    while (merged_model_cache_bytes_ > merged_model_cache_limit_) {
+        merged_model_entry &victim = merged_model_lru_.back();
+
+        PAL_VERBOSE(LOG_TAG, "evict merged model, size %u", victim.size);
+        merged_model_cache_bytes_ -= victim.size;
+        merged_model_index_.erase(victim.key);
+        merged_model_lru_.pop_back();
+    }
+}
+
 int32_t SoundTriggerEngineGsl::MergeSoundModels(uint32_t num_models,
              listen_model_type *in_models[],
              listen_model_type *out_model) {
 
     listen_status_enum sm_ret = kSucess;
     int32_t status = 0;
+    std::vector<uint64_t> model_hashes;
+    uint64_t key = FNV1A_64_OFFSET_BASIS;
     std::shared_ptr<SoundModelLib>sml = SoundModelLib::GetInstance();
 
     if (!sml) {
@@ -1073,6 +1198,18 @@ int32_t SoundTriggerEngineGsl::MergeSoundModels(uint32_t num_models,
     }
 
     PAL_VERBOSE(LOG_TAG, "num_models to merge %d", num_models);
+    /* merging is order independent, so key on the sorted input hashes */
+    for (uint32_t i = 0; i < num_models; i++)
+        model_hashes.push_back(HashModelData(in_models[i]->data,
+            in_models[i]->size, FNV1A_64_OFFSET_BASIS));
+    std::sort(model_hashes.begin(), model_hashes.end());
+    key = HashModelData((const uint8_t *)"merge", strlen("merge"), key);
+    for (uint64_t hash : model_hashes)
+        key = HashModelData((const uint8_t *)&hash, sizeof(hash), key);
+
+    if (LookupMergedModel(key, out_model))
+        return 0;
+
     sm_ret = sml->GetMergedModelSize_(num_models, in_models,
         &out_model->size);
     if ((sm_ret != kSucess) || !out_model->size) {
@@ -1112,6 +1249,7 @@ int32_t SoundTriggerEngineGsl::MergeSoundModels(uint32_t num_models,
             sm_cnt);
         sm_cnt++;
     }
+    StoreMergedModel(key, out_model);
     PAL_DBG(LOG_TAG, "Exit, status: %d", status);
     return 0;
 
@@ -1249,9 +1387,6 @@ int32_t SoundTriggerEngineGsl::AddSoundModel(Stream *s, uint8_t *data,
     PAL_DBG(LOG_TAG, "Exit: status %d", status);
     return 0;
 cleanup:
-    if (out_model.data)
-        free(out_model.data);
-
     if (in_models)
         SoundModelInfo::FreeArrayPtrs((char **)in_models, num_models);
 
@@ -1266,6 +1401,8 @@ int32_t SoundTriggerEngineGsl::DeleteFromMergedModel(char **keyphrases,
     listen_status_enum sm_ret = kSucess;
     uint32_t out_model_sz = 0;
     int32_t status = 0;
+    std::vector<uint64_t> kw_hashes;
+    uint64_t key = FNV1A_64_OFFSET_BASIS;
     std::shared_ptr<SoundModelLib>sml = SoundModelLib::GetInstance();
 
     out_model->data = nullptr;
@@ -1273,6 +1410,18 @@ int32_t SoundTriggerEngineGsl::DeleteFromMergedModel(char **keyphrases,
     merge_model.data = in_model->data;
     merge_model.size = in_model->size;
 
+    for (uint32_t i = 0; i < num_keyphrases; i++)
+        kw_hashes.push_back(HashModelData((const uint8_t *)keyphrases[i],
+            strlen(keyphrases[i]), FNV1A_64_OFFSET_BASIS));
+    std::sort(kw_hashes.begin(), kw_hashes.end());
+    key = HashModelData((const uint8_t *)"delete", strlen("delete"), key);
+    key = HashModelData(in_model->data, in_model->size, key);
+    for (uint64_t hash : kw_hashes)
+        key = HashModelData((const uint8_t *)&hash, sizeof(hash), key);
+
+    if (LookupMergedModel(key, out_model))
+        return 0;
+
     for (uint32_t i = 0; i < num_keyphrases; i++) {
         sm_ret = sml->GetSizeAfterDeleting_(&merge_model, keyphrases[i],
                                                    nullptr, &out_model_sz);
@@ -1289,11 +1438,6 @@ int32_t SoundTriggerEngineGsl::DeleteFromMergedModel(char **keyphrases,
             goto cleanup;
         }
         PAL_VERBOSE(LOG_TAG, "Size after deleting kw[%d] = %d", i, out_model_sz);
-        if (!out_model->data) {
-            /* Valid if deleting multiple keyphrases one after other */
-            free(out_model->data);
-            out_model->size = 0;
-        }
         out_model->data = (uint8_t *)calloc(1, out_model_sz * sizeof(char));
         if (!out_model->data) {
             PAL_ERR(LOG_TAG, "Merge sound model allocation failed, size %d ",
@@ -1317,6 +1461,8 @@ int32_t SoundTriggerEngineGsl::DeleteFromMergedModel(char **keyphrases,
             goto cleanup;
         }
         /* Used if deleting multiple keyphrases one after other */
+        if (merge_model.data != in_model->data)
+            free(merge_model.data);
         merge_model.data = out_model->data;
         merge_model.size = out_model->size;
     }
@@ -1331,9 +1477,13 @@ int32_t SoundTriggerEngineGsl::DeleteFromMergedModel(char **keyphrases,
             sm_cnt);
         sm_cnt++;
     }
+    if (out_model->data)
+        StoreMergedModel(key, out_model);
     return 0;
 
 cleanup:
+    if (merge_model.data != in_model->data && merge_model.data != out_model->data)
+        free(merge_model.data);
     if (out_model->data) {
         free(out_model->data);
         out_model->data = nullptr;
@@ -1439,12 +1589,10 @@ int32_t SoundTriggerEngineGsl::DeleteSoundModel(Stream *s) {
     *eng_sm_info_ = *sm_info;
     sm_merged_ = true;
 
+    delete sm_info;
     return 0;
 
 cleanup:
-    if (out_model.data)
-        free(out_model.data);
-
     return status;
 }
 
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#include "SoundTriggerMmapPacer.h"
+
+#include <errno.h>
+#include <algorithm>
+
+#define NS_PER_US ((int64_t)1000)
+#define NS_PER_MS ((int64_t)1000000)
+
+void SoundTriggerMmapPacerInit(struct st_mmap_pacer *pacer, int64_t now_ns,
+                               uint32_t buffer_ms, size_t buf_num)
+{
+    pacer->last_update_ns = now_ns;
+    pacer->update_period_ns = 0;
+    pacer->max_wait_ns = (int64_t)buffer_ms * NS_PER_MS;
+    pacer->stall_timeout_ns = MAX_MMAP_POSITION_QUERY_RETRY_CNT *
+        pacer->max_wait_ns;
+    pacer->default_wait_ns = buf_num ? pacer->max_wait_ns / buf_num : 0;
+}
+
+void SoundTriggerMmapPacerUpdate(struct st_mmap_pacer *pacer, int64_t pos_ns,
+                                 int64_t now_ns, bool first)
+{
+    /*
+     * Position timestamps are CLOCK_MONOTONIC, same as steady_clock, fall
+     * back to now if driver leaves it 0.
+     */
+    if (pos_ns > pacer->last_update_ns) {
+        if (!first)
+            pacer->update_period_ns = pos_ns - pacer->last_update_ns;
+        pacer->last_update_ns = pos_ns;
+    } else {
+        pacer->last_update_ns = now_ns;
+    }
+}
+
+int64_t SoundTriggerMmapPacerWait(const struct st_mmap_pacer *pacer,
+                                  int64_t now_ns)
+{
+    int64_t since_update_ns = now_ns - pacer->last_update_ns;
+    int64_t wait_ns = 0;
+
+    if (since_update_ns > pacer->stall_timeout_ns)
+        return -EIO;
+
+    if (pacer->update_period_ns > since_update_ns)
+        wait_ns = pacer->update_period_ns - since_update_ns;
+    else
+        wait_ns = pacer->default_wait_ns;
+    wait_ns += MMAP_WAKEUP_MARGIN_US * NS_PER_US;
+    wait_ns = std::max(wait_ns, MMAP_MIN_WAIT_US * NS_PER_US);
+    return std::min(wait_ns, pacer->max_wait_ns);
+}
@@ -138,6 +138,23 @@ class Device;
 class ResourceManager;
 class Session;
 
+/*
+ * Read-only snapshot of the stream format fields needed on the data path.
+ * A new snapshot is published whenever mStreamAttr changes so read/write
+ * can learn their format without copying pal_stream_attributes. Kept on
+ * its own cache line so publishing never shares a line with stream state.
+ */
+struct alignas(64) StreamHotInfo {
+    pal_stream_type_t type;
+    pal_stream_direction_t direction;
+    pal_stream_flags_t flags;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t bitWidth;
+    uint32_t frameSize;
+    bool isMmap;
+};
+
 class Stream
 {
 protected:
@@ -148,6 +165,12 @@ protected:
     struct pal_stream_attributes* mStreamAttr;
     int mGainLevel;
     std::mutex mStreamMutex;
+    /*
+     * Serializes read/write against reconfiguration for streams that drop
+     * mStreamMutex across the kernel I/O (StreamPCM). Taken after
+     * mStreamMutex. Uncontended for streams that hold mStreamMutex instead.
+     */
+    std::mutex mDataPathMutex;
     static std::mutex mBaseStreamMutex; //TBD change this. as having a single static mutex for all instances of Stream is incorrect. Replace
     static std::shared_ptr<ResourceManager> rm;
     struct modifier_kv *mModifiers;
@@ -167,7 +190,14 @@ protected:
     static std::mutex pauseMutex;
     bool mutexLockedbyRm = false;
     sem_t mInUse;
+    /*
+     * Swapped with std::atomic_store/atomic_load. Readers skip mStreamMutex,
+     * but the shared_ptr atomics are not lock-free: the library guards them
+     * with its own short internal lock.
+     */
+    std::shared_ptr<const StreamHotInfo> mHotInfo;
     int connectToDefaultDevice(Stream* streamHandle, uint32_t dir);
+    void publishHotInfo();
 public:
     virtual ~Stream() {};
     struct pal_volume_data* mVolumeData = NULL;
@@ -186,6 +216,10 @@ public:
     virtual int32_t drain(pal_drain_type_t type __unused) {return 0;}
     virtual int32_t setStreamAttributes(struct pal_stream_attributes *sattr) = 0;
     virtual int32_t setVolume(struct pal_volume_data *volume) = 0;
+    /* streams without a DSP volume ramp only take a direct set */
+    virtual int32_t setVolumeRamp(struct pal_volume_data *volume,
+            uint32_t durationMs, pal_volume_ramp_curve_t curve __unused)
+            {return durationMs ? -ENOSYS : setVolume(volume);}
     virtual int32_t mute(bool state) = 0;
     virtual int32_t mute_l(bool state) = 0;
     virtual int32_t pause() = 0;
@@ -211,6 +245,7 @@ public:
     virtual int32_t GetMmapPosition(struct pal_mmap_position *position __unused) {return -EINVAL;}
     virtual int32_t getTagsWithModuleInfo(size_t *size __unused, uint8_t *payload __unused) {return -EINVAL;};
     int32_t getStreamAttributes(struct pal_stream_attributes *sattr);
+    std::shared_ptr<const StreamHotInfo> getHotInfo() const;
     int32_t getModifiers(struct modifier_kv *modifiers,uint32_t *noOfModifiers);
     const std::string& getStreamSelector() const;
     const std::string& getDevicePPSelector() const;
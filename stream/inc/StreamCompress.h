@@ -55,6 +55,8 @@ public:
     int32_t flush();
     int32_t setStreamAttributes(struct pal_stream_attributes *sattr) override;
     int32_t setVolume( struct pal_volume_data *volume) override;
+    int32_t setVolumeRamp(struct pal_volume_data *volume, uint32_t durationMs,
+            pal_volume_ramp_curve_t curve) override;
     int32_t mute(bool state) override;
     int32_t mute_l(bool state) override;
     int32_t read(struct pal_buffer *buf) override;
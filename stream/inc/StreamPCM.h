@@ -52,6 +52,8 @@ public:
    int32_t prepare() override;
    int32_t setStreamAttributes( struct pal_stream_attributes *sattr) override;
    int32_t setVolume( struct pal_volume_data *volume) override;
+   int32_t setVolumeRamp(struct pal_volume_data *volume, uint32_t durationMs,
+           pal_volume_ramp_curve_t curve) override;
    int32_t mute(bool state) override;
    int32_t mute_l(bool state) override;
    int32_t pause() override;
@@ -64,6 +66,7 @@ public:
    int32_t write(struct pal_buffer *buf) override;
    int32_t registerCallBack(pal_stream_callback cb, uint64_t cookie) override;
    int32_t getCallBack(pal_stream_callback *cb) override;
+   void notifyClient(uint32_t event_id, void *data, uint32_t event_size);
    int32_t getParameters(uint32_t param_id, void **payload) override;
    int32_t setParameters(uint32_t param_id, void *payload) override;
    int32_t setECRef(std::shared_ptr<Device> dev, bool is_enable) override;
@@ -77,6 +80,11 @@ public:
    static int32_t isSampleRateSupported(uint32_t sampleRate);
    static int32_t isChannelSupported(uint32_t numChannels);
    static int32_t isBitWidthSupported(uint32_t bitWidth);
+private:
+   /* Guards streamCb/cookie, which the PalIoReactor thread reads. Not
+    * mStreamMutex: stop/close hold it while waiting for that thread.
+    */
+   std::mutex mCallbackMutex;
 };
 
 #endif//STREAMPCM_H_
@@ -31,6 +31,7 @@
 #ifndef STREAMSOUNDTRIGGER_H_
 #define STREAMSOUNDTRIGGER_H_
 
+#include <atomic>
 #include <utility>
 #include <map>
 
@@ -145,6 +146,7 @@ class StreamSoundTrigger : public Stream {
     struct detection_event_info* GetDetectionEventInfo();
     int32_t ParseDetectionPayload(uint32_t *event_data);
     void SetDetectedToEngines(bool detected);
+    void AbortSecondStage(SoundTriggerEngine *rejected);
     int32_t SetEngineDetectionState(int32_t state);
     int32_t notifyClient(bool detection);
 
@@ -535,16 +537,21 @@ class StreamSoundTrigger : public Stream {
                                         uint32_t *event_data,
                                         uint64_t cookie __unused);
 
-    static void TimerThread(StreamSoundTrigger& st_stream);
     void PostDelayedStop();
     void CancelDelayedStop();
     void InternalStopRecognition();
-    std::thread timer_thread_;
+    int32_t ReadLabData(struct pal_buffer *buf);
+    /*
+     * Set by the first read in buffering state, cleared by TransitTo when
+     * leaving it. While set, read() goes straight to reader_ under
+     * lab_read_mutex_ instead of the stream mutex and state machine.
+     */
+    std::atomic<bool> lab_read_active_;
+    std::mutex lab_read_mutex_;
+    pal_param_st_lab_read_config_t lab_read_cfg_;
     std::mutex timer_mutex_;
-    std::condition_variable timer_start_cond_;
-    std::condition_variable timer_wait_cond_;
-    bool timer_stop_waiting_;
-    bool exit_timer_thread_;
+    uint64_t stop_timer_;   /* PalTimerService handle, 0 when idle */
+    uint64_t last_stop_timer_;  /* last handle scheduled, waited for on destruction */
     bool pending_stop_;
     bool paused_;
     bool device_opened_;
@@ -335,6 +335,37 @@ exit:
     return status;
 }
 
+/* caller must hold whatever lock guards the mStreamAttr update */
+void Stream::publishHotInfo()
+{
+    std::shared_ptr<StreamHotInfo> info;
+    struct pal_media_config *cfg;
+
+    if (!mStreamAttr)
+        return;
+
+    info = std::make_shared<StreamHotInfo>();
+    cfg = (mStreamAttr->direction == PAL_AUDIO_INPUT) ?
+            &mStreamAttr->in_media_config : &mStreamAttr->out_media_config;
+    info->type = mStreamAttr->type;
+    info->direction = mStreamAttr->direction;
+    info->flags = mStreamAttr->flags;
+    info->sampleRate = cfg->sample_rate;
+    info->channels = cfg->ch_info.channels;
+    info->bitWidth = cfg->bit_width;
+    info->frameSize = cfg->ch_info.channels * (cfg->bit_width / 8);
+    info->isMmap = (mStreamAttr->type == PAL_STREAM_ULTRA_LOW_LATENCY) &&
+            (mStreamAttr->flags & (PAL_STREAM_FLAG_MMAP_MASK |
+                                   PAL_STREAM_FLAG_MMAP_NO_IRQ_MASK));
+    std::atomic_store(&mHotInfo,
+            std::shared_ptr<const StreamHotInfo>(std::move(info)));
+}
+
+std::shared_ptr<const StreamHotInfo> Stream::getHotInfo() const
+{
+    return std::atomic_load(&mHotInfo);
+}
+
 const std::string& Stream::getStreamSelector() const {
     return mStreamSelector;
 }
@@ -1030,6 +1061,7 @@ int32_t Stream::disconnectStreamDevice(Stream* streamHandle, pal_device_id_t dev
 int32_t Stream::disconnectStreamDevice_l(Stream* streamHandle, pal_device_id_t dev_id)
 {
     int32_t status = 0;
+    std::lock_guard<std::mutex> dataLock(mDataPathMutex);
 
     if (currentState == STREAM_IDLE) {
         PAL_DBG(LOG_TAG, "stream is in %d state, no need to switch device", currentState);
@@ -1094,6 +1126,7 @@ int32_t Stream::connectStreamDevice_l(Stream* streamHandle, struct pal_device *d
     std::shared_ptr<Device> dev = nullptr;
     std::string newBackEndName;
     std::string curBackEndName;
+    std::lock_guard<std::mutex> dataLock(mDataPathMutex);
 
     if (!dattr) {
         PAL_ERR(LOG_TAG, "invalid params");
@@ -102,6 +102,7 @@ StreamACD::StreamACD(struct pal_stream_attributes *sattr,
     mStreamAttr->in_media_config.aud_fmt_id = PAL_AUDIO_FMT_PCM_S16_LE;
     mStreamAttr->in_media_config.ch_info.channels = 1;
     mStreamAttr->direction = PAL_AUDIO_INPUT;
+    publishHotInfo();
 
     // get ACD platform info
     acd_info_ = ACDPlatformInfo::GetInstance();
@@ -114,6 +114,7 @@ StreamACDB::StreamACDB(const struct pal_stream_attributes *sattr, struct pal_dev
     }
 
     ar_mem_cpy(mStreamAttr, sizeof(pal_stream_attributes), sattr, sizeof(pal_stream_attributes));
+    publishHotInfo();
 
     PAL_INFO(LOG_TAG, "Create new ACDBSession");
 
@@ -190,6 +191,7 @@ int32_t  StreamACDB::setStreamAttributes(struct pal_stream_attributes *sattr)
     mStreamMutex.lock();
     ar_mem_cpy (mStreamAttr, sizeof(struct pal_stream_attributes), sattr,
                       sizeof(struct pal_stream_attributes));
+    publishHotInfo();
     mStreamMutex.unlock();
     status = session->setConfig(this, MODULE, 0);  //TODO:gkv or ckv or tkv need to pass
     if (0 != status) {
@@ -101,6 +101,7 @@ StreamCommon::StreamCommon(const struct pal_stream_attributes *sattr, struct pal
         PAL_ERR(LOG_TAG,"Error:out_channels is invalid %d", out_channels);
         mStreamAttr->out_media_config.ch_info.channels = PAL_MAX_CHANNELS_SUPPORTED;
     }
+    publishHotInfo();
 
     PAL_VERBOSE(LOG_TAG, "Create new Session for stream type %d", sattr->type);
     session = Session::makeSession(rm, sattr);
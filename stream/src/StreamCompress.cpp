@@ -116,6 +116,7 @@ StreamCompress::StreamCompress(const struct pal_stream_attributes *sattr, struct
         throw std::runtime_error("failed to malloc for stream attributes");
     }
     ar_mem_cpy(mStreamAttr, sizeof(pal_stream_attributes), sattr, sizeof(pal_stream_attributes));
+    publishHotInfo();
     PAL_VERBOSE(LOG_TAG, "Create new compress session");
 
     session = Session::makeSession(rm, sattr);
@@ -555,6 +556,7 @@ int32_t StreamCompress::setStreamAttributes(struct pal_stream_attributes *sattr)
     memset(mStreamAttr, 0, sizeof(struct pal_stream_attributes));
     mStreamMutex.lock();
     memcpy (mStreamAttr, sattr, sizeof(struct pal_stream_attributes));
+    publishHotInfo();
     mStreamMutex.unlock();
     status = session->setConfig(this, MODULE, 0);  //gkv or ckv or tkv need to pass
     if (0 != status) {
@@ -755,18 +757,39 @@ int32_t StreamCompress::setParameters(uint32_t param_id, void *payload)
 }
 
 int32_t StreamCompress::setVolume(struct pal_volume_data *volume)
+{
+    return setVolumeRamp(volume, 0, PAL_VOLUME_RAMP_LINEAR);
+}
+
+int32_t StreamCompress::setVolumeRamp(struct pal_volume_data *volume, uint32_t durationMs,
+        pal_volume_ramp_curve_t curve)
 {
     int32_t status = 0;
     struct volume_set_param_info vol_set_param_info;
     uint8_t volSize = 0;
+    bool isSetParamVolume = false;
 
-    PAL_DBG(LOG_TAG, "Enter, session handle - %p", session);
+    PAL_DBG(LOG_TAG, "Enter, session handle - %p ramp %u ms", session, durationMs);
     if (!volume || (volume->no_of_volpair == 0)) {
        PAL_ERR(LOG_TAG, "Invalid arguments");
        status = -EINVAL;
        goto exit;
     }
 
+    memset(&vol_set_param_info, 0, sizeof(struct volume_set_param_info));
+    rm->getVolumeSetParamInfo(&vol_set_param_info);
+    isSetParamVolume = vol_set_param_info.isVolumeUsingSetParam &&
+            (find(vol_set_param_info.streams_.begin(),
+                  vol_set_param_info.streams_.end(), mStreamAttr->type) !=
+             vol_set_param_info.streams_.end());
+    /* the CALIBRATION path below cannot carry a ramp, refuse it up front */
+    if (durationMs && !isSetParamVolume) {
+        PAL_ERR(LOG_TAG, "no volume ramp for stream type %d, set param volume is off",
+                mStreamAttr->type);
+        status = -ENOSYS;
+        goto exit;
+    }
+
     // if already allocated free and reallocate
     if (mVolumeData) {
         free(mVolumeData);
@@ -796,21 +819,34 @@ int32_t StreamCompress::setVolume(struct pal_volume_data *volume)
         goto exit;
     }
 
-    memset(&vol_set_param_info, 0, sizeof(struct volume_set_param_info));
-    rm->getVolumeSetParamInfo(&vol_set_param_info);
     if (rm->cardState == CARD_STATUS_ONLINE && currentState != STREAM_IDLE
         && currentState != STREAM_INIT) {
-        bool isStreamAvail = (find(vol_set_param_info.streams_.begin(),
-                    vol_set_param_info.streams_.end(), mStreamAttr->type) !=
-                    vol_set_param_info.streams_.end());
-        if (isStreamAvail && vol_set_param_info.isVolumeUsingSetParam) {
-            uint8_t *volPayload = new uint8_t[sizeof(pal_param_payload) + volSize]();
+        if (isSetParamVolume) {
+            PayloadWriter writer;
+            uint8_t *volPayload = writer.alloc(sizeof(pal_param_payload) +
+                    sizeof(struct pal_volume_ramp_info) + volSize);
             pal_param_payload *pld = (pal_param_payload *)volPayload;
-            pld->payload_size = sizeof(struct pal_volume_data);
-            memcpy(pld->payload, mVolumeData, volSize);
-            status = session->setParameters(this, TAG_STREAM_VOLUME,
-                    PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)pld);
-            delete[] volPayload;
+
+            if (!volPayload) {
+                status = -ENOMEM;
+                PAL_ERR(LOG_TAG, "failed to alloc volume payload");
+                goto exit;
+            }
+            if (durationMs) {
+                struct pal_volume_ramp_info *ramp = (struct pal_volume_ramp_info *)pld->payload;
+                ramp->duration_ms = durationMs;
+                ramp->curve = curve;
+                pld->payload_size = sizeof(struct pal_volume_ramp_info) + volSize;
+                memcpy(pld->payload + sizeof(struct pal_volume_ramp_info), mVolumeData, volSize);
+                status = session->setParameters(this, TAG_STREAM_VOLUME,
+                        PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM, (void *)pld);
+            } else {
+                pld->payload_size = sizeof(struct pal_volume_data);
+                memcpy(pld->payload, mVolumeData, volSize);
+                status = session->setParameters(this, TAG_STREAM_VOLUME,
+                        PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)pld);
+            }
+            writer.release(volPayload);
         } else {
             status = session->setConfig(this, CALIBRATION, TAG_STREAM_VOLUME);
         }
@@ -110,6 +110,7 @@ StreamInCall::StreamInCall(const struct pal_stream_attributes *sattr, struct pal
         PAL_ERR(LOG_TAG,"out_channels is invalid %d", out_channels);
         mStreamAttr->out_media_config.ch_info.channels = PAL_MAX_CHANNELS_SUPPORTED;
     }
+    publishHotInfo();
 
     PAL_VERBOSE(LOG_TAG, "Create new Session");
     session = Session::makeSession(rm, sattr);
@@ -406,6 +407,7 @@ int32_t  StreamInCall::setStreamAttributes(struct pal_stream_attributes *sattr)
     mStreamMutex.lock();
     ar_mem_cpy (mStreamAttr, sizeof(struct pal_stream_attributes), sattr,
                       sizeof(struct pal_stream_attributes));
+    publishHotInfo();
     mStreamMutex.unlock();
     status = session->setConfig(this, MODULE, 0);  //TODO:gkv or ckv or tkv need to pass
     if (0 != status) {
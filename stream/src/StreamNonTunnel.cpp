@@ -106,6 +106,7 @@ StreamNonTunnel::StreamNonTunnel(const struct pal_stream_attributes *sattr, stru
         PAL_ERR(LOG_TAG,"out_channels is invalid %d", out_channels);
         mStreamAttr->out_media_config.ch_info.channels = PAL_MAX_CHANNELS_SUPPORTED;
     }
+    publishHotInfo();
 
     PAL_VERBOSE(LOG_TAG, "Create new Session");
     session = Session::makeSession(rm, sattr);
@@ -38,6 +38,20 @@
 #include <unistd.h>
 #include <chrono>
 
+static void handleSessionCallBack(uint64_t hdl, uint32_t event_id, void *data,
+                                  uint32_t event_size)
+{
+    StreamPCM *s = reinterpret_cast<StreamPCM *>(hdl);
+
+    /* readiness events of non-blocking streams go to the client */
+    if (event_id == PAL_STREAM_CBK_EVENT_WRITE_READY ||
+        event_id == PAL_STREAM_CBK_EVENT_READ_DONE) {
+        s->notifyClient(event_id, data, event_size);
+        return;
+    }
+    Stream::handleSoftPauseCallBack(hdl, event_id, data, event_size);
+}
+
 StreamPCM::StreamPCM(const struct pal_stream_attributes *sattr, struct pal_device *dattr,
                     const uint32_t no_of_devices, const struct modifier_kv *modifiers,
                     const uint32_t no_of_modifiers, const std::shared_ptr<ResourceManager> rm)
@@ -54,6 +68,7 @@ StreamPCM::StreamPCM(const struct pal_stream_attributes *sattr, struct pal_devic
     }
 
     session = NULL;
+    streamCb = NULL;
     mGainLevel = -1;
     std::shared_ptr<Device> dev = nullptr;
     mStreamAttr = (struct pal_stream_attributes *)nullptr;
@@ -114,6 +129,7 @@ StreamPCM::StreamPCM(const struct pal_stream_attributes *sattr, struct pal_devic
         PAL_ERR(LOG_TAG,"out_channels is invalid %d", out_channels);
         mStreamAttr->out_media_config.ch_info.channels = PAL_MAX_CHANNELS_SUPPORTED;
     }
+    publishHotInfo();
 
     PAL_VERBOSE(LOG_TAG, "Create new Session");
     session = Session::makeSession(rm, sattr);
@@ -161,9 +177,10 @@ StreamPCM::StreamPCM(const struct pal_stream_attributes *sattr, struct pal_devic
     }
 
 
-    // Register for Soft pause events
-    if (mStreamAttr->direction == PAL_AUDIO_OUTPUT )
-        session->registerCallBack(handleSoftPauseCallBack, (uint64_t)this);
+    // Register for Soft pause events and non-blocking readiness events
+    if ((mStreamAttr->direction == PAL_AUDIO_OUTPUT) ||
+        (sattr->flags & PAL_STREAM_FLAG_NON_BLOCKING_MASK))
+        session->registerCallBack(handleSessionCallBack, (uint64_t)this);
 
     mStreamMutex.unlock();
     /* Stream mutex is unlocked before calling stream specific API
@@ -279,6 +296,9 @@ exit:
 int32_t  StreamPCM::close()
 {
     int32_t status = 0;
+
+    if (session)
+        session->cancelIoReady(this);
     mStreamMutex.lock();
 
     if (currentState == STREAM_IDLE) {
@@ -624,8 +644,14 @@ int32_t StreamPCM::stop()
 {
     int32_t status = 0;
 
+    /*
+     * a running readiness callback may be in write/read waiting for
+     * mStreamMutex, cancel it before taking the lock
+     */
+    if (session)
+        session->cancelIoReady(this);
     mStreamMutex.lock();
-    PAL_DBG(LOG_TAG, "Enter. session handle - %pK mStreamAttr->direction - %d state %d",
+    PAL_DBG(LOG_TAG, "Enter. session handle - %pK mStreamAttr->direction - %d state %d
                 session, mStreamAttr->direction, currentState);
 
     if (currentState == STREAM_STARTED || currentState == STREAM_PAUSED) {
@@ -637,6 +663,16 @@ int32_t StreamPCM::stop()
             rm->deregisterDevice(mDevices[i], this);
         }
         rm->unlockActiveStream();
+        /*
+         * only wake a read/write that is in flight, a write on a starved
+         * pcm would otherwise hold mDataPathMutex until it times out, then
+         * wait for it before tearing down the pcm
+         */
+        std::unique_lock<std::mutex> dataLock(mDataPathMutex, std::try_to_lock);
+        if (!dataLock.owns_lock()) {
+            session->wakeDataPath(this);
+            dataLock.lock();
+        }
         switch (mStreamAttr->direction) {
         case PAL_AUDIO_OUTPUT:
             PAL_VERBOSE(LOG_TAG, "In PAL_AUDIO_OUTPUT case, device count - %zu",
@@ -748,7 +784,9 @@ int32_t StreamPCM::prepare()
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
 
     mStreamMutex.lock();
+    mDataPathMutex.lock();
     status = session->prepare(this);
+    mDataPathMutex.unlock();
     if (0 != status)
         PAL_ERR(LOG_TAG, "session prepare failed with status = %d", status);
     mStreamMutex.unlock();
@@ -773,6 +811,7 @@ int32_t  StreamPCM::setStreamAttributes(struct pal_stream_attributes *sattr)
     mStreamMutex.lock();
     ar_mem_cpy (mStreamAttr, sizeof(struct pal_stream_attributes), sattr,
                       sizeof(struct pal_stream_attributes));
+    publishHotInfo();
     mStreamMutex.unlock();
     status = session->setConfig(this, MODULE, 0);  //TODO:gkv or ckv or tkv need to pass
     if (0 != status) {
@@ -787,30 +826,53 @@ exit:
 }
 
 int32_t StreamPCM::setVolume(struct pal_volume_data *volume)
+{
+    return setVolumeRamp(volume, 0, PAL_VOLUME_RAMP_LINEAR);
+}
+
+int32_t StreamPCM::setVolumeRamp(struct pal_volume_data *volume, uint32_t durationMs,
+        pal_volume_ramp_curve_t curve)
 {
     int32_t status = 0;
     struct volume_set_param_info vol_set_param_info;
     uint8_t volSize = 0;
+    bool isSetParamVolume = false;
 
-    PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
+    PAL_DBG(LOG_TAG, "Enter. session handle - %pK ramp %u ms", session, durationMs);
     if (!volume || (volume->no_of_volpair == 0)) {
        PAL_ERR(LOG_TAG, "Invalid arguments");
        status = -EINVAL;
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
+    memset(&vol_set_param_info, 0, sizeof(struct volume_set_param_info));
+    rm->getVolumeSetParamInfo(&vol_set_param_info);
+    isSetParamVolume = vol_set_param_info.isVolumeUsingSetParam &&
+            (find(vol_set_param_info.streams_.begin(),
+                  vol_set_param_info.streams_.end(), mStreamAttr->type) !=
+             vol_set_param_info.streams_.end());
+    /* the CALIBRATION path below cannot carry a ramp, refuse it up front */
+    if (durationMs && !isSetParamVolume) {
+        PAL_ERR(LOG_TAG, "no volume ramp for stream type %d, set param volume is off",
+                mStreamAttr->type);
+        status = -ENOSYS;
+        goto exit;
+    }
+
+    volSize = sizeof(uint32_t) + (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
+    // reuse the cached buffer when the channel count is unchanged
+    if (mVolumeData && (mVolumeData->no_of_volpair != volume->no_of_volpair)) {
         free(mVolumeData);
         mVolumeData = NULL;
     }
 
-    volSize = sizeof(uint32_t) + (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
     if (!mVolumeData) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to calloc for volume data");
-        goto exit;
+        mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
+        if (!mVolumeData) {
+            status = -ENOMEM;
+            PAL_ERR(LOG_TAG, "failed to calloc for volume data");
+            goto exit;
+        }
     }
 
     /* Allow caching of stream volume as part of mVolumeData
@@ -827,21 +889,29 @@ int32_t StreamPCM::setVolume(struct pal_volume_data *volume)
         goto exit;
     }
 
-    memset(&vol_set_param_info, 0, sizeof(struct volume_set_param_info));
-    rm->getVolumeSetParamInfo(&vol_set_param_info);
     if ((rm->cardState == CARD_STATUS_ONLINE) && (currentState != STREAM_IDLE)
             && (currentState != STREAM_INIT)) {
-        bool isStreamAvail = (find(vol_set_param_info.streams_.begin(),
-                    vol_set_param_info.streams_.end(), mStreamAttr->type) !=
-                    vol_set_param_info.streams_.end());
-        if (isStreamAvail && vol_set_param_info.isVolumeUsingSetParam) {
-            uint8_t *volPayload = new uint8_t[sizeof(pal_param_payload) + volSize]();
+        std::lock_guard<std::mutex> dataLock(mDataPathMutex);
+
+        if (isSetParamVolume) {
+            /* volSize is a uint8_t, so the payload always fits on the stack */
+            alignas(8) uint8_t volPayload[sizeof(pal_param_payload) +
+                    sizeof(struct pal_volume_ramp_info) + UINT8_MAX] = {0};
             pal_param_payload *pld = (pal_param_payload *)volPayload;
-            pld->payload_size = sizeof(struct pal_volume_data);
-            memcpy(pld->payload, mVolumeData, volSize);
-            status = session->setParameters(this, TAG_STREAM_VOLUME,
-                    PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)pld);
-            delete[] volPayload;
+            if (durationMs) {
+                struct pal_volume_ramp_info *ramp = (struct pal_volume_ramp_info *)pld->payload;
+                ramp->duration_ms = durationMs;
+                ramp->curve = curve;
+                pld->payload_size = sizeof(struct pal_volume_ramp_info) + volSize;
+                memcpy(pld->payload + sizeof(struct pal_volume_ramp_info), mVolumeData, volSize);
+                status = session->setParameters(this, TAG_STREAM_VOLUME,
+                        PAL_PARAM_ID_VOLUME_RAMP_USING_SET_PARAM, (void *)pld);
+            } else {
+                pld->payload_size = sizeof(struct pal_volume_data);
+                memcpy(pld->payload, mVolumeData, volSize);
+                status = session->setParameters(this, TAG_STREAM_VOLUME,
+                        PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)pld);
+            }
         } else {
             status = session->setConfig(this, CALIBRATION, TAG_STREAM_VOLUME);
         }
@@ -892,7 +962,13 @@ int32_t  StreamPCM::read(struct pal_buffer* buf)
     }
 
     if (currentState == STREAM_STARTED) {
+        mDataPathMutex.lock();
+        mStreamMutex.unlock();
         status = session->read(this, SHMEM_ENDPOINT, buf, &size);
+        mDataPathMutex.unlock();
+        /* non-blocking stream with nothing captured yet */
+        if (status == -EAGAIN)
+            return status;
         if (0 != status) {
             PAL_ERR(LOG_TAG, "session read is failed with status %d", status);
             if (errno == -ENETRESET &&
@@ -902,26 +978,23 @@ int32_t  StreamPCM::read(struct pal_buffer* buf)
                 size = buf->size;
                 status = size;
                 PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
-                goto exit;
             } else if (rm->cardState == CARD_STATUS_OFFLINE) {
                 size = buf->size;
                 status = size;
                 PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
-                goto exit;
-            } else {
-                goto exit;
             }
+            goto exit_unlocked;
         }
     } else {
         PAL_ERR(LOG_TAG, "Stream not started yet, state %d", currentState);
         status = -EINVAL;
         goto exit;
     }
-    mStreamMutex.unlock();
     PAL_VERBOSE(LOG_TAG, "Exit. session read successful size - %d", size);
     return size;
 exit :
     mStreamMutex.unlock();
+exit_unlocked:
     PAL_DBG(LOG_TAG, "Exit. session read failed status %d", status);
     return status;
 }
@@ -965,8 +1038,13 @@ int32_t StreamPCM::write(struct pal_buffer* buf)
     // we should allow writes to go through in Start/Pause state as well.
     if ((currentState == STREAM_STARTED) ||
         (currentState == STREAM_PAUSED) ) {
-        status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
+        mDataPathMutex.lock();
         mStreamMutex.unlock();
+        status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
+        mDataPathMutex.unlock();
+        /* non-blocking stream whose ring is full */
+        if (status == -EAGAIN)
+            return status;
         if (0 != status) {
             PAL_ERR(LOG_TAG, "session write is failed with status %d", status);
 
@@ -1015,16 +1093,39 @@ exit:
     return status;
 }
 
-int32_t  StreamPCM::registerCallBack(pal_stream_callback /*cb*/, uint64_t /*cookie*/)
+int32_t  StreamPCM::registerCallBack(pal_stream_callback cb, uint64_t cookie)
 {
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+
+    streamCb = cb;
+    this->cookie = cookie;
     return 0;
 }
 
-int32_t  StreamPCM::getCallBack(pal_stream_callback * /*cb*/)
+int32_t  StreamPCM::getCallBack(pal_stream_callback *cb)
 {
+    std::lock_guard<std::mutex> lock(mCallbackMutex);
+
+    *cb = streamCb;
     return 0;
 }
 
+/* callback and cookie are read as one pair, the call runs unlocked */
+void StreamPCM::notifyClient(uint32_t event_id, void *data, uint32_t event_size)
+{
+    pal_stream_callback cb = NULL;
+    uint64_t cbCookie = 0;
+
+    mCallbackMutex.lock();
+    cb = streamCb;
+    cbCookie = cookie;
+    mCallbackMutex.unlock();
+
+    if (cb)
+        cb(reinterpret_cast<pal_stream_handle_t *>(this), event_id, (uint32_t *)data,
+           event_size, cbCookie);
+}
+
 int32_t StreamPCM::getParameters(uint32_t /*param_id*/, void ** /*payload*/)
 {
     return 0;
@@ -1052,6 +1153,7 @@ int32_t  StreamPCM::setParameters(uint32_t param_id, void *payload)
         mStreamMutex.unlock();
         return -EINVAL;
     }
+    mDataPathMutex.lock();
     // Stream may not know about tags, so use setParameters instead of setConfig
     switch (param_id) {
         case PAL_PARAM_ID_UIEFFECT:
@@ -1147,6 +1249,7 @@ int32_t  StreamPCM::setParameters(uint32_t param_id, void *payload)
             break;
     }
 
+    mDataPathMutex.unlock();
     mStreamMutex.unlock();
 exit:
     PAL_DBG(LOG_TAG, "exit, session parameter %u set with status %d", param_id, status);
@@ -1156,6 +1259,7 @@ exit:
 int32_t StreamPCM::mute_l(bool state)
 {
     int32_t status = 0;
+    std::lock_guard<std::mutex> dataLock(mDataPathMutex);
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK state %d", session, state);
     status = session->setConfig(this, MODULE, state ? MUTE_TAG : UNMUTE_TAG);
@@ -1177,6 +1281,7 @@ int32_t StreamPCM::mute(bool state)
 int32_t StreamPCM::pause_l()
 {
     int32_t status = 0;
+    std::lock_guard<std::mutex> dataLock(mDataPathMutex);
     std::unique_lock<std::mutex> pauseLock(pauseMutex);
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (rm->cardState == CARD_STATUS_OFFLINE) {
@@ -1223,6 +1328,7 @@ int32_t StreamPCM::pause()
 int32_t StreamPCM::resume_l()
 {
     int32_t status = 0;
+    std::lock_guard<std::mutex> dataLock(mDataPathMutex);
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (rm->cardState == CARD_STATUS_OFFLINE) {
         cachedState = STREAM_STARTED;
@@ -1260,6 +1366,7 @@ int32_t StreamPCM::flush()
     int32_t status = 0;
 
     mStreamMutex.lock();
+    mDataPathMutex.lock();
     if (isPaused == false) {
          PAL_ERR(LOG_TAG, "Error, flush called while stream is not Paused isPaused:%d", isPaused);
          goto exit;
@@ -1277,6 +1384,7 @@ int32_t StreamPCM::flush()
 
     status = session->flush();
 exit:
+    mDataPathMutex.unlock();
     mStreamMutex.unlock();
     return status;
 }
@@ -1350,6 +1458,7 @@ int32_t StreamPCM::addRemoveEffect(pal_audio_effect_t effect, bool enable)
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     mStreamMutex.lock();
+    mDataPathMutex.lock();
     if (!enable) {
         if (PAL_AUDIO_EFFECT_ECNS == effect) {
            tag = ECNS_OFF_TAG;
@@ -1376,6 +1485,7 @@ int32_t StreamPCM::addRemoveEffect(pal_audio_effect_t effect, bool enable)
     PAL_DBG(LOG_TAG, "session setConfig successful");
 exit:
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
+    mDataPathMutex.unlock();
     mStreamMutex.unlock();
     return status;
 }
@@ -1400,6 +1510,7 @@ int32_t StreamPCM::setECRef_l(std::shared_ptr<Device> dev, bool is_enable)
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
 
+    std::lock_guard<std::mutex> dataLock(mDataPathMutex);
     status = session->setECRef(this, dev, is_enable);
     if (status) {
         PAL_ERR(LOG_TAG, "Failed to set ec ref in session");
@@ -63,6 +63,7 @@
 
 #include "StreamSoundTrigger.h"
 
+#include <algorithm>
 #include <chrono>
 #include <unistd.h>
 
@@ -70,6 +71,8 @@
 #include "SessionAlsaPcm.h"
 #include "ResourceManager.h"
 #include "Device.h"
+#include "PalTaskPool.h"
+#include "PalTimerService.h"
 
 // TODO: find another way to print debug logs by default
 #define ST_DBG_LOGS
@@ -107,6 +110,11 @@ StreamSoundTrigger::StreamSoundTrigger(struct pal_stream_attributes *sattr,
     paused_ = false;
     device_opened_ = false;
     pending_stop_ = false;
+    stop_timer_ = 0;
+    last_stop_timer_ = 0;
+    lab_read_active_ = false;
+    lab_read_cfg_.mode = PAL_ST_LAB_READ_PACED;
+    lab_read_cfg_.deadline_ms = 0;
     currentState = STREAM_IDLE;
     capture_requested_ = false;
     hist_buf_duration_ = 0;
@@ -169,6 +177,7 @@ StreamSoundTrigger::StreamSoundTrigger(struct pal_stream_attributes *sattr,
 
     ar_mem_cpy(mStreamAttr, sizeof(pal_stream_attributes),
                      sattr, sizeof(pal_stream_attributes));
+    publishHotInfo();
 
     PAL_VERBOSE(LOG_TAG, "Create new Devices with no_of_devices - %d",
                 no_of_devices);
@@ -233,26 +242,31 @@ StreamSoundTrigger::StreamSoundTrigger(struct pal_stream_attributes *sattr,
         paused_ = true;
     }
 
-    timer_thread_ = std::thread(TimerThread, std::ref(*this));
-    timer_stop_waiting_ = false;
-    exit_timer_thread_ = false;
-
     PAL_DBG(LOG_TAG, "Exit");
 }
 
 StreamSoundTrigger::~StreamSoundTrigger() {
+    uint64_t timer = 0;
+
+    /* a deferred stop already firing sees pending_stop_ cleared and bails */
     mStreamMutex.lock();
+    pending_stop_ = false;
+    mStreamMutex.unlock();
     {
         std::lock_guard<std::mutex> lck(timer_mutex_);
-        exit_timer_thread_ = true;
-        timer_stop_waiting_ = true;
-        timer_wait_cond_.notify_one();
-        timer_start_cond_.notify_one();
-    }
-    if (timer_thread_.joinable()) {
-        PAL_DBG(LOG_TAG, "Join timer thread");
-        timer_thread_.join();
+        timer = last_stop_timer_;
+        stop_timer_ = 0;
     }
+    /*
+     * stop_timer_ is cleared as soon as the callback starts, so wait on the
+     * last handle scheduled, then for the stop it may have posted: a stop
+     * still blocked on mStreamMutex must return before the stream goes away.
+     */
+    if (timer)
+        PalTimerService::getInstance()->cancel(timer, true);
+    PalTaskPool::getInstance()->drain(this);
+
+    mStreamMutex.lock();
 
     st_states_.clear();
     engines_.clear();
@@ -375,40 +389,94 @@ int32_t StreamSoundTrigger::read(struct pal_buffer* buf) {
 
     PAL_VERBOSE(LOG_TAG, "Enter");
 
-    std::lock_guard<std::mutex> lck(mStreamMutex);
-    if (st_info_->GetEnableDebugDumps() && !lab_fd_) {
-        ST_DBG_FILE_OPEN_WR(lab_fd_, ST_DEBUG_DUMP_LOCATION,
-            "lab_reading", "bin", lab_cnt);
-        PAL_DBG(LOG_TAG, "lab data stored in: lab_reading_%d.bin",
-            lab_cnt);
-        lab_cnt++;
-    }
-    if (cur_state_ == st_buffering_ && !this->force_nlpi_vote) {
-        rm->voteSleepMonitor(this, true, true);
-        this->force_nlpi_vote = true;
-    }
+    if (!lab_read_active_) {
+        std::lock_guard<std::mutex> lck(mStreamMutex);
+        if (st_info_->GetEnableDebugDumps() && !lab_fd_) {
+            ST_DBG_FILE_OPEN_WR(lab_fd_, ST_DEBUG_DUMP_LOCATION,
+                "lab_reading", "bin", lab_cnt);
+            PAL_DBG(LOG_TAG, "lab data stored in: lab_reading_%d.bin",
+                lab_cnt);
+            lab_cnt++;
+        }
 
-    std::shared_ptr<StEventConfig> ev_cfg(
-        new StReadBufferEventConfig((void *)buf));
-    size = cur_state_->ProcessEvent(ev_cfg);
+        if (cur_state_ != st_buffering_ || !reader_) {
+            std::shared_ptr<StEventConfig> ev_cfg(
+                new StReadBufferEventConfig((void *)buf));
+            size = cur_state_->ProcessEvent(ev_cfg);
+            if (size <= 0) {
+                sleep_ms = (buf->size * BITS_PER_BYTE * MS_PER_SEC) /
+                    (sm_cfg_->GetSampleRate() * sm_cfg_->GetBitWidth() *
+                     sm_cfg_->GetOutChannels());
+                std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+            }
+            PAL_VERBOSE(LOG_TAG, "Exit, read size %d", size);
+            return size;
+        }
 
-    /*
-     * st stream read pcm data from ringbuffer with almost no
-     * delay, sleep for some time after each read even if read
-     * fails or no enough data in ring buffer
-     */
-    if (size <= 0 || reader_->getUnreadSize() < buf->size) {
-        sleep_ms = (buf->size * BITS_PER_BYTE * MS_PER_SEC) /
-            (sm_cfg_->GetSampleRate() * sm_cfg_->GetBitWidth() *
-             sm_cfg_->GetOutChannels());
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+        if (!this->force_nlpi_vote) {
+            rm->voteSleepMonitor(this, true, true);
+            this->force_nlpi_vote = true;
+        }
+        lab_read_active_ = true;
     }
 
+    size = ReadLabData(buf);
     PAL_VERBOSE(LOG_TAG, "Exit, read size %d", size);
 
     return size;
 }
 
+int32_t StreamSoundTrigger::ReadLabData(struct pal_buffer *buf) {
+    std::lock_guard<std::mutex> lck(lab_read_mutex_);
+    int32_t size = 0;
+    int32_t ret = 0;
+    uint32_t buf_ms = 0;
+
+    /* lost a race with a transition out of buffering */
+    if (!lab_read_active_)
+        return -EIO;
+
+    buf_ms = (buf->size * BITS_PER_BYTE * MS_PER_SEC) /
+        (sm_cfg_->GetSampleRate() * sm_cfg_->GetBitWidth() *
+         sm_cfg_->GetOutChannels());
+    if (!buf_ms)
+        buf_ms = 1;
+    size = reader_->read(buf->buffer, buf->size);
+    switch (lab_read_cfg_.mode) {
+        case PAL_ST_LAB_READ_PARTIAL:
+            break;
+        case PAL_ST_LAB_READ_DEADLINE:
+            /*
+             * Wait in slices of one buffer duration so a transition out
+             * of buffering never blocks on a long client deadline.
+             */
+            if (size < 0 || (size_t)size == buf->size)
+                break;
+            ret = reader_->readUntil(buf->buffer + size, buf->size - size,
+                lab_read_cfg_.deadline_ms, buf_ms,
+                [this] { return lab_read_active_.load(); });
+            if (ret > 0)
+                size += ret;
+            break;
+        default:
+            /*
+             * st stream read pcm data from ringbuffer with almost no
+             * delay, wait up to one buffer duration after each read if
+             * no enough data in ring buffer, but return as soon as the
+             * next buffer has landed
+             */
+            if (size >= 0 && reader_->getUnreadSize() < buf->size)
+                reader_->waitForData(buf->size, buf_ms);
+            break;
+    }
+
+    if (size > 0 && st_info_->GetEnableDebugDumps()) {
+        ST_DBG_FILE_WRITE(lab_fd_, buf->buffer, size);
+    }
+
+    return size;
+}
+
 int32_t StreamSoundTrigger::getParameters(uint32_t param_id, void **payload) {
     int32_t status = 0;
     int32_t ret = 0;
@@ -546,6 +614,21 @@ int32_t StreamSoundTrigger::setParameters(uint32_t param_id, void *payload) {
             status = cur_state_->ProcessEvent(ev_cfg);
             break;
         }
+        case PAL_PARAM_ID_ST_LAB_READ_CONFIG: {
+            if (param_payload->payload_size !=
+                sizeof(pal_param_st_lab_read_config_t)) {
+                PAL_ERR(LOG_TAG, "Invalid lab read config size %u",
+                    param_payload->payload_size);
+                status = -EINVAL;
+                break;
+            }
+            std::lock_guard<std::mutex> lab_lck(lab_read_mutex_);
+            lab_read_cfg_ = *(pal_param_st_lab_read_config_t *)
+                param_payload->payload;
+            PAL_DBG(LOG_TAG, "lab read mode %d, deadline %u ms",
+                lab_read_cfg_.mode, lab_read_cfg_.deadline_ms);
+            break;
+        }
         case PAL_PARAM_ID_STOP_BUFFERING: {
             /*
             * Currently spf needs graph stop and start for next detection.
@@ -949,41 +1032,39 @@ void StreamSoundTrigger::InternalStopRecognition() {
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 }
 
-void StreamSoundTrigger::TimerThread(StreamSoundTrigger& st_stream) {
-    PAL_DBG(LOG_TAG, "Enter");
-
-    std::unique_lock<std::mutex> lck(st_stream.timer_mutex_);
-    while (!st_stream.exit_timer_thread_) {
-        st_stream.timer_start_cond_.wait(lck);
-        if (st_stream.exit_timer_thread_)
-            break;
-
-        st_stream.timer_wait_cond_.wait_for(lck,
-            std::chrono::milliseconds(ST_DEFERRED_STOP_DEALY_MS));
-
-        if (!st_stream.timer_stop_waiting_ && !st_stream.exit_timer_thread_) {
-            st_stream.timer_mutex_.unlock();
-            st_stream.InternalStopRecognition();
-            st_stream.timer_mutex_.lock();
-        }
-    }
-    PAL_DBG(LOG_TAG, "Exit");
-}
-
 void StreamSoundTrigger::PostDelayedStop() {
     PAL_VERBOSE(LOG_TAG, "Post Delayed Stop for %p", this);
     pending_stop_ = true;
     std::lock_guard<std::mutex> lck(timer_mutex_);
-    timer_stop_waiting_ = false;
-    timer_start_cond_.notify_one();
+    /* a stop already counting down is not restarted */
+    if (stop_timer_)
+        return;
+
+    /* the stop takes mStreamMutex, so it runs on the pool, not the timer thread */
+    last_stop_timer_ = stop_timer_ = PalTimerService::getInstance()->schedule(
+        ST_DEFERRED_STOP_DEALY_MS, [this]() {
+            {
+                std::lock_guard<std::mutex> lck(timer_mutex_);
+                stop_timer_ = 0;
+            }
+            PalTaskPool::getInstance()->post(this, [this]() {
+                InternalStopRecognition();
+            });
+        });
 }
 
 void StreamSoundTrigger::CancelDelayedStop() {
     PAL_VERBOSE(LOG_TAG, "Cancel Delayed stop for %p", this);
     pending_stop_ = false;
     std::lock_guard<std::mutex> lck(timer_mutex_);
-    timer_stop_waiting_ = true;
-    timer_wait_cond_.notify_one();
+    /*
+     * Callers hold mStreamMutex, so a stop that is already firing is not
+     * waited for; it sees pending_stop_ cleared and does nothing.
+     */
+    if (stop_timer_) {
+        PalTimerService::getInstance()->cancel(stop_timer_);
+        stop_timer_ = 0;
+    }
 }
 
 std::shared_ptr<SoundTriggerEngine> StreamSoundTrigger::HandleEngineLoad(
@@ -1091,6 +1172,7 @@ void StreamSoundTrigger::updateStreamAttributes() {
             sm_cfg_->GetSampleRate();
         mStreamAttr->in_media_config.bit_width =
             sm_cfg_->GetBitWidth();
+        publishHotInfo();
     }
 }
 
@@ -2873,6 +2955,23 @@ void StreamSoundTrigger::SetDetectedToEngines(bool detected) {
     }
 }
 
+/*
+ * Called by a second stage engine that rejected, before it reports the
+ * reject, so the sibling engine stops consuming buffer right away. No
+ * stream lock: engines_ only changes on load/unload, which cannot run
+ * while second stage processing is in flight.
+ */
+void StreamSoundTrigger::AbortSecondStage(SoundTriggerEngine *rejected) {
+    for (auto& eng: engines_) {
+        if (eng->GetEngineId() != ST_SM_ID_SVA_F_STAGE_GMM &&
+            eng->GetEngine().get() != rejected) {
+            PAL_VERBOSE(LOG_TAG, "Abort second stage engine %d",
+                    eng->GetEngineId());
+            eng->GetEngine()->AbortDetection();
+        }
+    }
+}
+
 pal_device_id_t StreamSoundTrigger::GetAvailCaptureDevice(){
     if (st_info_->GetSupportDevSwitch() &&
         rm->isDeviceAvailable(PAL_DEVICE_IN_WIRED_HEADSET))
@@ -2964,6 +3063,11 @@ void StreamSoundTrigger::TransitTo(int32_t state_id) {
         PAL_ERR(LOG_TAG, "Unknown transit state %d ", state_id);
         return;
     }
+    if (cur_state_ == st_buffering_ && it->second != st_buffering_) {
+        /* wait out an in-flight direct read before reader_ can go away */
+        lab_read_active_ = false;
+        std::lock_guard<std::mutex> lck(lab_read_mutex_);
+    }
     prev_state_ = cur_state_;
     cur_state_ = it->second;
     auto oldState = stStateNameMap.at(prev_state_->GetStateId());
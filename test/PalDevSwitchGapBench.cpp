@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Measures the audio gap of a device switch with 1, 4 and 8 playback
+ * streams on the speaker. Each switch moves every stream on the device at
+ * once, the way a device config change or forced route does, to the other
+ * device and back. After every switch the gap is read back with
+ * PAL_PARAM_ID_DEVICE_SWITCH_STATS: the longest time any one stream spent
+ * between its disconnect and its reconnect. The wall time of the whole
+ * switch is reported next to it, and whether the resource manager moved
+ * the streams one at a time, which it only does for device pairs listed as
+ * per_stream_dev_switch in the resource manager xml.
+ *
+ * A switch counts only if the stats show exactly one new switch, with a
+ * zero status and all streams moved; anything else fails the run.
+ *
+ * Runs on target. The streams are started but not fed, nothing is heard.
+ */
+
+#define LOG_TAG "PAL: PalDevSwitchGapBench"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "PalApi.h"
+#include "ResourceManager.h"
+#include "Device.h"
+
+#define BENCH_SAMPLE_RATE 48000
+#define BENCH_CHANNELS 2
+#define BENCH_DEFAULT_SWITCHES 10
+
+typedef std::chrono::steady_clock BenchClock;
+
+static const uint32_t kStreamCounts[] = {1, 4, 8};
+
+/* spread the streams over types, the instance limit per type is small */
+static const pal_stream_type_t kStreamTypes[] = {
+    PAL_STREAM_LOW_LATENCY,
+    PAL_STREAM_DEEP_BUFFER,
+    PAL_STREAM_PCM_OFFLOAD,
+};
+
+struct GapStats {
+    uint32_t switches;
+    int64_t total_gap_us;
+    int64_t max_gap_us;
+    uint64_t total_switch_us;
+    uint32_t per_stream;
+};
+
+static void FillMediaConfig(struct pal_media_config *config)
+{
+    config->sample_rate = BENCH_SAMPLE_RATE;
+    config->bit_width = 16;
+    config->aud_fmt_id = PAL_AUDIO_FMT_PCM_S16_LE;
+    config->ch_info.channels = BENCH_CHANNELS;
+    config->ch_info.ch_map[0] = PAL_CHMAP_CHANNEL_FL;
+    config->ch_info.ch_map[1] = PAL_CHMAP_CHANNEL_FR;
+}
+
+static int32_t OpenPlayback(pal_stream_type_t type, pal_stream_handle_t **handle)
+{
+    struct pal_stream_attributes attr;
+    struct pal_device device;
+    int32_t status = 0;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = type;
+    attr.direction = PAL_AUDIO_OUTPUT;
+    FillMediaConfig(&attr.out_media_config);
+
+    memset(&device, 0, sizeof(device));
+    device.id = PAL_DEVICE_OUT_SPEAKER;
+    device.config = attr.out_media_config;
+
+    status = pal_stream_open(&attr, 1, &device, 0, NULL, NULL, 0, handle);
+    if (status) {
+        fprintf(stderr, "pal_stream_open type %d failed: %d\n", type, status);
+        return status;
+    }
+    status = pal_stream_start(*handle);
+    if (status) {
+        fprintf(stderr, "pal_stream_start type %d failed: %d\n", type, status);
+        pal_stream_close(*handle);
+        *handle = NULL;
+    }
+    return status;
+}
+
+static void CloseAll(std::vector<pal_stream_handle_t *> &handles)
+{
+    for (pal_stream_handle_t *handle : handles) {
+        pal_stream_stop(handle);
+        pal_stream_close(handle);
+    }
+    handles.clear();
+}
+
+static int32_t GetSwitchStats(pal_param_device_switch_stats_t *gap)
+{
+    void *payload = gap;
+    size_t size = 0;
+    int32_t status = 0;
+
+    memset(gap, 0, sizeof(*gap));
+    status = pal_get_param(PAL_PARAM_ID_DEVICE_SWITCH_STATS, &payload, &size, NULL);
+    if (status)
+        fprintf(stderr, "pal_get_param failed: %d\n", status);
+    return status;
+}
+
+/* moves every stream on from to the to device, then reads the gap back */
+static int32_t SwitchOnce(ResourceManager *rm, pal_device_id_t from,
+                          struct pal_device *to, uint32_t streams,
+                          struct GapStats *stats)
+{
+    pal_param_device_switch_stats_t gap;
+    BenchClock::time_point start;
+    uint32_t switches = 0;
+    uint64_t us = 0;
+    int32_t status = 0;
+
+    status = GetSwitchStats(&gap);
+    if (status)
+        return status;
+    switches = gap.switches;
+
+    start = BenchClock::now();
+    status = rm->forceDeviceSwitch(Device::getObject(from), to);
+    us = std::chrono::duration_cast<std::chrono::microseconds>(
+        BenchClock::now() - start).count();
+    if (status) {
+        fprintf(stderr, "switch %d -> %d failed: %d\n", from, to->id, status);
+        return status;
+    }
+
+    status = GetSwitchStats(&gap);
+    if (status)
+        return status;
+    if (gap.switches != switches + 1) {
+        fprintf(stderr, "switch %d -> %d did %u switches, expected 1\n",
+                from, to->id, gap.switches - switches);
+        return -EINVAL;
+    }
+    if (gap.last_status) {
+        fprintf(stderr, "switch %d -> %d failed: %d\n", from, to->id,
+                gap.last_status);
+        return gap.last_status;
+    }
+    if (gap.last_streams != streams) {
+        fprintf(stderr, "switch %d -> %d moved %u streams, expected %u\n",
+                from, to->id, gap.last_streams, streams);
+        return -EINVAL;
+    }
+
+    stats->switches++;
+    stats->total_gap_us += gap.last_gap_us;
+    if (gap.last_gap_us > stats->max_gap_us)
+        stats->max_gap_us = gap.last_gap_us;
+    stats->total_switch_us += us;
+    if (gap.last_per_stream)
+        stats->per_stream++;
+    return 0;
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-n <switches>] [-d <device id>]\n"
+        "  -n <switches>   round trips per stream count, default %d\n"
+        "  -d <device id>  device to switch to from the speaker, default %d\n",
+        prog, BENCH_DEFAULT_SWITCHES, PAL_DEVICE_OUT_HANDSET);
+}
+
+int main(int argc, char *argv[])
+{
+    std::shared_ptr<ResourceManager> rm;
+    std::vector<pal_stream_handle_t *> handles;
+    pal_stream_handle_t *handle = NULL;
+    struct pal_device speaker;
+    struct pal_device other;
+    struct GapStats stats;
+    uint32_t switches = BENCH_DEFAULT_SWITCHES;
+    int32_t status = 0;
+    int opt = 0;
+
+    memset(&other, 0, sizeof(other));
+    other.id = PAL_DEVICE_OUT_HANDSET;
+    while ((opt = getopt(argc, argv, "n:d:h")) != -1) {
+        switch (opt) {
+        case 'n': switches = atoi(optarg); break;
+        case 'd': other.id = (pal_device_id_t)atoi(optarg); break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (!switches || other.id == PAL_DEVICE_OUT_SPEAKER) {
+        Usage(argv[0]);
+        return -EINVAL;
+    }
+    memset(&speaker, 0, sizeof(speaker));
+    speaker.id = PAL_DEVICE_OUT_SPEAKER;
+    FillMediaConfig(&speaker.config);
+    FillMediaConfig(&other.config);
+
+    status = pal_init();
+    if (status) {
+        fprintf(stderr, "pal_init failed: %d\n", status);
+        return status;
+    }
+    rm = ResourceManager::getInstance();
+
+    fprintf(stdout, "%8s %9s %11s %12s %12s %14s\n", "streams", "switches",
+            "per stream", "avg gap us", "max gap us", "avg switch us");
+    for (uint32_t count : kStreamCounts) {
+        memset(&stats, 0, sizeof(stats));
+        for (uint32_t i = 0; i < count && !status; i++) {
+            status = OpenPlayback(kStreamTypes[i % (sizeof(kStreamTypes) /
+                                  sizeof(kStreamTypes[0]))], &handle);
+            if (!status)
+                handles.push_back(handle);
+        }
+        for (uint32_t n = 0; n < switches && !status; n++) {
+            status = SwitchOnce(rm.get(), PAL_DEVICE_OUT_SPEAKER, &other, count,
+                                &stats);
+            if (!status)
+                status = SwitchOnce(rm.get(), other.id, &speaker, count, &stats);
+        }
+        CloseAll(handles);
+        if (status)
+            break;
+
+        fprintf(stdout, "%8u %9u %11u %12.1f %12lld %14.1f\n", count,
+                stats.switches, stats.per_stream,
+                (double)stats.total_gap_us / stats.switches,
+                (long long)stats.max_gap_us,
+                (double)stats.total_switch_us / stats.switches);
+    }
+
+    pal_deinit();
+    return status;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Checks that ResourceManager::getDeviceInfo, which answers from the table
+ * built at init, returns exactly what the original deviceInfo scan
+ * (scanDeviceInfo) returns. Runs on target against the resourcemanager XML
+ * the platform loads, for every device id, stream type and custom config
+ * key found in it, plus an empty and an unknown key. Optionally times both
+ * paths. Returns non-zero if any query differs.
+ *
+ * With -c <configs dir> (e.g. configs/ pushed to the device) it instead
+ * reparses each <configs dir>/<target>/resourcemanager*.xml in turn,
+ * rebuilds the table and checks it the same way. Only the device info is
+ * reset between files, the rest of the parsed state piles up, so the
+ * process is good for nothing else afterwards.
+ */
+
+#define LOG_TAG "PAL: PalDeviceInfoTest"
+
+#include <errno.h>
+#include <getopt.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ResourceManager.h"
+
+typedef std::chrono::steady_clock TestClock;
+
+/* reaches the parsed deviceInfo, never instantiated */
+class DeviceInfoProbe : public ResourceManager
+{
+public:
+    static const std::vector<deviceIn> &devices() { return deviceInfo; }
+    static void clearDevices() { deviceInfo.clear(); }
+};
+
+static void ResetDevInfo(struct pal_device_info *devinfo)
+{
+    devinfo->channels = 0;
+    devinfo->max_channels = 0;
+    devinfo->samplerate = 0;
+    devinfo->sndDevName.clear();
+    devinfo->isExternalECRefEnabledFlag = false;
+    devinfo->priority = 0;
+    devinfo->fractionalSRSupported = false;
+    devinfo->channels_overwrite = false;
+    devinfo->samplerate_overwrite = false;
+    devinfo->sndDevName_overwrite = false;
+    devinfo->bit_width_overwrite = false;
+    devinfo->bit_width = 0;
+    devinfo->bitFormatSupported = PAL_AUDIO_FMT_DEFAULT_PCM;
+}
+
+static bool SameDevInfo(const struct pal_device_info &a,
+                        const struct pal_device_info &b)
+{
+    return a.channels == b.channels &&
+           a.max_channels == b.max_channels &&
+           a.samplerate == b.samplerate &&
+           a.sndDevName == b.sndDevName &&
+           a.isExternalECRefEnabledFlag == b.isExternalECRefEnabledFlag &&
+           a.priority == b.priority &&
+           a.fractionalSRSupported == b.fractionalSRSupported &&
+           a.channels_overwrite == b.channels_overwrite &&
+           a.samplerate_overwrite == b.samplerate_overwrite &&
+           a.sndDevName_overwrite == b.sndDevName_overwrite &&
+           a.bit_width_overwrite == b.bit_width_overwrite &&
+           a.bit_width == b.bit_width &&
+           a.bitFormatSupported == b.bitFormatSupported;
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-n <iterations>] [-c <configs dir>]\n"
+        "  -n <iterations>   also time both lookups over all queries\n"
+        "  -c <configs dir>  check every <dir>/*/resourcemanager*.xml instead\n"
+        "                    of the one the platform loaded\n",
+        prog);
+}
+
+/* compares both lookups over the parsed deviceInfo, returns the mismatches */
+static uint32_t CheckDeviceInfo(ResourceManager *rm, const char *name,
+                                uint32_t iterations)
+{
+    std::set<std::string> keys;
+    struct pal_device_info table;
+    struct pal_device_info scan;
+    TestClock::time_point start;
+    uint64_t table_us = 0;
+    uint64_t scan_us = 0;
+    uint32_t queries = 0;
+    uint32_t mismatches = 0;
+
+    keys.insert("");
+    keys.insert("PalDeviceInfoTest-unknown-key");
+    for (const deviceIn &dev : DeviceInfoProbe::devices())
+        for (const usecase_info &uc : dev.usecase)
+            for (const usecase_custom_config_info &cfg : uc.config)
+                keys.insert(cfg.key);
+
+    for (int32_t dev = PAL_DEVICE_OUT_MIN; dev < PAL_DEVICE_IN_MAX; dev++) {
+        for (int32_t type = 0; type < PAL_STREAM_MAX; type++) {
+            for (const std::string &key : keys) {
+                ResetDevInfo(&table);
+                ResetDevInfo(&scan);
+                rm->getDeviceInfo((pal_device_id_t)dev, (pal_stream_type_t)type,
+                                  key, &table);
+                rm->scanDeviceInfo((pal_device_id_t)dev, (pal_stream_type_t)type,
+                                   &key, &scan);
+                queries++;
+                if (SameDevInfo(table, scan))
+                    continue;
+                mismatches++;
+                fprintf(stderr, "%s: mismatch dev %d type %d key '%s': table %d ch "
+                        "%d Hz %s, scan %d ch %d Hz %s\n", name, dev, type,
+                        key.c_str(), table.channels, table.samplerate,
+                        table.sndDevName.c_str(), scan.channels, scan.samplerate,
+                        scan.sndDevName.c_str());
+            }
+        }
+    }
+    fprintf(stdout, "%s: %zu device entries, %zu keys, %u queries, %u mismatches\n",
+            name, DeviceInfoProbe::devices().size(), keys.size(), queries,
+            mismatches);
+    if (mismatches || !iterations)
+        return mismatches;
+
+    for (int32_t pass = 0; pass < 2; pass++) {
+        start = TestClock::now();
+        for (uint32_t n = 0; n < iterations; n++) {
+            for (int32_t dev = PAL_DEVICE_OUT_MIN; dev < PAL_DEVICE_IN_MAX; dev++) {
+                for (int32_t type = 0; type < PAL_STREAM_MAX; type++) {
+                    for (const std::string &key : keys) {
+                        if (pass)
+                            rm->scanDeviceInfo((pal_device_id_t)dev,
+                                (pal_stream_type_t)type, &key, &scan);
+                        else
+                            rm->getDeviceInfo((pal_device_id_t)dev,
+                                (pal_stream_type_t)type, key, &table);
+                    }
+                }
+            }
+        }
+        (pass ? scan_us : table_us) =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                TestClock::now() - start).count();
+    }
+    fprintf(stdout, "%s: lookup ns: table %.1f, scan %.1f\n", name,
+            table_us * 1000.0 / ((uint64_t)queries * iterations),
+            scan_us * 1000.0 / ((uint64_t)queries * iterations));
+
+    return 0;
+}
+
+static int CheckAll(ResourceManager *rm, const char *configsDir,
+                    uint32_t iterations)
+{
+    std::string pattern = std::string(configsDir) + "/*/resourcemanager*.xml";
+    glob_t found;
+    uint32_t failed = 0;
+    int status = 0;
+
+    status = glob(pattern.c_str(), 0, NULL, &found);
+    if (status) {
+        fprintf(stderr, "no resourcemanager xml matches %s\n", pattern.c_str());
+        return -ENOENT;
+    }
+    for (size_t i = 0; i < found.gl_pathc; i++) {
+        DeviceInfoProbe::clearDevices();
+        status = ResourceManager::XmlParser(found.gl_pathv[i]);
+        if (status) {
+            fprintf(stderr, "%s: parse failed: %d\n", found.gl_pathv[i], status);
+            failed++;
+            continue;
+        }
+        rm->buildDeviceInfoTable();
+        if (CheckDeviceInfo(rm, found.gl_pathv[i], iterations))
+            failed++;
+    }
+    fprintf(stdout, "%zu xml files, %u failed\n", found.gl_pathc, failed);
+    globfree(&found);
+
+    return failed ? -EINVAL : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::shared_ptr<ResourceManager> rm;
+    const char *configsDir = NULL;
+    uint32_t iterations = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:c:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); break;
+        case 'c': configsDir = optarg; break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+
+    try {
+        rm = ResourceManager::getInstance();
+    } catch (const std::exception &e) {
+        fprintf(stderr, "ResourceManager init failed: %s\n", e.what());
+        return -EINVAL;
+    }
+
+    if (configsDir)
+        return CheckAll(rm.get(), configsDir, iterations);
+    return CheckDeviceInfo(rm.get(), "loaded xml", iterations) ? -EINVAL : 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Times the usecase KV resolution streams and devices do at open,
+ * PayloadBuilder::findKVs with its per block selector index, against the
+ * linear walk it replaced (every entry through compareSelectorPairs). Run
+ * it with one or more usecaseKvManager.xml files, e.g. each of
+ * configs/<target>/usecaseKvManager.xml pushed to the device.
+ *
+ * For every entry of every stream, streampp, device and devicepp block it
+ * queries the entry's own selectors, the same minus one selector (resolved
+ * by a superset entry) and a set no entry has, for each id of the block.
+ * Both searches must return the same KVs; any difference fails the run.
+ */
+
+#define LOG_TAG "PAL: PalKvBench"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "PayloadBuilder.h"
+
+#define BENCH_DEFAULT_ITERATIONS 100
+
+typedef std::chrono::steady_clock BenchClock;
+
+typedef std::vector<std::pair<selector_type_t, std::string>> SelectorPairs;
+
+struct KvQuery {
+    std::vector<allKVs> *table;
+    uint32_t type;
+    SelectorPairs selectors;
+};
+
+/* reaches the parsed KV tables, never instantiated */
+class KvProbe : public PayloadBuilder
+{
+public:
+    static std::vector<allKVs> *table(int index)
+    {
+        std::vector<allKVs> *tables[] = {&all_streams, &all_streampps,
+                                         &all_devices, &all_devicepps};
+
+        return tables[index];
+    }
+};
+
+/* findKVs as it was before the selector index */
+static bool LinearFindKVs(SelectorPairs &filled_selector_pairs, uint32_t type,
+                          std::vector<allKVs> &any_type,
+                          std::vector<std::pair<int, int>> &keyVector)
+{
+    bool found = false;
+
+    for (size_t i = 0; i < any_type.size(); i++) {
+        if (!PayloadBuilder::isIdTypeAvailable(type, any_type[i].id_type))
+            continue;
+        for (size_t j = 0; j < any_type[i].keys_values.size(); j++) {
+            kvInfo &entry = any_type[i].keys_values[j];
+
+            if (filled_selector_pairs.empty() ?
+                    !entry.selector_pairs.empty() :
+                    !PayloadBuilder::compareSelectorPairs(entry.selector_pairs,
+                        filled_selector_pairs))
+                continue;
+            for (size_t k = 0; k < entry.kv_pairs.size(); k++) {
+                keyVector.push_back(std::make_pair(entry.kv_pairs[k].key,
+                    entry.kv_pairs[k].value));
+                PAL_INFO(LOG_TAG, "key: 0x%x value: 0x%x\n",
+                    entry.kv_pairs[k].key, entry.kv_pairs[k].value);
+            }
+            found = true;
+            break;
+        }
+    }
+    return found;
+}
+
+static void BuildQueries(std::vector<KvQuery> &queries)
+{
+    KvQuery query;
+
+    queries.clear();
+    for (int t = 0; t < 4; t++) {
+        query.table = KvProbe::table(t);
+        for (const allKVs &block : *query.table) {
+            for (int32_t type : block.id_type) {
+                query.type = type;
+                for (const kvInfo &entry : block.keys_values) {
+                    query.selectors = entry.selector_pairs;
+                    queries.push_back(query);
+                    if (query.selectors.empty())
+                        continue;
+                    query.selectors.pop_back();
+                    queries.push_back(query);
+                    query.selectors = entry.selector_pairs;
+                    query.selectors.back().second = "PalKvBench-none";
+                    queries.push_back(query);
+                }
+            }
+        }
+    }
+}
+
+static uint64_t TimeQueries(std::vector<KvQuery> &queries, uint32_t iterations,
+                            bool linear)
+{
+    BenchClock::time_point start = BenchClock::now();
+    std::vector<std::pair<int, int>> kv;
+    SelectorPairs selectors;
+
+    for (uint32_t n = 0; n < iterations; n++) {
+        for (KvQuery &q : queries) {
+            /* findKVs sorts the query in place, as retrieveKVs lets it */
+            selectors = q.selectors;
+            kv.clear();
+            if (linear)
+                LinearFindKVs(selectors, q.type, *q.table, kv);
+            else
+                PayloadBuilder::findKVs(selectors, q.type, *q.table, kv);
+        }
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        BenchClock::now() - start).count();
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-n <iterations>] <usecaseKvManager.xml>...\n"
+        "  -n <iterations>  passes over all queries per xml, default %d\n",
+        prog, BENCH_DEFAULT_ITERATIONS);
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<char> xml;
+    std::vector<KvQuery> queries;
+    std::vector<std::pair<int, int>> indexedKv;
+    std::vector<std::pair<int, int>> linearKv;
+    SelectorPairs selectors;
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    uint32_t mismatches = 0;
+    uint64_t xml_hash = 0;
+    uint64_t indexed_ns = 0;
+    uint64_t linear_ns = 0;
+    int status = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (!iterations || optind >= argc) {
+        Usage(argv[0]);
+        return -EINVAL;
+    }
+
+    fprintf(stdout, "%-48s %8s %12s %12s\n", "xml", "queries", "indexed ns",
+            "linear ns");
+    for (int i = optind; i < argc; i++) {
+        status = PayloadBuilder::readKVXml(argv[i], xml, &xml_hash);
+        if (!status)
+            status = PayloadBuilder::parseKVXml(xml);
+        if (status) {
+            fprintf(stderr, "failed to parse %s: %d\n", argv[i], status);
+            return status;
+        }
+        BuildQueries(queries);
+        if (queries.empty())
+            continue;
+
+        for (KvQuery &q : queries) {
+            indexedKv.clear();
+            linearKv.clear();
+            selectors = q.selectors;
+            PayloadBuilder::findKVs(selectors, q.type, *q.table, indexedKv);
+            selectors = q.selectors;
+            LinearFindKVs(selectors, q.type, *q.table, linearKv);
+            if (indexedKv != linearKv)
+                mismatches++;
+        }
+
+        indexed_ns = TimeQueries(queries, iterations, false);
+        linear_ns = TimeQueries(queries, iterations, true);
+        fprintf(stdout, "%-48s %8zu %12.1f %12.1f\n", argv[i], queries.size(),
+                (double)indexed_ns / ((uint64_t)queries.size() * iterations),
+                (double)linear_ns / ((uint64_t)queries.size() * iterations));
+    }
+    if (mismatches)
+        fprintf(stderr, "%u queries resolved to different KVs\n", mismatches);
+
+    return mismatches ? -EINVAL : 0;
+}
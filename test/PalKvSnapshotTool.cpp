@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Generates or verifies the usecaseKvManager KV snapshot that
+ * PayloadBuilder::init loads instead of parsing the xml.
+ *
+ *   -g: parse the xml and write the snapshot, e.g. to prebuild it for an
+ *       image or to refresh the one in /data after a manual xml edit.
+ *   -v: parse the xml, load the snapshot the way init does and check both
+ *       give identical KV tables. Fails on a stale snapshot (other xml or
+ *       other LUTs) as well as on a content mismatch.
+ *   -r: -g then -v for every configs/<target>/usecaseKvManager*.xml under
+ *       the given directory, e.g. the configs tree pushed to the device.
+ *
+ * With -n it also times xml parse against snapshot load.
+ */
+
+#define LOG_TAG "PAL: PalKvSnapshotTool"
+
+#include <errno.h>
+#include <getopt.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "PayloadBuilder.h"
+
+typedef std::chrono::steady_clock ToolClock;
+
+static uint64_t ElapsedUs(ToolClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        ToolClock::now() - start).count();
+}
+
+/* parse xmlFile, load snapshotFile the way init does and compare */
+static int VerifySnapshot(const char *xmlFile, const char *snapshotFile,
+                          uint32_t iterations)
+{
+    std::vector<char> xml;
+    std::vector<uint8_t> parsed;
+    std::vector<uint8_t> loaded;
+    ToolClock::time_point start;
+    uint64_t xml_hash = 0;
+    uint64_t parse_us = 0;
+    uint64_t load_us = 0;
+    int status = 0;
+
+    status = PayloadBuilder::readKVXml(xmlFile, xml, &xml_hash);
+    if (!status)
+        status = PayloadBuilder::parseKVXml(xml);
+    if (status) {
+        fprintf(stderr, "failed to parse %s: %d\n", xmlFile, status);
+        return status;
+    }
+    PayloadBuilder::serializeKVTables(parsed);
+    status = PayloadBuilder::loadKVSnapshot(snapshotFile, xml_hash);
+    if (status) {
+        fprintf(stderr, "%s is missing, stale or corrupt: %d\n",
+                snapshotFile, status);
+        return status;
+    }
+    PayloadBuilder::serializeKVTables(loaded);
+    if (parsed != loaded) {
+        fprintf(stderr, "%s loads tables that differ from the xml\n",
+                snapshotFile);
+        return -EINVAL;
+    }
+    fprintf(stdout, "%s matches %s, %zu bytes of KV tables\n",
+            snapshotFile, xmlFile, parsed.size());
+
+    for (uint32_t n = 0; n < iterations; n++) {
+        start = ToolClock::now();
+        PayloadBuilder::parseKVXml(xml);
+        parse_us += ElapsedUs(start);
+        start = ToolClock::now();
+        PayloadBuilder::loadKVSnapshot(snapshotFile, xml_hash);
+        load_us += ElapsedUs(start);
+    }
+    if (iterations)
+        fprintf(stdout, "avg us: xml parse %.1f, snapshot load %.1f\n",
+                (double)parse_us / iterations, (double)load_us / iterations);
+
+    return 0;
+}
+
+static int WriteSnapshot(const char *xmlFile, const char *snapshotFile)
+{
+    std::vector<char> xml;
+    uint64_t xml_hash = 0;
+    int status = 0;
+
+    status = PayloadBuilder::readKVXml(xmlFile, xml, &xml_hash);
+    if (!status)
+        status = PayloadBuilder::parseKVXml(xml);
+    if (status) {
+        fprintf(stderr, "failed to parse %s: %d\n", xmlFile, status);
+        return status;
+    }
+    status = PayloadBuilder::saveKVSnapshot(snapshotFile, xml_hash);
+    if (status)
+        fprintf(stderr, "failed to write %s: %d\n", snapshotFile, status);
+    return status;
+}
+
+/*
+ * Round trips every <configsDir>/<target>/usecaseKvManager*.xml through a
+ * snapshot written next to it, so a format change is checked against the
+ * xml of every target rather than the one on the device.
+ */
+static int RoundTripAll(const char *configsDir, uint32_t iterations)
+{
+    std::string pattern = std::string(configsDir) + "/*/usecaseKvManager*.xml";
+    std::string snapshot;
+    glob_t found;
+    uint32_t failed = 0;
+    int status = 0;
+
+    status = glob(pattern.c_str(), 0, NULL, &found);
+    if (status) {
+        fprintf(stderr, "no usecase xml matches %s\n", pattern.c_str());
+        return -ENOENT;
+    }
+    for (size_t i = 0; i < found.gl_pathc; i++) {
+        snapshot = std::string(found.gl_pathv[i]) + ".snapshot";
+        status = WriteSnapshot(found.gl_pathv[i], snapshot.c_str());
+        if (!status)
+            status = VerifySnapshot(found.gl_pathv[i], snapshot.c_str(),
+                                    iterations);
+        unlink(snapshot.c_str());
+        if (status)
+            failed++;
+    }
+    fprintf(stdout, "%zu xml checked, %u failed\n", (size_t)found.gl_pathc,
+            failed);
+    globfree(&found);
+
+    return failed ? -EINVAL : 0;
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s -g|-v [-n <iterations>] <usecaseKvManager.xml> <snapshot.bin>\n"
+        "       %s -r [-n <iterations>] <configs dir>\n"
+        "  -g               write the snapshot from the xml\n"
+        "  -v               check the snapshot matches the xml\n"
+        "  -r               round trip every <configs dir>/*/usecaseKvManager*.xml\n"
+        "  -n <iterations>  with -v or -r, time xml parse vs snapshot load\n",
+        prog, prog);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = 0;
+    char mode = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "gvrn:h")) != -1) {
+        switch (opt) {
+        case 'g':
+        case 'v':
+        case 'r': mode = opt; break;
+        case 'n': iterations = atoi(optarg); break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (!mode || argc - optind != (mode == 'r' ? 1 : 2)) {
+        Usage(argv[0]);
+        return -EINVAL;
+    }
+
+    if (mode == 'r')
+        return RoundTripAll(argv[optind], iterations);
+    if (mode == 'g')
+        return WriteSnapshot(argv[optind], argv[optind + 1]);
+    return VerifySnapshot(argv[optind], argv[optind + 1], iterations);
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Counts heap allocations on the volume set-param payload path. malloc,
+ * calloc and realloc are interposed by this executable, so allocations made
+ * inside libar-pal are seen too. Each case builds the payloads the Pcm and
+ * Compress sessions send for a volume or volume ramp change and checks the
+ * steady state allocates nothing. The "hook" case builds without a writer
+ * and must see one allocation per payload, proving the counter works.
+ *
+ * Only the PayloadBuilder calls are covered. SessionAlsaPcm/Compress::
+ * setParameters itself (MIID lookup, setParam control name, the mixer
+ * write) is not driven here, it needs an open session on target, so
+ * allocations made there go unchecked.
+ */
+
+#define LOG_TAG "PAL: PalPayloadAllocTest"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#include "PalTestRunner.h"
+#include "PayloadBuilder.h"
+
+#define TEST_ITERATIONS 1000
+#define TEST_MIID 0x4001
+#define TEST_MAX_VOLPAIRS 8
+
+typedef void *(*MallocFn)(size_t);
+typedef void *(*CallocFn)(size_t, size_t);
+typedef void *(*ReallocFn)(void *, size_t);
+typedef void (*FreeFn)(void *);
+
+static MallocFn gRealMalloc;
+static CallocFn gRealCalloc;
+static ReallocFn gRealRealloc;
+static FreeFn gRealFree;
+static std::atomic<bool> gCounting(false);
+static std::atomic<uint64_t> gAllocs(0);
+
+/* serves the allocations dlsym itself makes while the hooks resolve */
+alignas(16) static char gBootstrap[4096];
+static size_t gBootstrapUsed;
+static bool gResolving;
+
+static bool IsBootstrap(void *ptr)
+{
+    return (char *)ptr >= gBootstrap && (char *)ptr < gBootstrap + sizeof(gBootstrap);
+}
+
+static void *BootstrapAlloc(size_t size)
+{
+    void *ptr = nullptr;
+
+    size = (size + 15) & ~(size_t)15;
+    if (gBootstrapUsed + size > sizeof(gBootstrap))
+        return nullptr;
+    ptr = gBootstrap + gBootstrapUsed;
+    gBootstrapUsed += size;
+    return ptr;
+}
+
+static bool ResolveAllocator()
+{
+    if (gRealFree)
+        return true;
+    if (gResolving)
+        return false;
+    gResolving = true;
+    gRealMalloc = (MallocFn)dlsym(RTLD_NEXT, "malloc");
+    gRealCalloc = (CallocFn)dlsym(RTLD_NEXT, "calloc");
+    gRealRealloc = (ReallocFn)dlsym(RTLD_NEXT, "realloc");
+    gRealFree = (FreeFn)dlsym(RTLD_NEXT, "free");
+    gResolving = false;
+    return gRealFree != nullptr;
+}
+
+extern "C" void *malloc(size_t size)
+{
+    if (!ResolveAllocator())
+        return BootstrapAlloc(size);
+    if (gCounting)
+        gAllocs++;
+    return gRealMalloc(size);
+}
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+    if (!ResolveAllocator())
+        return BootstrapAlloc(nmemb * size);
+    if (gCounting)
+        gAllocs++;
+    return gRealCalloc(nmemb, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    void *moved = nullptr;
+
+    if (!ResolveAllocator())
+        return nullptr;
+    if (gCounting)
+        gAllocs++;
+    if (!IsBootstrap(ptr))
+        return gRealRealloc(ptr, size);
+    moved = gRealMalloc(size);
+    if (moved)
+        memcpy(moved, ptr, std::min(size,
+            (size_t)(gBootstrap + sizeof(gBootstrap) - (char *)ptr)));
+    return moved;
+}
+
+extern "C" void free(void *ptr)
+{
+    if (!ptr || IsBootstrap(ptr))
+        return;
+    if (ResolveAllocator())
+        gRealFree(ptr);
+}
+
+/* volume data as the HAL passes it: a header followed by volume pairs */
+struct TestVolumeData {
+    alignas(struct pal_volume_data) uint8_t raw[sizeof(struct pal_volume_data) +
+        TEST_MAX_VOLPAIRS * sizeof(struct pal_channel_vol_kv)];
+};
+
+static struct pal_volume_data *FillVolume(struct TestVolumeData *vol, uint32_t pairs)
+{
+    struct pal_volume_data *data = (struct pal_volume_data *)vol->raw;
+
+    memset(vol, 0, sizeof(*vol));
+    data->no_of_volpair = pairs;
+    for (uint32_t i = 0; i < pairs; i++) {
+        data->volume_pair[i].channel_mask = i;
+        data->volume_pair[i].vol = 0.5f;
+    }
+    return data;
+}
+
+static bool InWriter(const PayloadWriter &writer, const uint8_t *payload)
+{
+    return payload >= (const uint8_t *)&writer &&
+           payload < (const uint8_t *)&writer + sizeof(writer);
+}
+
+static uint64_t StopCounting(uint64_t start)
+{
+    gCounting = false;
+    return gAllocs - start;
+}
+
+static uint64_t StartCounting()
+{
+    gCounting = true;
+    return gAllocs;
+}
+
+/* master gain, as for a mono/stereo stream with one volume pair */
+static int32_t TestVolume()
+{
+    PayloadBuilder builder;
+    struct TestVolumeData vol;
+    struct pal_volume_data *data = nullptr;
+    uint8_t *payload = nullptr;
+    size_t size = 0;
+    uint64_t start = 0;
+    bool inPlace = true;
+
+    data = FillVolume(&vol, 1);
+    start = StartCounting();
+    for (int i = 0; i < TEST_ITERATIONS; i++) {
+        PayloadWriter writer;
+
+        builder.payloadVolumeConfig(&payload, &size, TEST_MIID, data, &writer);
+        inPlace = inPlace && payload && InWriter(writer, payload);
+        writer.release(payload);
+    }
+    TEST_CHECK(StopCounting(start) == 0);
+    TEST_CHECK(inPlace && size);
+    return 0;
+}
+
+/* per channel gain, as for a stereo stream with two volume pairs */
+static int32_t TestMultichVolume()
+{
+    PayloadBuilder builder;
+    struct TestVolumeData vol;
+    struct pal_volume_data *data = nullptr;
+    uint8_t *payload = nullptr;
+    size_t size = 0;
+    uint64_t start = 0;
+    bool inPlace = true;
+
+    data = FillVolume(&vol, 2);
+    start = StartCounting();
+    for (int i = 0; i < TEST_ITERATIONS; i++) {
+        PayloadWriter writer;
+
+        builder.payloadMultichVolumemConfig(&payload, &size, TEST_MIID, data,
+                                            &writer);
+        inPlace = inPlace && payload && InWriter(writer, payload);
+        writer.release(payload);
+    }
+    TEST_CHECK(StopCounting(start) == 0);
+    TEST_CHECK(inPlace && size);
+    return 0;
+}
+
+/* ramp prepended to the gain, the way setParameters sends a volume ramp */
+static int32_t TestVolumeRamp()
+{
+    PayloadBuilder builder;
+    struct TestVolumeData vol;
+    struct pal_volume_data *data = nullptr;
+    struct pal_volume_ramp_info ramp = {100, PAL_VOLUME_RAMP_LINEAR};
+    uint8_t *volPayload = nullptr;
+    uint8_t *rampPayload = nullptr;
+    size_t volSize = 0;
+    size_t rampSize = 0;
+    uint64_t start = 0;
+    bool inPlace = true;
+
+    data = FillVolume(&vol, 2);
+    start = StartCounting();
+    for (int i = 0; i < TEST_ITERATIONS; i++) {
+        PayloadWriter volWriter;
+        PayloadWriter rampWriter;
+
+        builder.payloadMultichVolumemConfig(&volPayload, &volSize, TEST_MIID,
+                                            data, &volWriter);
+        builder.payloadVolumeRampConfig(&rampPayload, &rampSize, TEST_MIID, &ramp,
+                                        volPayload, volSize, &rampWriter);
+        inPlace = inPlace && rampPayload && InWriter(rampWriter, rampPayload);
+        volWriter.release(volPayload);
+        rampWriter.release(rampPayload);
+    }
+    TEST_CHECK(StopCounting(start) == 0);
+    TEST_CHECK(inPlace && rampSize > volSize);
+    return 0;
+}
+
+/* without a writer every payload is a heap allocation the hook must see */
+static int32_t TestHook()
+{
+    PayloadBuilder builder;
+    struct TestVolumeData vol;
+    struct pal_volume_data *data = nullptr;
+    uint8_t *payload = nullptr;
+    size_t size = 0;
+    uint64_t start = 0;
+
+    data = FillVolume(&vol, 1);
+    start = StartCounting();
+    for (int i = 0; i < TEST_ITERATIONS; i++) {
+        builder.payloadVolumeConfig(&payload, &size, TEST_MIID, data);
+        free(payload);
+    }
+    TEST_CHECK(StopCounting(start) == TEST_ITERATIONS);
+    return 0;
+}
+
+static const TestCase kTests[] = {
+    {"volume", TestVolume},
+    {"multich_volume", TestMultichVolume},
+    {"volume_ramp", TestVolumeRamp},
+    {"hook", TestHook},
+};
+
+/* the first build may set up logging state, keep it out of the counts */
+static void WarmUp()
+{
+    PayloadBuilder builder;
+    struct TestVolumeData vol;
+    struct pal_volume_data *data = nullptr;
+    PayloadWriter writer;
+    uint8_t *payload = nullptr;
+    size_t size = 0;
+
+    data = FillVolume(&vol, 1);
+    builder.payloadVolumeConfig(&payload, &size, TEST_MIID, data, &writer);
+    writer.release(payload);
+}
+
+int main(int argc, char *argv[])
+{
+    WarmUp();
+
+    return RunTests(kTests, argc, argv);
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Standalone checks for PalRingBuffer reader/writer behaviour. Runs every
+ * case (or the ones named on the command line) and returns non-zero if any
+ * of them fails. No DSP or PAL stream is involved.
+ */
+
+#define LOG_TAG "PAL: PalRingBufferTest"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "PalRingBuffer.h"
+#include "PalTestRunner.h"
+
+#define TEST_RING_SIZE 4096
+
+typedef std::chrono::steady_clock TestClock;
+
+static uint64_t ElapsedMs(TestClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        TestClock::now() - start).count();
+}
+
+static void FillPattern(std::vector<char> &data, uint32_t seed)
+{
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (char)(seed + i);
+}
+
+/* data arriving in pieces with empty wait slices in between fills the buffer */
+static int32_t TestReadUntilGaps()
+{
+    PalRingBuffer ring(TEST_RING_SIZE);
+    PalRingBufferReader *reader = ring.newReader();
+    std::vector<char> src(1024);
+    std::vector<char> dst(src.size());
+    int32_t ret = 0;
+
+    FillPattern(src, 1);
+    reader->updateState(READER_ENABLED);
+    std::thread writer([&] {
+        for (size_t off = 0; off < src.size(); off += 256) {
+            /* longer than the read slice, so some wakeups see no data */
+            std::this_thread::sleep_for(std::chrono::milliseconds(15));
+            ring.write(src.data() + off, 256);
+        }
+    });
+    ret = reader->readUntil(dst.data(), dst.size(), 1000, 5,
+        [] { return true; });
+    writer.join();
+
+    TEST_CHECK(ret == (int32_t)src.size());
+    TEST_CHECK(memcmp(src.data(), dst.data(), src.size()) == 0);
+    return 0;
+}
+
+/* a short producer returns what arrived once the deadline passes */
+static int32_t TestReadUntilPartial()
+{
+    PalRingBuffer ring(TEST_RING_SIZE);
+    PalRingBufferReader *reader = ring.newReader();
+    std::vector<char> src(300);
+    std::vector<char> dst(1024);
+    TestClock::time_point start;
+    int32_t ret = 0;
+
+    FillPattern(src, 7);
+    reader->updateState(READER_ENABLED);
+    std::thread writer([&] {
+        ring.write(src.data(), 100);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ring.write(src.data() + 100, 200);
+    });
+    start = TestClock::now();
+    ret = reader->readUntil(dst.data(), dst.size(), 60, 5,
+        [] { return true; });
+    writer.join();
+
+    TEST_CHECK(ret == (int32_t)src.size());
+    TEST_CHECK(memcmp(src.data(), dst.data(), src.size()) == 0);
+    TEST_CHECK(ElapsedMs(start) >= 60);
+    return 0;
+}
+
+/* keepReading going false ends the read within one slice */
+static int32_t TestReadUntilStopped()
+{
+    PalRingBuffer ring(TEST_RING_SIZE);
+    PalRingBufferReader *reader = ring.newReader();
+    std::vector<char> src(100);
+    std::vector<char> dst(1024);
+    std::atomic<bool> active(true);
+    TestClock::time_point start;
+    int32_t ret = 0;
+
+    FillPattern(src, 3);
+    reader->updateState(READER_ENABLED);
+    ring.write(src.data(), src.size());
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        active = false;
+    });
+    start = TestClock::now();
+    ret = reader->readUntil(dst.data(), dst.size(), 5000, 5,
+        [&] { return active.load(); });
+    stopper.join();
+
+    TEST_CHECK(ret == (int32_t)src.size());
+    TEST_CHECK(ElapsedMs(start) < 1000);
+    return 0;
+}
+
+/* a reader disabled mid-read keeps the partial data, or fails if none */
+static int32_t TestReadUntilDisabled()
+{
+    PalRingBuffer ring(TEST_RING_SIZE);
+    PalRingBufferReader *reader = ring.newReader();
+    std::vector<char> src(100);
+    std::vector<char> dst(1024);
+    int32_t ret = 0;
+
+    FillPattern(src, 5);
+    reader->updateState(READER_ENABLED);
+    ring.write(src.data(), src.size());
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        reader->updateState(READER_DISABLED);
+    });
+    ret = reader->readUntil(dst.data(), dst.size(), 5000, 5,
+        [] { return true; });
+    stopper.join();
+    TEST_CHECK(ret == (int32_t)src.size());
+
+    ret = reader->readUntil(dst.data(), dst.size(), 50, 5,
+        [] { return true; });
+    TEST_CHECK(ret == -EINVAL);
+    return 0;
+}
+
+/* a peeked span survives disable and reset until it is released */
+static int32_t TestPeekHold()
+{
+    PalRingBuffer ring(256);
+    PalRingBufferReader *reader = ring.newReader();
+    struct pal_ring_buffer_span span;
+    std::vector<char> src(256);
+    std::vector<char> fill(256, 0x55);
+    std::atomic<bool> reset_done(false);
+    bool held = false;
+    bool intact = false;
+    size_t n = 0;
+
+    FillPattern(src, 9);
+    reader->updateState(READER_ENABLED);
+    ring.write(src.data(), src.size());
+    n = reader->peek(src.size(), &span);
+    TEST_CHECK(n == src.size());
+
+    /* disabled mid-process: the writer must not reuse the span */
+    reader->updateState(READER_DISABLED);
+    TEST_CHECK(ring.write(fill.data(), fill.size()) == 0);
+
+    std::thread resetter([&] {
+        reader->reset();
+        reset_done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    held = !reset_done;
+    intact = memcmp(span.data[0], src.data(), span.size[0]) == 0;
+
+    /* release and join before any check can return with the thread running */
+    reader->advanceReadOffset(n);
+    resetter.join();
+    TEST_CHECK(held);
+    TEST_CHECK(intact);
+    TEST_CHECK(reset_done);
+    TEST_CHECK(ring.write(fill.data(), fill.size()) == fill.size());
+    return 0;
+}
+
+/*
+ * One writer, several readers mixing copy and in-place reads. Every reader
+ * must see the writer's byte sequence with no gap or repeat. Build with
+ * -fsanitize=thread (PalRingBufferTest_tsan) to check the locking.
+ */
+static int32_t TestStress()
+{
+    const uint32_t kReaders = 4;
+    const size_t kTotal = 4 * 1024 * 1024;
+    PalRingBuffer ring(TEST_RING_SIZE);
+    std::vector<PalRingBufferReader *> readers;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> errors(0);
+
+    for (uint32_t i = 0; i < kReaders; i++) {
+        readers.push_back(ring.newReader());
+        readers.back()->updateState(READER_ENABLED);
+    }
+
+    for (uint32_t i = 0; i < kReaders; i++) {
+        threads.emplace_back([&, i] {
+            PalRingBufferReader *reader = readers[i];
+            struct pal_ring_buffer_span span;
+            std::vector<char> buf(3 * 97);
+            size_t got = 0;
+            size_t n = 0;
+            int32_t ret = 0;
+
+            while (got < kTotal) {
+                reader->waitForData(1, 5);
+                if (i % 2) {
+                    ret = reader->read(buf.data(), buf.size());
+                    if (ret < 0)
+                        break;
+                    for (int32_t k = 0; k < ret; k++)
+                        if (buf[k] != (char)(got + k))
+                            errors++;
+                    got += ret;
+                } else {
+                    n = reader->peek(buf.size(), &span);
+                    for (size_t k = 0; k < span.size[0]; k++)
+                        if (span.data[0][k] != (char)(got + k))
+                            errors++;
+                    for (size_t k = 0; k < span.size[1]; k++)
+                        if (span.data[1][k] != (char)(got + span.size[0] + k))
+                            errors++;
+                    reader->advanceReadOffset(n);
+                    got += n;
+                }
+            }
+            if (got != kTotal)
+                errors++;
+        });
+    }
+
+    std::thread writer([&] {
+        std::vector<char> chunk(251);
+        struct pal_ring_buffer_span span;
+        size_t put = 0;
+        size_t n = 0;
+        bool in_place = false;
+
+        while (put < kTotal) {
+            n = std::min(chunk.size(), kTotal - put);
+            if (in_place) {
+                n = ring.acquireWrite(n, &span);
+                for (size_t k = 0; k < span.size[0]; k++)
+                    span.data[0][k] = (char)(put + k);
+                for (size_t k = 0; k < span.size[1]; k++)
+                    span.data[1][k] = (char)(put + span.size[0] + k);
+                n = ring.commitWrite(n);
+            } else {
+                for (size_t k = 0; k < n; k++)
+                    chunk[k] = (char)(put + k);
+                n = ring.write(chunk.data(), n);
+            }
+            if (!n)
+                std::this_thread::yield();
+            put += n;
+            in_place = !in_place;
+        }
+    });
+
+    writer.join();
+    for (std::thread &t : threads)
+        t.join();
+
+    TEST_CHECK(errors == 0);
+    return 0;
+}
+
+static const TestCase kTests[] = {
+    {"read_until_gaps", TestReadUntilGaps},
+    {"read_until_partial", TestReadUntilPartial},
+    {"read_until_stopped", TestReadUntilStopped},
+    {"read_until_disabled", TestReadUntilDisabled},
+    {"peek_hold", TestPeekHold},
+    {"stress", TestStress},
+};
+
+int main(int argc, char *argv[])
+{
+    return RunTests(kTests, argc, argv);
+}
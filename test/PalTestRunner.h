@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TEST_RUNNER_H
+#define PAL_TEST_RUNNER_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+/* fails the running case, so join or release what it owns before checking */
+#define TEST_CHECK(cond)                                                 \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "  %s:%d: check failed: %s\n", __FILE__,     \
+                __LINE__, #cond);                                        \
+            return -EINVAL;                                              \
+        }                                                                \
+    } while (0)
+
+struct TestCase {
+    const char *name;
+    int32_t (*run)();
+};
+
+/*
+ * Runs every case, or the ones named on the command line, one result line
+ * each. Returns non-zero if any of them fails.
+ */
+template <size_t N>
+static int RunTests(const TestCase (&tests)[N], int argc, char *argv[])
+{
+    uint32_t failed = 0;
+    uint32_t ran = 0;
+
+    for (const TestCase &t : tests) {
+        bool selected = argc < 2;
+
+        for (int i = 1; i < argc && !selected; i++)
+            selected = std::string(argv[i]) == t.name;
+        if (!selected)
+            continue;
+
+        int32_t ret = t.run();
+        fprintf(stdout, "%-24s %s\n", t.name, ret ? "FAIL" : "ok");
+        failed += ret ? 1 : 0;
+        ran++;
+    }
+    fprintf(stdout, "%u run, %u failed\n", ran, failed);
+
+    return failed ? -EINVAL : 0;
+}
+
+#endif //PAL_TEST_RUNNER_H
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Measures pal_stream_set_volume round trips on a deep buffer speaker
+ * stream, first with no write in flight and then while a writer thread is
+ * blocked in pal_stream_write on a full buffer. With the data path off the
+ * stream mutex both should stay well below one period; a volume call
+ * queued behind the write would instead take up to a whole period.
+ *
+ * The idle calls are repeated with the session MIID cache dropped before
+ * each one, which is what every volume change cost before the cache: a
+ * metadata write and a getTaggedInfo read from AGM.
+ *
+ * Runs on target and plays silence on the speaker.
+ */
+
+#define LOG_TAG "PAL: PalVolumeBench"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "PalApi.h"
+#include "Session.h"
+#include "Stream.h"
+
+#define BENCH_SAMPLE_RATE 48000
+#define BENCH_CHANNELS 2
+#define BENCH_FRAME_BYTES (BENCH_CHANNELS * 2)
+#define BENCH_BUFFER_COUNT 4
+#define BENCH_DEFAULT_FRAMES 1920
+#define BENCH_DEFAULT_ITERATIONS 200
+#define BENCH_DEFAULT_INTERVAL_MS 3
+#define BENCH_BLOCK_WAIT_MS 2000
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct LatencyStats {
+    uint32_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+};
+
+/* one volume pair for both channels, as the audio HAL sends it */
+struct BenchVolume {
+    alignas(struct pal_volume_data) uint8_t raw[sizeof(struct pal_volume_data) +
+        sizeof(struct pal_channel_vol_kv)];
+};
+
+/* drops the MIID cache of a stream's session */
+static int32_t DropMiidCache(pal_stream_handle_t *handle)
+{
+    Session *session = NULL;
+
+    reinterpret_cast<Stream *>(handle)->getAssociatedSession(&session);
+    if (!session)
+        return -EINVAL;
+    session->invalidateMIIDCache();
+    return 0;
+}
+
+static uint64_t ElapsedUs(BenchClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        BenchClock::now() - start).count();
+}
+
+static void AddLatency(struct LatencyStats *stats, uint64_t us)
+{
+    stats->count++;
+    stats->total_us += us;
+    if (us > stats->max_us)
+        stats->max_us = us;
+}
+
+static void PrintLatency(const char *name, const struct LatencyStats *stats)
+{
+    fprintf(stdout, "%-16s %6u calls, avg %8.1f us, max %8llu us\n", name,
+            stats->count, stats->count ? (double)stats->total_us / stats->count : 0.0,
+            (unsigned long long)stats->max_us);
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-n <iterations>] [-f <frames>] [-i <interval ms>]\n"
+        "  -n <iterations>   set_volume calls per phase, default %d\n"
+        "  -f <frames>       frames per buffer, default %d\n"
+        "  -i <interval ms>  pause between set_volume calls, default %d\n",
+        prog, BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_FRAMES,
+        BENCH_DEFAULT_INTERVAL_MS);
+}
+
+static int32_t OpenPlayback(uint32_t frames, pal_stream_handle_t **handle)
+{
+    struct pal_stream_attributes attr;
+    struct pal_device device;
+    pal_buffer_config_t outCfg;
+    int32_t status = 0;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PAL_STREAM_DEEP_BUFFER;
+    attr.direction = PAL_AUDIO_OUTPUT;
+    attr.out_media_config.sample_rate = BENCH_SAMPLE_RATE;
+    attr.out_media_config.bit_width = 16;
+    attr.out_media_config.aud_fmt_id = PAL_AUDIO_FMT_PCM_S16_LE;
+    attr.out_media_config.ch_info.channels = BENCH_CHANNELS;
+    attr.out_media_config.ch_info.ch_map[0] = PAL_CHMAP_CHANNEL_FL;
+    attr.out_media_config.ch_info.ch_map[1] = PAL_CHMAP_CHANNEL_FR;
+
+    memset(&device, 0, sizeof(device));
+    device.id = PAL_DEVICE_OUT_SPEAKER;
+    device.config = attr.out_media_config;
+
+    status = pal_stream_open(&attr, 1, &device, 0, NULL, NULL, 0, handle);
+    if (status) {
+        fprintf(stderr, "pal_stream_open failed: %d\n", status);
+        return status;
+    }
+
+    memset(&outCfg, 0, sizeof(outCfg));
+    outCfg.buf_count = BENCH_BUFFER_COUNT;
+    outCfg.buf_size = frames * BENCH_FRAME_BYTES;
+    status = pal_stream_set_buffer_size(*handle, NULL, &outCfg);
+    if (!status)
+        status = pal_stream_start(*handle);
+    if (status) {
+        fprintf(stderr, "stream setup failed: %d\n", status);
+        pal_stream_close(*handle);
+        *handle = NULL;
+    }
+    return status;
+}
+
+static int32_t MeasureSetVolume(pal_stream_handle_t *handle, uint32_t iterations,
+                                uint32_t intervalMs, bool uncached,
+                                struct LatencyStats *stats)
+{
+    struct BenchVolume vol;
+    struct pal_volume_data *data = (struct pal_volume_data *)vol.raw;
+    BenchClock::time_point start;
+    int32_t status = 0;
+
+    memset(&vol, 0, sizeof(vol));
+    data->no_of_volpair = 1;
+    data->volume_pair[0].channel_mask = 0x3;
+    for (uint32_t n = 0; n < iterations; n++) {
+        /* alternate, so no layer can drop the call as a repeat */
+        data->volume_pair[0].vol = (n % 2) ? 0.5f : 0.6f;
+        if (uncached && DropMiidCache(handle)) {
+            fprintf(stderr, "stream has no session\n");
+            return -EINVAL;
+        }
+        start = BenchClock::now();
+        status = pal_stream_set_volume(handle, data);
+        AddLatency(stats, ElapsedUs(start));
+        if (status) {
+            fprintf(stderr, "pal_stream_set_volume failed: %d\n", status);
+            return status;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    pal_stream_handle_t *handle = NULL;
+    struct LatencyStats idle;
+    struct LatencyStats uncached;
+    struct LatencyStats blocked;
+    std::atomic<bool> done(false);
+    std::atomic<bool> writerBlocked(false);
+    std::atomic<uint64_t> maxBlockUs(0);
+    std::thread writer;
+    BenchClock::time_point waitStart;
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    uint32_t frames = BENCH_DEFAULT_FRAMES;
+    uint32_t intervalMs = BENCH_DEFAULT_INTERVAL_MS;
+    uint64_t periodUs = 0;
+    int32_t status = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:f:i:h")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); break;
+        case 'f': frames = atoi(optarg); break;
+        case 'i': intervalMs = atoi(optarg); break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (!iterations || !frames) {
+        Usage(argv[0]);
+        return -EINVAL;
+    }
+    periodUs = (uint64_t)frames * 1000000 / BENCH_SAMPLE_RATE;
+    memset(&idle, 0, sizeof(idle));
+    memset(&uncached, 0, sizeof(uncached));
+    memset(&blocked, 0, sizeof(blocked));
+
+    status = pal_init();
+    if (status) {
+        fprintf(stderr, "pal_init failed: %d\n", status);
+        return status;
+    }
+    status = OpenPlayback(frames, &handle);
+    if (status)
+        goto deinit;
+
+    status = MeasureSetVolume(handle, iterations, intervalMs, false, &idle);
+    if (!status)
+        status = MeasureSetVolume(handle, iterations, intervalMs, true, &uncached);
+    if (status)
+        goto close;
+
+    writer = std::thread([&] {
+        std::vector<uint8_t> silence(frames * BENCH_FRAME_BYTES);
+        struct pal_buffer buf;
+        BenchClock::time_point start;
+        uint64_t us = 0;
+        ssize_t ret = 0;
+
+        memset(&buf, 0, sizeof(buf));
+        buf.buffer = silence.data();
+        buf.size = silence.size();
+        while (!done) {
+            start = BenchClock::now();
+            ret = pal_stream_write(handle, &buf);
+            us = ElapsedUs(start);
+            if (ret < 0) {
+                if (!done)
+                    fprintf(stderr, "pal_stream_write failed: %zd\n", ret);
+                break;
+            }
+            /* a write that waited for half a period found the buffer full */
+            if (us > periodUs / 2)
+                writerBlocked = true;
+            if (us > maxBlockUs)
+                maxBlockUs = us;
+        }
+    });
+
+    waitStart = BenchClock::now();
+    while (!writerBlocked && ElapsedUs(waitStart) < BENCH_BLOCK_WAIT_MS * 1000)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (!writerBlocked) {
+        fprintf(stderr, "writer never blocked, is the stream rendering?\n");
+        status = -ETIMEDOUT;
+    } else {
+        status = MeasureSetVolume(handle, iterations, intervalMs, false, &blocked);
+    }
+    done = true;
+
+close:
+    /* stop wakes a writer still blocked in pal_stream_write */
+    pal_stream_stop(handle);
+    if (writer.joinable())
+        writer.join();
+    pal_stream_close(handle);
+
+    if (!status) {
+        fprintf(stdout, "period %.1f ms, longest blocked write %.1f ms\n",
+                periodUs / 1000.0, maxBlockUs / 1000.0);
+        PrintLatency("idle", &idle);
+        PrintLatency("idle, no MIIDs", &uncached);
+        PrintLatency("writer blocked", &blocked);
+    }
+deinit:
+    pal_deinit();
+    return status;
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Drives the MMAP lab transfer pacing against a simulated DSP producer. At
+ * the detection the producer drains the FTRT history at a multiple of real
+ * time, then keeps writing one period of real time data per period, each
+ * time publishing the write position with its CLOCK_MONOTONIC timestamp as
+ * GetMmapPosition reports it.
+ *
+ * The reader polls that position the way SoundTriggerEngineGsl::
+ * StartBuffering does, once with the old pacing (sleep a whole lab buffer
+ * after an empty poll and after every read once FTRT data is in) and once
+ * with SoundTriggerMmapPacer. For each it reports the keyword to client
+ * latency, i.e. detection until the last FTRT byte is read, the resulting
+ * drain rate, how late real time writes are picked up and the number of
+ * polls. Runs anywhere, no DSP or PAL needed.
+ */
+
+#define LOG_TAG "PAL: StMmapPacingBench"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SoundTriggerMmapPacer.h"
+
+/* 5ms mmap frames in 4 input buffers, as the sound trigger xml configures */
+#define BENCH_DEFAULT_FRAME_MS 5
+#define BENCH_DEFAULT_BUF_NUM 4
+#define BENCH_DEFAULT_PERIOD_MS 5
+#define BENCH_DEFAULT_FTRT_MS 1500
+#define BENCH_DEFAULT_FTRT_SPEED 10
+#define BENCH_DEFAULT_RT_MS 500
+#define BENCH_DEFAULT_RUNS 3
+
+typedef std::chrono::steady_clock BenchClock;
+
+enum BenchPacing {
+    PACING_FIXED,
+    PACING_PREDICTED,
+};
+
+struct BenchConfig {
+    uint32_t frame_ms;
+    uint32_t buf_num;
+    uint32_t period_ms;
+    uint32_t ftrt_ms;
+    uint32_t ftrt_speed;
+    uint32_t rt_ms;
+};
+
+struct BenchResult {
+    double kw_latency_ms;
+    double rt_avg_ms;
+    double rt_max_ms;
+    uint32_t polls;
+};
+
+/* steady_clock is CLOCK_MONOTONIC, the clock of mmap position timestamps */
+static int64_t NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        BenchClock::now().time_since_epoch()).count();
+}
+
+/*
+ * Write position of the simulated DSP in ms of audio, plus when each
+ * write landed, so the reader can tell how late it picked a write up.
+ */
+class SimProducer
+{
+public:
+    SimProducer(const struct BenchConfig *cfg) : cfg_(cfg), done_(false) {}
+
+    void start()
+    {
+        uint32_t writes = (cfg_->ftrt_ms + cfg_->rt_ms) / cfg_->period_ms;
+
+        written_ms_ = 0;
+        written_ns_ = 0;
+        write_ns_.assign(writes, 0);
+        done_ = false;
+        thread_ = std::thread([this, writes] { run(writes); });
+    }
+
+    void stop()
+    {
+        done_ = true;
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    /* as GetMmapPosition: audio written so far and when it was written */
+    void position(uint32_t *ms, int64_t *ns)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        *ms = written_ms_;
+        *ns = written_ns_;
+    }
+
+    int64_t writeNs(uint32_t index) { return write_ns_[index]; }
+
+private:
+    void run(uint32_t writes)
+    {
+        BenchClock::time_point next = BenchClock::now();
+        uint32_t ftrt_writes = cfg_->ftrt_ms / cfg_->period_ms;
+        int64_t ns = 0;
+
+        for (uint32_t i = 0; i < writes && !done_; i++) {
+            /* FTRT history goes out speed times faster than real time */
+            if (i < ftrt_writes)
+                next += std::chrono::microseconds(
+                    cfg_->period_ms * 1000 / cfg_->ftrt_speed);
+            else
+                next += std::chrono::milliseconds(cfg_->period_ms);
+            std::this_thread::sleep_until(next);
+            ns = NowNs();
+            write_ns_[i] = ns;
+            std::lock_guard<std::mutex> lock(mutex_);
+            written_ms_ += cfg_->period_ms;
+            written_ns_ = ns;
+        }
+    }
+
+    const struct BenchConfig *cfg_;
+    std::atomic<bool> done_;
+    std::thread thread_;
+    std::mutex mutex_;
+    uint32_t written_ms_;
+    int64_t written_ns_;
+    std::vector<int64_t> write_ns_;
+};
+
+static int32_t RunReader(const struct BenchConfig *cfg, enum BenchPacing pacing,
+                         struct BenchResult *result)
+{
+    SimProducer producer(cfg);
+    struct st_mmap_pacer pacer;
+    uint32_t buffer_ms = cfg->frame_ms * cfg->buf_num;
+    uint32_t total_ms = (cfg->ftrt_ms + cfg->rt_ms) / cfg->period_ms *
+        cfg->period_ms;
+    uint32_t read_ms = 0;
+    uint32_t written_ms = 0;
+    uint32_t rt_writes = 0;
+    int64_t begin_ns = 0;
+    int64_t now_ns = 0;
+    int64_t pos_ns = 0;
+    int64_t wait_ns = 0;
+    int64_t late_ns = 0;
+    double rt_total_ms = 0;
+    bool notified = false;
+
+    memset(result, 0, sizeof(*result));
+    begin_ns = NowNs();
+    SoundTriggerMmapPacerInit(&pacer, begin_ns, buffer_ms, cfg->buf_num);
+    producer.start();
+    while (read_ms < total_ms) {
+        producer.position(&written_ms, &pos_ns);
+        now_ns = NowNs();
+        result->polls++;
+        if (written_ms <= read_ms) {
+            if (pacing == PACING_FIXED) {
+                wait_ns = (int64_t)buffer_ms * 1000000;
+            } else {
+                wait_ns = SoundTriggerMmapPacerWait(&pacer, now_ns);
+                if (wait_ns < 0) {
+                    fprintf(stderr, "no progress from the producer\n");
+                    producer.stop();
+                    return -EIO;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+            continue;
+        }
+        if (pacing == PACING_PREDICTED)
+            SoundTriggerMmapPacerUpdate(&pacer, pos_ns, now_ns, read_ms == 0);
+
+        for (uint32_t ms = read_ms; ms < written_ms; ms += cfg->period_ms) {
+            if (ms < cfg->ftrt_ms)
+                continue;
+            late_ns = now_ns - producer.writeNs(ms / cfg->period_ms);
+            rt_total_ms += late_ns / 1000000.0;
+            if (late_ns / 1000000.0 > result->rt_max_ms)
+                result->rt_max_ms = late_ns / 1000000.0;
+            rt_writes++;
+        }
+        read_ms = written_ms;
+
+        if (!notified && read_ms >= cfg->ftrt_ms) {
+            result->kw_latency_ms = (now_ns - begin_ns) / 1000000.0;
+            notified = true;
+        }
+        /* the old loop slept a whole lab buffer after every read past FTRT */
+        if (notified && pacing == PACING_FIXED)
+            std::this_thread::sleep_for(std::chrono::milliseconds(buffer_ms));
+    }
+    producer.stop();
+    result->rt_avg_ms = rt_writes ? rt_total_ms / rt_writes : 0;
+
+    return 0;
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [-b <frame ms>] [-c <buffers>] [-p <period ms>] [-f <ftrt ms>]\n"
+        "          [-x <ftrt speed>] [-r <real time ms>] [-n <runs>]\n"
+        "  -b <frame ms>      mmap frame length, default %d\n"
+        "  -c <buffers>       input buffers per lab read, default %d\n"
+        "  -p <period ms>     audio per DSP write, default %d\n"
+        "  -f <ftrt ms>       FTRT history at detection, default %d\n"
+        "  -x <ftrt speed>    FTRT drain speed vs real time, default %d\n"
+        "  -r <real time ms>  real time audio after FTRT, default %d\n"
+        "  -n <runs>          runs per pacing, default %d\n",
+        prog, BENCH_DEFAULT_FRAME_MS, BENCH_DEFAULT_BUF_NUM,
+        BENCH_DEFAULT_PERIOD_MS, BENCH_DEFAULT_FTRT_MS, BENCH_DEFAULT_FTRT_SPEED,
+        BENCH_DEFAULT_RT_MS, BENCH_DEFAULT_RUNS);
+}
+
+int main(int argc, char *argv[])
+{
+    struct BenchConfig cfg;
+    struct BenchResult run;
+    struct BenchResult sum;
+    uint32_t runs = BENCH_DEFAULT_RUNS;
+    int32_t status = 0;
+    int opt = 0;
+
+    cfg.frame_ms = BENCH_DEFAULT_FRAME_MS;
+    cfg.buf_num = BENCH_DEFAULT_BUF_NUM;
+    cfg.period_ms = BENCH_DEFAULT_PERIOD_MS;
+    cfg.ftrt_ms = BENCH_DEFAULT_FTRT_MS;
+    cfg.ftrt_speed = BENCH_DEFAULT_FTRT_SPEED;
+    cfg.rt_ms = BENCH_DEFAULT_RT_MS;
+    while ((opt = getopt(argc, argv, "b:c:p:f:x:r:n:h")) != -1) {
+        switch (opt) {
+        case 'b': cfg.frame_ms = atoi(optarg); break;
+        case 'c': cfg.buf_num = atoi(optarg); break;
+        case 'p': cfg.period_ms = atoi(optarg); break;
+        case 'f': cfg.ftrt_ms = atoi(optarg); break;
+        case 'x': cfg.ftrt_speed = atoi(optarg); break;
+        case 'r': cfg.rt_ms = atoi(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (!cfg.frame_ms || !cfg.buf_num || !cfg.period_ms || !cfg.ftrt_speed ||
+        cfg.ftrt_ms < cfg.period_ms || !runs) {
+        Usage(argv[0]);
+        return -EINVAL;
+    }
+
+    fprintf(stdout, "%-10s %12s %10s %12s %12s %8s\n", "pacing", "kw lat ms",
+            "drain x", "rt avg ms", "rt max ms", "polls");
+    for (int32_t pacing = PACING_FIXED; pacing <= PACING_PREDICTED; pacing++) {
+        memset(&sum, 0, sizeof(sum));
+        for (uint32_t n = 0; n < runs; n++) {
+            status = RunReader(&cfg, (enum BenchPacing)pacing, &run);
+            if (status)
+                return status;
+            sum.kw_latency_ms += run.kw_latency_ms;
+            sum.rt_avg_ms += run.rt_avg_ms;
+            if (run.rt_max_ms > sum.rt_max_ms)
+                sum.rt_max_ms = run.rt_max_ms;
+            sum.polls += run.polls;
+        }
+        fprintf(stdout, "%-10s %12.1f %10.2f %12.2f %12.2f %8u\n",
+                pacing == PACING_FIXED ? "fixed" : "predicted",
+                sum.kw_latency_ms / runs,
+                sum.kw_latency_ms ? cfg.ftrt_ms * runs / sum.kw_latency_ms : 0.0,
+                sum.rt_avg_ms / runs, sum.rt_max_ms, sum.polls / runs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Offline replay of sound trigger second stage verification.
+ *
+ * Feeds recorded LAB/FTRT dumps (keyword_detection_*.bin, lab_reading_*.bin,
+ * dsp_output_*.bin) through PalRingBuffer and SoundTriggerCapiLoop, the
+ * loop SoundTriggerEngineCapi runs after a first stage detection, against either
+ * a real second stage CAPI library or a built-in stub. No DSP, AGM or PAL
+ * stream is involved, so the numbers only reflect buffer handoff and CAPI
+ * cost and can be used as a latency regression gate.
+ */
+
+#define LOG_TAG "PAL: StReplayTest"
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capi_v2.h"
+#include "capi_v2_extn.h"
+#include "PalRingBuffer.h"
+#include "SoundTriggerCapiLoop.h"
+
+/* keep in sync with SoundTriggerEngine.h */
+#define CNN_BUFFER_LENGTH 10000
+#define CNN_FRAME_SIZE 320
+
+typedef std::chrono::steady_clock ReplayClock;
+
+struct ReplayConfig {
+    uint32_t sample_rate = 16000;
+    uint32_t bit_width = 16;
+    uint32_t channels = 1;
+    int32_t kw_start_ms = 0;
+    int32_t kw_end_ms = -1;         /* -1: end of dump */
+    uint32_t kw_end_tolerance_ms = 0;
+    uint32_t write_chunk_ms = 20;
+    bool realtime = false;          /* pace writes, otherwise FTRT burst */
+    bool uv = false;
+    uint32_t threshold = 0;
+    uint32_t iterations = 1;
+    uint32_t gate_ms = 0;           /* fail if any decision is slower */
+    std::string capi_lib;
+    std::string model_file;
+    /* stub CAPI behaviour */
+    uint32_t stub_decide_ms = 0;    /* 0: reject at end of data */
+    uint32_t stub_work_us = 0;
+};
+
+struct ReplayStats {
+    bool detected = false;
+    int32_t status = 0;
+    uint64_t total_us = 0;
+    uint64_t algo_us = 0;
+    uint32_t bytes_processed = 0;
+    uint32_t stalls = 0;
+    uint64_t stall_us = 0;
+};
+
+static uint32_t MsToBytes(const ReplayConfig &c, uint64_t ms)
+{
+    uint64_t bytes = ms * c.sample_rate * c.channels * (c.bit_width / 8) / 1000;
+
+    return (uint32_t)bytes;
+}
+
+/* Stub second stage: fixed cost per chunk, decides after stub_decide_ms */
+struct StubCapi {
+    capi_v2_t base;
+    uint32_t processed;
+    uint32_t decide_bytes;
+    uint32_t work_us;
+};
+
+static capi_v2_err_t StubProcess(capi_v2_t *pif, capi_v2_stream_data_t *input[],
+                                 capi_v2_stream_data_t *output[] __unused)
+{
+    StubCapi *stub = (StubCapi *)pif;
+    ReplayClock::time_point until = ReplayClock::now() +
+        std::chrono::microseconds(stub->work_us);
+
+    stub->processed += input[0]->buf_ptr->actual_data_len;
+    while (ReplayClock::now() < until)
+        ;
+
+    return CAPI_V2_EOK;
+}
+
+static capi_v2_err_t StubEnd(capi_v2_t *pif)
+{
+    delete (StubCapi *)pif;
+
+    return CAPI_V2_EOK;
+}
+
+static capi_v2_err_t StubSetParam(capi_v2_t *pif, uint32_t param_id,
+                                  const capi_v2_port_info_t *port __unused,
+                                  capi_v2_buf_t *params __unused)
+{
+    StubCapi *stub = (StubCapi *)pif;
+
+    if (param_id == SVA_ID_REINIT_ALL || param_id == STAGE2_UV_WRAPPER_ID_REINIT)
+        stub->processed = 0;
+
+    return CAPI_V2_EOK;
+}
+
+static capi_v2_err_t StubGetParam(capi_v2_t *pif, uint32_t param_id,
+                                  const capi_v2_port_info_t *port __unused,
+                                  capi_v2_buf_t *params)
+{
+    StubCapi *stub = (StubCapi *)pif;
+    bool detected = stub->decide_bytes && stub->processed >= stub->decide_bytes;
+
+    if (param_id == SVA_ID_RESULT) {
+        sva_result_t *result = (sva_result_t *)params->data_ptr;
+
+        memset(result, 0, sizeof(*result));
+        result->is_detected = detected;
+        result->best_confidence = detected ? 100 : 0;
+        result->end_position = stub->processed / CNN_FRAME_SIZE;
+    } else if (param_id == STAGE2_UV_WRAPPER_ID_RESULT) {
+        stage2_uv_wrapper_result *result =
+            (stage2_uv_wrapper_result *)params->data_ptr;
+
+        memset(result, 0, sizeof(*result));
+        result->is_detected = detected;
+        result->final_user_score = detected ? 100 : 0;
+    } else {
+        return CAPI_V2_EUNSUPPORTED;
+    }
+
+    return CAPI_V2_EOK;
+}
+
+static capi_v2_t *CreateStubCapi(const ReplayConfig &c)
+{
+    static capi_v2_vtbl_t vtbl;
+    StubCapi *stub = new StubCapi();
+
+    vtbl.process = StubProcess;
+    vtbl.end = StubEnd;
+    vtbl.set_param = StubSetParam;
+    vtbl.get_param = StubGetParam;
+    stub->base.vtbl_ptr = &vtbl;
+    stub->processed = 0;
+    stub->decide_bytes = MsToBytes(c, c.stub_decide_ms);
+    stub->work_us = c.stub_work_us;
+
+    return &stub->base;
+}
+
+static int32_t ReadFile(const std::string &path, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    long size = 0;
+
+    if (!fp) {
+        fprintf(stderr, "failed to open %s: %s\n", path.c_str(), strerror(errno));
+        return -ENOENT;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    if (size > 0 && fread(data.data(), 1, size, fp) != (size_t)size) {
+        fclose(fp);
+        fprintf(stderr, "short read on %s\n", path.c_str());
+        return -EIO;
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+/* Loads and configures the second stage the way LoadSoundModel/StartSoundEngine do */
+static capi_v2_t *CreateCapi(const ReplayConfig &c, void **lib_handle,
+                             std::vector<uint8_t> &model, void **scratch)
+{
+    capi_v2_t *capi = nullptr;
+    capi_v2_init_f capi_init = nullptr;
+    capi_v2_proplist_t init_proplist;
+    capi_v2_prop_t sm_prop;
+    capi_v2_buf_t buf;
+    sva_threshold_config_t kw_threshold;
+    stage2_uv_wrapper_threshold_config_t uv_threshold;
+    stage2_uv_wrapper_scratch_param_t in_model_param;
+    stage2_uv_wrapper_scratch_param_t scratch_param;
+
+    *lib_handle = nullptr;
+    *scratch = nullptr;
+    if (c.capi_lib.empty())
+        return CreateStubCapi(c);
+
+    if (ReadFile(c.model_file, model))
+        return nullptr;
+
+    *lib_handle = dlopen(c.capi_lib.c_str(), RTLD_NOW);
+    if (!*lib_handle) {
+        fprintf(stderr, "dlopen %s failed: %s\n", c.capi_lib.c_str(), dlerror());
+        return nullptr;
+    }
+    capi_init = (capi_v2_init_f)dlsym(*lib_handle, "capi_v2_init");
+    if (!capi_init) {
+        fprintf(stderr, "capi_v2_init not found in %s\n", c.capi_lib.c_str());
+        return nullptr;
+    }
+
+    capi = (capi_v2_t *)calloc(1, sizeof(capi_v2_t) + (2 * sizeof(char *)));
+    if (!capi)
+        return nullptr;
+
+    sm_prop.id = CAPI_V2_CUSTOM_INIT_DATA;
+    sm_prop.payload.data_ptr = (int8_t *)model.data();
+    sm_prop.payload.actual_data_len = model.size();
+    sm_prop.payload.max_data_len = model.size();
+    init_proplist.props_num = 1;
+    init_proplist.prop_ptr = &sm_prop;
+    if (capi_init(capi, &init_proplist) != CAPI_V2_EOK || !capi->vtbl_ptr) {
+        fprintf(stderr, "capi_v2_init failed\n");
+        free(capi);
+        return nullptr;
+    }
+
+    if (!c.uv) {
+        memset(&kw_threshold, 0, sizeof(kw_threshold));
+        kw_threshold.smm_threshold = c.threshold;
+        buf.data_ptr = (int8_t *)&kw_threshold;
+        buf.actual_data_len = sizeof(kw_threshold);
+        buf.max_data_len = sizeof(kw_threshold);
+        capi->vtbl_ptr->set_param(capi, SVA_ID_THRESHOLD_CONFIG, nullptr, &buf);
+        capi->vtbl_ptr->set_param(capi, SVA_ID_REINIT_ALL, nullptr, nullptr);
+        return capi;
+    }
+
+    memset(&in_model_param, 0, sizeof(in_model_param));
+    buf.data_ptr = (int8_t *)&in_model_param;
+    buf.actual_data_len = sizeof(in_model_param);
+    buf.max_data_len = sizeof(in_model_param);
+    capi->vtbl_ptr->get_param(capi, STAGE2_UV_WRAPPER_ID_INMODEL_BUFFER_SIZE,
+                              nullptr, &buf);
+    if (in_model_param.scratch_size == 0) {
+        memset(&scratch_param, 0, sizeof(scratch_param));
+        buf.data_ptr = (int8_t *)&scratch_param;
+        buf.actual_data_len = sizeof(scratch_param);
+        buf.max_data_len = sizeof(scratch_param);
+        capi->vtbl_ptr->get_param(capi, STAGE2_UV_WRAPPER_ID_SCRATCH_PARAM,
+                                  nullptr, &buf);
+        scratch_param.scratch_ptr = (int8_t *)calloc(1, scratch_param.scratch_size);
+        *scratch = scratch_param.scratch_ptr;
+        capi->vtbl_ptr->set_param(capi, STAGE2_UV_WRAPPER_ID_SCRATCH_PARAM,
+                                  nullptr, &buf);
+    }
+
+    memset(&uv_threshold, 0, sizeof(uv_threshold));
+    uv_threshold.threshold = c.threshold;
+    buf.data_ptr = (int8_t *)&uv_threshold;
+    buf.actual_data_len = sizeof(uv_threshold);
+    buf.max_data_len = sizeof(uv_threshold);
+    capi->vtbl_ptr->set_param(capi, STAGE2_UV_WRAPPER_ID_THRESHOLD, nullptr, &buf);
+
+    return capi;
+}
+
+/*
+ * Plays the role of the first stage session filling the LAB ring buffer:
+ * the dump as an FTRT burst (or paced with -R), then real time silence
+ * until the second stage has decided, as the DSP keeps streaming.
+ */
+static void WriterLoop(PalRingBuffer *ring, const std::vector<uint8_t> *dump,
+                       uint32_t chunk_bytes, bool realtime, uint32_t chunk_ms,
+                       const std::atomic<bool> *done)
+{
+    ReplayClock::time_point next = ReplayClock::now();
+    std::vector<uint8_t> silence(chunk_bytes, 0);
+    size_t offset = 0;
+    size_t size = 0;
+
+    while (offset < dump->size() && !done->load()) {
+        size = std::min((size_t)chunk_bytes, dump->size() - offset);
+        offset += ring->write((void *)(dump->data() + offset), size);
+        if (realtime) {
+            next += std::chrono::milliseconds(chunk_ms);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    next = ReplayClock::now();
+    while (!done->load()) {
+        ring->write(silence.data(), silence.size());
+        next += std::chrono::milliseconds(chunk_ms);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+/*
+ * Runs one detection through SoundTriggerCapiLoop, the loop used by
+ * SoundTriggerEngineCapi::StartKeywordDetection/StartUserVerification.
+ */
+static ReplayStats ReplayDetection(const ReplayConfig &c, capi_v2_t *capi,
+                                   const std::vector<uint8_t> &dump)
+{
+    ReplayStats stats;
+    PalRingBuffer ring(dump.size() + MsToBytes(c, c.write_chunk_ms));
+    PalRingBufferReader *reader = ring.newReader();
+    struct st_capi_loop_config loop_cfg;
+    struct st_capi_loop_stats loop_stats;
+    std::atomic<bool> exit_loop(false);
+    std::atomic<bool> writer_done(false);
+    std::vector<char> wrap_buff;
+    sva_result_t kw_result;
+    stage2_uv_wrapper_result uv_result;
+    uint32_t kw_start = MsToBytes(c, c.kw_start_ms);
+    uint32_t kw_end = c.kw_end_ms < 0 ? dump.size() : MsToBytes(c, c.kw_end_ms);
+    uint32_t cnn_buffer_size = MsToBytes(c, CNN_BUFFER_LENGTH / 1000);
+    ReplayClock::time_point start;
+
+    kw_end = std::min(kw_end, (uint32_t)dump.size());
+    memset(&loop_cfg, 0, sizeof(loop_cfg));
+    if (c.uv) {
+        SoundTriggerCapiUvWindow(&loop_cfg, kw_start, kw_end, 0,
+            MsToBytes(c, c.kw_end_tolerance_ms));
+        loop_cfg.result_param_id = STAGE2_UV_WRAPPER_ID_RESULT;
+        loop_cfg.result = &uv_result;
+        loop_cfg.result_size = sizeof(uv_result);
+    } else {
+        SoundTriggerCapiKwWindow(&loop_cfg, kw_start, kw_end, 0,
+            MsToBytes(c, c.kw_end_tolerance_ms), cnn_buffer_size);
+        loop_cfg.chunk = cnn_buffer_size;
+        loop_cfg.result_param_id = SVA_ID_RESULT;
+        loop_cfg.result = &kw_result;
+        loop_cfg.result_size = sizeof(kw_result);
+    }
+    if (!loop_cfg.first_chunk || loop_cfg.start >= loop_cfg.end) {
+        fprintf(stderr, "invalid keyword window %u-%u\n", loop_cfg.start,
+            loop_cfg.end);
+        stats.status = -EINVAL;
+        return stats;
+    }
+    wrap_buff.resize(std::max(loop_cfg.first_chunk, loop_cfg.chunk));
+    memset(&kw_result, 0, sizeof(kw_result));
+    memset(&uv_result, 0, sizeof(uv_result));
+    loop_cfg.reader = reader;
+    loop_cfg.capi = capi;
+    loop_cfg.wrap_buff = wrap_buff.data();
+    loop_cfg.exit = &exit_loop;
+    loop_cfg.trace_name = "StReplayTest process";
+
+    ring.updateIndices(kw_start, kw_end);
+    reader->updateState(READER_ENABLED);
+    std::thread writer(WriterLoop, &ring, &dump, MsToBytes(c, c.write_chunk_ms),
+                       c.realtime, c.write_chunk_ms, &writer_done);
+
+    start = ReplayClock::now();
+    stats.status = SoundTriggerCapiLoop(&loop_cfg, &loop_stats, [&]() {
+        stats.detected = c.uv ? uv_result.is_detected : kw_result.is_detected;
+        return stats.detected;
+    });
+    stats.total_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        ReplayClock::now() - start).count();
+    stats.algo_us = loop_stats.process_us + loop_stats.get_param_us;
+    stats.bytes_processed = loop_stats.bytes_processed;
+    stats.stalls = loop_stats.stalls;
+    stats.stall_us = loop_stats.stall_us;
+
+    capi->vtbl_ptr->set_param(capi,
+        c.uv ? STAGE2_UV_WRAPPER_ID_REINIT : SVA_ID_REINIT_ALL, nullptr, nullptr);
+    reader->updateState(READER_DISABLED);
+    writer_done = true;
+    writer.join();
+
+    return stats;
+}
+
+static void Usage(const char *prog)
+{
+    fprintf(stdout,
+        "Usage: %s [options] dump.bin [dump.bin ...]\n"
+        "  -r <rate>        sample rate (16000)\n"
+        "  -b <bits>        bit width (16)\n"
+        "  -c <channels>    channels (1)\n"
+        "  -s <ms>          keyword start in dump (0)\n"
+        "  -e <ms>          keyword end in dump (end of dump)\n"
+        "  -t <ms>          keyword end tolerance (0)\n"
+        "  -w <ms>          writer chunk (20)\n"
+        "  -R               pace writer in real time instead of FTRT\n"
+        "  -u               user verification instead of keyword detection\n"
+        "  -l <lib.so>      second stage CAPI library (built-in stub if unset)\n"
+        "  -m <model.bin>   sound model for -l\n"
+        "  -T <level>       confidence threshold for -l\n"
+        "  -d <ms>          stub: detect after this much audio (0 rejects)\n"
+        "  -W <us>          stub: compute cost per process call\n"
+        "  -n <count>       iterations per dump (1)\n"
+        "  -g <ms>          fail if any decision takes longer than this\n",
+        prog);
+}
+
+int main(int argc, char *argv[])
+{
+    ReplayConfig cfg;
+    std::vector<uint8_t> model;
+    std::vector<uint8_t> dump;
+    void *lib_handle = nullptr;
+    void *scratch = nullptr;
+    capi_v2_t *capi = nullptr;
+    uint64_t max_us = 0;
+    uint64_t sum_us = 0;
+    uint32_t runs = 0;
+    int status = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "r:b:c:s:e:t:w:Rul:m:T:d:W:n:g:h")) != -1) {
+        switch (opt) {
+        case 'r': cfg.sample_rate = atoi(optarg); break;
+        case 'b': cfg.bit_width = atoi(optarg); break;
+        case 'c': cfg.channels = atoi(optarg); break;
+        case 's': cfg.kw_start_ms = atoi(optarg); break;
+        case 'e': cfg.kw_end_ms = atoi(optarg); break;
+        case 't': cfg.kw_end_tolerance_ms = atoi(optarg); break;
+        case 'w': cfg.write_chunk_ms = atoi(optarg); break;
+        case 'R': cfg.realtime = true; break;
+        case 'u': cfg.uv = true; break;
+        case 'l': cfg.capi_lib = optarg; break;
+        case 'm': cfg.model_file = optarg; break;
+        case 'T': cfg.threshold = atoi(optarg); break;
+        case 'd': cfg.stub_decide_ms = atoi(optarg); break;
+        case 'W': cfg.stub_work_us = atoi(optarg); break;
+        case 'n': cfg.iterations = atoi(optarg); break;
+        case 'g': cfg.gate_ms = atoi(optarg); break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (optind >= argc || !cfg.write_chunk_ms || !cfg.sample_rate ||
+        (!cfg.capi_lib.empty() && cfg.model_file.empty())) {
+        Usage(argv[0]);
+        return -EINVAL;
+    }
+
+    capi = CreateCapi(cfg, &lib_handle, model, &scratch);
+    if (!capi)
+        return -EINVAL;
+
+    fprintf(stdout, "dump, run, decision, total_ms, algo_ms, bytes, stalls, stall_ms\n");
+    for (int i = optind; i < argc && !status; i++) {
+        status = ReadFile(argv[i], dump);
+        for (uint32_t n = 0; n < cfg.iterations && !status; n++) {
+            ReplayStats stats = ReplayDetection(cfg, capi, dump);
+
+            status = stats.status;
+            fprintf(stdout, "%s, %u, %s, %.3f, %.3f, %u, %u, %.3f\n",
+                argv[i], n, stats.detected ? "detect" : "reject",
+                stats.total_us / 1000.0, stats.algo_us / 1000.0,
+                stats.bytes_processed, stats.stalls, stats.stall_us / 1000.0);
+            max_us = std::max(max_us, stats.total_us);
+            sum_us += stats.total_us;
+            runs++;
+        }
+    }
+
+    if (runs)
+        fprintf(stdout, "runs %u, avg %.3f ms, max %.3f ms\n",
+            runs, sum_us / 1000.0 / runs, max_us / 1000.0);
+    if (!status && cfg.gate_ms && max_us > (uint64_t)cfg.gate_ms * 1000) {
+        fprintf(stderr, "latency gate failed: max %.3f ms > %u ms\n",
+            max_us / 1000.0, cfg.gate_ms);
+        status = -ETIMEDOUT;
+    }
+
+    capi->vtbl_ptr->end(capi);
+    if (lib_handle) {
+        free(capi);
+        dlclose(lib_handle);
+    }
+    if (scratch)
+        free(scratch);
+
+    return status;
+}
@@ -0,0 +1,41 @@
+#-------------------------------------------
+#   Common part of the tests and benches linked against libar-pal. After
+#   CLEAR_VARS set LOCAL_MODULE and LOCAL_SRC_FILES, then include this file.
+#-------------------------------------------
+LOCAL_USE_VNDK := true
+
+LOCAL_C_INCLUDES     += $(LOCAL_PATH) \
+                        $(TOP)/system/media/audio_route/include \
+                        $(TOP)/system/media/audio/include
+
+LOCAL_CFLAGS += -Wall -Werror -Wno-unused-parameter
+LOCAL_CFLAGS += -Wno-macro-redefined
+LOCAL_CFLAGS += -DCONFIG_GSL
+LOCAL_CPPFLAGS += -fexceptions -frtti
+
+LOCAL_MODULE_OWNER         := qti
+LOCAL_MODULE_TAGS          := optional
+
+LOCAL_HEADER_LIBRARIES := \
+    libspf-headers \
+    libcapiv2_headers \
+    libagm_headers \
+    libacdb_headers \
+    libarpal_headers
+
+LOCAL_SHARED_LIBRARIES := \
+    libar-pal \
+    liblog \
+    libexpat \
+    libaudioroute \
+    libcutils
+
+ifneq ($(filter 11 R, $(PLATFORM_VERSION)),)
+LOCAL_C_INCLUDES       += $(TOP)/vendor/qcom/opensource/tinyalsa/include
+LOCAL_SHARED_LIBRARIES += libqti-tinyalsa
+else
+LOCAL_SHARED_LIBRARIES += libtinyalsa
+endif
+LOCAL_VENDOR_MODULE := true
+
+include $(BUILD_EXECUTABLE)
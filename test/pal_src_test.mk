@@ -0,0 +1,30 @@
+#-------------------------------------------
+#   Common part of the tests and benches that build the PAL sources they
+#   exercise instead of linking libar-pal. After CLEAR_VARS set
+#   LOCAL_MODULE and LOCAL_SRC_FILES (plus any LOCAL_SANITIZE or
+#   LOCAL_MULTILIB), then include this file.
+#-------------------------------------------
+LOCAL_USE_VNDK := true
+
+LOCAL_C_INCLUDES     += $(LOCAL_PATH) \
+                        $(LOCAL_PATH)/utils/inc \
+                        $(LOCAL_PATH)/session/inc
+
+LOCAL_CFLAGS += -Wall -Werror -Wno-unused-parameter
+LOCAL_CFLAGS += -Wno-macro-redefined
+
+LOCAL_MODULE_OWNER         := qti
+LOCAL_MODULE_TAGS          := optional
+
+LOCAL_HEADER_LIBRARIES := \
+    libspf-headers \
+    libcapiv2_headers \
+    libarpal_headers
+
+LOCAL_SHARED_LIBRARIES := \
+    liblog \
+    liblx-osal \
+    libcutils
+LOCAL_VENDOR_MODULE := true
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_IO_REACTOR_H
+#define PAL_IO_REACTOR_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <poll.h>
+
+/*
+ * One poll() thread shared by every non-blocking PAL session. A session arms
+ * a one-shot watch on its driver fd when a read or write comes back short;
+ * the handler then runs on the reactor thread once the fd becomes ready.
+ */
+class PalIoReactor
+{
+public:
+    typedef std::function<void(short revents)> Handler;
+
+    static std::shared_ptr<PalIoReactor> getInstance();
+    ~PalIoReactor();
+    /* replaces any watch the owner already has armed */
+    int32_t arm(const void *owner, int fd, short events, Handler handler);
+    /* on return the owner's handler is neither armed nor running */
+    void disarm(const void *owner);
+
+private:
+    struct Watch {
+        int fd;
+        short events;
+        Handler handler;
+    };
+
+    PalIoReactor();
+    static void threadLoop(PalIoReactor *reactor);
+    void wake();
+
+    static std::mutex sInstanceLock;
+    static std::shared_ptr<PalIoReactor> sInstance;
+    std::mutex mLock;
+    std::condition_variable mDispatchCv;
+    std::unordered_map<const void *, Watch> mWatches;
+    const void *mDispatching;
+    int mWakeFd;
+    bool mExit;
+    std::thread mThread;
+};
+
+#endif //PAL_IO_REACTOR_H
@@ -36,6 +36,9 @@
 #include <stdlib.h>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -51,6 +54,15 @@ typedef enum {
     READER_ENABLED = 1,
 } pal_ring_buffer_reader_state;
 
+/*
+ * Up to two contiguous regions of ring buffer memory, the second one is
+ * only used when the requested range wraps around the end of the buffer.
+ */
+struct pal_ring_buffer_span {
+    char *data[2];
+    size_t size[2];
+};
+
 class PalRingBuffer;
 
 class PalRingBufferReader {
@@ -59,17 +71,22 @@ class PalRingBufferReader {
          : ringBuffer_(buffer),
            unreadSize_(0),
            readOffset_(0),
-           state_(READER_DISABLED) {}
+           state_(READER_DISABLED),
+           peekHeld_(false) {}
 
     ~PalRingBufferReader() {};
 
     size_t advanceReadOffset(size_t advanceSize);
     int32_t read(void* readBuffer, size_t readSize);
+    size_t peek(size_t peekSize, struct pal_ring_buffer_span *span);
     void updateState(pal_ring_buffer_reader_state state);
     void getIndices(uint32_t *startIndice, uint32_t *endIndice);
     size_t getUnreadSize();
+    size_t waitForData(size_t waitSize, uint32_t timeoutMs);
+    int32_t readUntil(void *readBuffer, size_t readSize, uint32_t timeoutMs,
+                      uint32_t sliceMs, const std::function<bool()> &keepReading);
     void reset();
-    bool isEnabled() { return state_ == READER_ENABLED; }
+    bool isEnabled();
 
     friend class PalRingBuffer;
     friend class StreamSoundTrigger;
@@ -79,6 +96,8 @@ class PalRingBufferReader {
     size_t unreadSize_;
     size_t readOffset_;
     pal_ring_buffer_reader_state state_;
+    /* peeked data is in use until advanceReadOffset, reset waits for it */
+    bool peekHeld_;
 };
 
 class PalRingBuffer {
@@ -104,6 +123,8 @@ class PalRingBuffer {
     size_t read(std::shared_ptr<PalRingBufferReader>reader, void* readBuffer,
                 size_t readSize);
     size_t write(void* writeBuffer, size_t writeSize);
+    size_t acquireWrite(size_t writeSize, struct pal_ring_buffer_span *span);
+    size_t commitWrite(size_t writtenSize);
     size_t getFreeSize();
     void updateIndices(uint32_t startIndice, uint32_t endIndice);
     void reset();
@@ -112,6 +133,7 @@ class PalRingBuffer {
 
  protected:
     std::mutex mutex_;
+    std::condition_variable cv_;
     char* buffer_;
     uint32_t startIndex;
     uint32_t endIndex;
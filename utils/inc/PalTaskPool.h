@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TASK_POOL_H
+#define PAL_TASK_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#define PAL_TASK_POOL_IDLE_TIMEOUT_MS 5000
+
+/*
+ * Worker threads shared by every session that has to run blocking driver
+ * calls (compress_wait, drains) off the client thread. Tasks are grouped by
+ * owner: tasks of one owner run one at a time in post order, tasks of
+ * different owners run in parallel. A worker is spawned only when every
+ * existing one is busy and retires after PAL_TASK_POOL_IDLE_TIMEOUT_MS idle,
+ * so the thread count follows the number of owners blocked right now rather
+ * than the number of open sessions.
+ */
+class PalTaskPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    static std::shared_ptr<PalTaskPool> getInstance();
+    void post(const void *owner, Task task);
+    /* waits for every task the owner posted so far, not from the owner's tasks */
+    void drain(const void *owner);
+    uint32_t getThreadCount();
+
+private:
+    struct Strand {
+        std::deque<Task> tasks;
+        bool running = false;
+    };
+
+    PalTaskPool();
+    static void workerLoop(PalTaskPool *pool);
+
+    static std::mutex sInstanceLock;
+    static std::shared_ptr<PalTaskPool> sInstance;
+    std::mutex mLock;
+    std::condition_variable mWorkCv;
+    std::condition_variable mDoneCv;
+    std::unordered_map<const void *, Strand> mStrands;
+    std::deque<const void *> mReady;
+    uint32_t mThreads;
+    uint32_t mIdle;
+};
+
+#endif //PAL_TASK_POOL_H
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TIMER_SERVICE_H
+#define PAL_TIMER_SERVICE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+/*
+ * One thread serving every PAL timeout. Callbacks run on the timer thread,
+ * so they should only post work or take short locks.
+ */
+class PalTimerService
+{
+public:
+    typedef uint64_t Handle; /* 0 is never a valid handle */
+    typedef std::function<void()> Callback;
+
+    static std::shared_ptr<PalTimerService> getInstance();
+    Handle schedule(uint32_t delayMs, Callback cb);
+    /*
+     * Returns true if the callback was removed before it ran. With wait set,
+     * a callback already running on the timer thread is waited for.
+     */
+    bool cancel(Handle handle, bool wait = false);
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    PalTimerService();
+    static void threadLoop(PalTimerService *service);
+
+    static std::mutex sInstanceLock;
+    static std::shared_ptr<PalTimerService> sInstance;
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::condition_variable mDoneCv;
+    /* ordered by deadline, handle breaks ties in schedule order */
+    std::map<std::pair<TimePoint, Handle>, Callback> mTimers;
+    std::unordered_map<Handle, TimePoint> mDeadlines;
+    Handle mNextHandle;
+    Handle mRunning;
+    std::thread::id mThreadId;
+};
+
+#endif //PAL_TIMER_SERVICE_H
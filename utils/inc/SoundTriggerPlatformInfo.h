@@ -41,6 +41,8 @@
 
 #define IS_MODULE_TYPE_PDK(type) (type == ST_MODULE_TYPE_PDK5 || type == ST_MODULE_TYPE_PDK6)
 #define MAX_MODULE_CHANNELS 4
+/* merged model blobs kept per engine, 0 disables the cache */
+#define ST_MERGED_MODEL_CACHE_SIZE_KB 1024
 
 using UUID = SoundTriggerUUID;
 
@@ -200,6 +202,9 @@ class SoundTriggerPlatformInfo : public SoundTriggerXml {
     bool GetNotifySecondStageFailure() { return notify_second_stage_failure_; }
     uint32_t GetMmapBufferDuration() const { return mmap_buffer_duration_; }
     uint32_t GetMmapFrameLength() const { return mmap_frame_length_; }
+    uint32_t GetMergedModelCacheSizeKb() const {
+        return merged_model_cache_size_kb_;
+    }
     std::shared_ptr<SoundModelConfig> GetSmConfig(const UUID& uuid) const;
     std::shared_ptr<CaptureProfile> GetCapProfile(const std::string& name) const;
     void GetSmConfigForVersionQuery(
@@ -232,6 +237,7 @@ class SoundTriggerPlatformInfo : public SoundTriggerXml {
     bool support_defer_lpi_switch_;
     uint32_t mmap_buffer_duration_;
     uint32_t mmap_frame_length_;
+    uint32_t merged_model_cache_size_kb_;
     std::string sound_model_lib_;
     std::map<UUID, std::shared_ptr<SoundModelConfig>> sound_model_cfg_list_;
     st_cap_profile_map_t capture_profile_map_;
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalIoReactor"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <sys/eventfd.h>
+#include "PalIoReactor.h"
+#include "PalCommon.h"
+
+std::mutex PalIoReactor::sInstanceLock;
+std::shared_ptr<PalIoReactor> PalIoReactor::sInstance = nullptr;
+
+std::shared_ptr<PalIoReactor> PalIoReactor::getInstance()
+{
+    std::lock_guard<std::mutex> lock(sInstanceLock);
+
+    if (!sInstance)
+        sInstance = std::shared_ptr<PalIoReactor>(new PalIoReactor());
+
+    return sInstance;
+}
+
+PalIoReactor::PalIoReactor()
+    : mDispatching(nullptr),
+      mExit(false)
+{
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        PAL_ERR(LOG_TAG, "eventfd failed %s", strerror(errno));
+        return;
+    }
+    mThread = std::thread(threadLoop, this);
+}
+
+PalIoReactor::~PalIoReactor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+        mWatches.clear();
+        if (mWakeFd >= 0)
+            wake();
+    }
+    if (mThread.joinable())
+        mThread.join();
+    if (mWakeFd >= 0)
+        close(mWakeFd);
+}
+
+void PalIoReactor::wake()
+{
+    uint64_t one = 1;
+
+    if (write(mWakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        PAL_ERR(LOG_TAG, "wake failed %s", strerror(errno));
+}
+
+int32_t PalIoReactor::arm(const void *owner, int fd, short events, Handler handler)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mWakeFd < 0 || fd < 0 || !handler) {
+        PAL_ERR(LOG_TAG, "cannot arm fd %d", fd);
+        return -EINVAL;
+    }
+    mWatches[owner] = {fd, events, std::move(handler)};
+    wake();
+
+    return 0;
+}
+
+void PalIoReactor::disarm(const void *owner)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (mWatches.erase(owner))
+        wake();
+
+    /* a handler disarming itself must not wait for its own return */
+    if (std::this_thread::get_id() == mThread.get_id())
+        return;
+
+    mDispatchCv.wait(lock, [&] { return mDispatching != owner; });
+}
+
+void PalIoReactor::threadLoop(PalIoReactor *reactor)
+{
+    std::vector<struct pollfd> fds;
+    std::vector<const void *> owners;
+    std::unique_lock<std::mutex> lock(reactor->mLock);
+    uint64_t count = 0;
+    int ret = 0;
+
+    PAL_DBG(LOG_TAG, "Enter");
+    while (!reactor->mExit) {
+        fds.clear();
+        owners.clear();
+        fds.push_back({reactor->mWakeFd, POLLIN, 0});
+        owners.push_back(nullptr);
+        for (auto &watch : reactor->mWatches) {
+            fds.push_back({watch.second.fd, watch.second.events, 0});
+            owners.push_back(watch.first);
+        }
+        lock.unlock();
+
+        ret = poll(fds.data(), fds.size(), -1);
+        if (ret < 0 && errno != EINTR)
+            PAL_ERR(LOG_TAG, "poll failed %s", strerror(errno));
+        if (fds[0].revents & POLLIN) {
+            if (read(reactor->mWakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                PAL_ERR(LOG_TAG, "wake drain failed %s", strerror(errno));
+        }
+
+        lock.lock();
+        for (size_t i = 1; i < fds.size() && ret > 0; i++) {
+            if (!fds[i].revents)
+                continue;
+            /* skip owners that disarmed or re-armed while we were polling */
+            auto it = reactor->mWatches.find(owners[i]);
+            if (it == reactor->mWatches.end() || it->second.fd != fds[i].fd)
+                continue;
+
+            Handler handler = std::move(it->second.handler);
+            reactor->mWatches.erase(it);
+            reactor->mDispatching = owners[i];
+            lock.unlock();
+            handler(fds[i].revents);
+            lock.lock();
+            reactor->mDispatching = nullptr;
+            reactor->mDispatchCv.notify_all();
+        }
+    }
+    PAL_DBG(LOG_TAG, "Exit");
+}
@@ -57,7 +57,7 @@ size_t PalRingBuffer::getFreeSize()
     std::vector<PalRingBufferReader*>::iterator it;
 
     for (it = readOffsets_.begin(); it != readOffsets_.end(); it++) {
-        if ((*(it))->state_ == READER_ENABLED)
+        if ((*(it))->state_ == READER_ENABLED || (*(it))->peekHeld_)
             freeSize = std::min(freeSize, bufferEnd_ - (*(it))->unreadSize_);
     }
     return freeSize;
@@ -76,6 +76,7 @@ void PalRingBuffer::updateUnReadSize(size_t writtenSize)
 
 void PalRingBuffer::updateIndices(uint32_t startIndice, uint32_t endIndice)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     startIndex = startIndice;
     endIndex = endIndice;
     PAL_VERBOSE(LOG_TAG, "start index = %u, end index = %u", startIndex, endIndex);
@@ -120,6 +121,48 @@ size_t PalRingBuffer::write(void* writeBuffer, size_t writeSize)
     writeOffset_ = writeOffset_ % bufferEnd_;
     PAL_DBG(LOG_TAG, "Exit. writeOffset(%zu)", writeOffset_);
     mutex_.unlock();
+    if (writtenSize)
+        cv_.notify_all();
+    return writtenSize;
+}
+
+static void fillSpan(char *base, size_t bufferSize, size_t offset,
+                     size_t size, struct pal_ring_buffer_span *span)
+{
+    span->data[0] = base + offset;
+    span->size[0] = std::min(size, bufferSize - offset);
+    span->data[1] = base;
+    span->size[1] = size - span->size[0];
+}
+
+/*
+ * Expose up to writeSize bytes of free ring memory so the single writer
+ * can fill it in place. Nothing is visible to readers until commitWrite.
+ */
+size_t PalRingBuffer::acquireWrite(size_t writeSize,
+                                   struct pal_ring_buffer_span *span)
+{
+    size_t sizeToWrite = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sizeToWrite = std::min(writeSize, getFreeSize());
+    fillSpan(buffer_, bufferEnd_, writeOffset_, sizeToWrite, span);
+    PAL_VERBOSE(LOG_TAG, "writeOffset(%zu), acquired %zu", writeOffset_,
+                sizeToWrite);
+    return sizeToWrite;
+}
+
+size_t PalRingBuffer::commitWrite(size_t writtenSize)
+{
+    mutex_.lock();
+    writtenSize = std::min(writtenSize, getFreeSize());
+    writeOffset_ = (writeOffset_ + writtenSize) % bufferEnd_;
+    updateUnReadSize(writtenSize);
+    PAL_VERBOSE(LOG_TAG, "writeOffset(%zu), committed %zu", writeOffset_,
+                writtenSize);
+    mutex_.unlock();
+    if (writtenSize)
+        cv_.notify_all();
     return writtenSize;
 }
 
@@ -152,6 +195,7 @@ int32_t PalRingBufferReader::read(void* readBuffer, size_t bufferSize)
 {
     int32_t readSize = 0;
 
+    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
     if (state_ == READER_DISABLED)
         return -EINVAL;
 
@@ -159,8 +203,6 @@ int32_t PalRingBufferReader::read(void* readBuffer, size_t bufferSize)
     if (unreadSize_ == 0)
         return 0;
 
-    ringBuffer_->mutex_.lock();
-
     // when writeOffset leads readOffset
     if (ringBuffer_->writeOffset_ > readOffset_) {
         unreadSize_ = ringBuffer_->writeOffset_ - readOffset_;
@@ -215,16 +257,40 @@ int32_t PalRingBufferReader::read(void* readBuffer, size_t bufferSize)
                           ringBuffer_->writeOffset_;
         }
     }
-    ringBuffer_->mutex_.unlock();
     return readSize;
 }
 
+/*
+ * Expose up to peekSize unread bytes in place without copying them out.
+ * The data stays valid until it is released with advanceReadOffset: the
+ * writer does not overwrite it even if the reader gets disabled, and
+ * reset() waits for the release.
+ */
+size_t PalRingBufferReader::peek(size_t peekSize, struct pal_ring_buffer_span *span)
+{
+    size_t sizeToPeek = 0;
+
+    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
+    if (state_ == READER_ENABLED)
+        sizeToPeek = std::min(peekSize, unreadSize_);
+    if (sizeToPeek)
+        peekHeld_ = true;
+    fillSpan(ringBuffer_->buffer_, ringBuffer_->bufferEnd_, readOffset_,
+             sizeToPeek, span);
+    return sizeToPeek;
+}
+
 size_t PalRingBufferReader::advanceReadOffset(size_t advanceSize)
 {
     size_t size_advanced = 0;
 
     std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
 
+    if (peekHeld_) {
+        peekHeld_ = false;
+        ringBuffer_->cv_.notify_all();
+    }
+
     /* add code to advance the offset here*/
     if (unreadSize_ < advanceSize) {
         PAL_ERR(LOG_TAG, "Cannot advance read offset %zu greater than unread size %zu",
@@ -260,10 +326,12 @@ void PalRingBufferReader::updateState(pal_ring_buffer_reader_state state)
         }
     }
     state_ = state;
+    ringBuffer_->cv_.notify_all();
 }
 
 void PalRingBufferReader::getIndices(uint32_t *startIndice, uint32_t *endIndice)
 {
+    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
     *startIndice = ringBuffer_->startIndex;
     *endIndice = ringBuffer_->endIndex;
     PAL_VERBOSE(LOG_TAG, "start index = %u, end index = %u",
@@ -272,17 +340,79 @@ void PalRingBufferReader::getIndices(uint32_t *startIndice, uint32_t *endIndice)
 
 size_t PalRingBufferReader::getUnreadSize()
 {
+    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
     PAL_VERBOSE(LOG_TAG, "unread size %zu", unreadSize_);
     return unreadSize_;
 }
 
+/*
+ * Block until at least waitSize bytes are unread, the reader gets
+ * disabled/reset or timeoutMs expires. Returns the unread size seen
+ * on wakeup, which may be less than waitSize.
+ */
+size_t PalRingBufferReader::waitForData(size_t waitSize, uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(ringBuffer_->mutex_);
+
+    ringBuffer_->cv_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+        [&] { return state_ == READER_DISABLED || unreadSize_ >= waitSize; });
+    PAL_VERBOSE(LOG_TAG, "unread size %zu, requested %zu", unreadSize_, waitSize);
+    return unreadSize_;
+}
+
+/*
+ * Read until readSize bytes are filled, timeoutMs expires, the reader fails
+ * (e.g. disabled) or keepReading returns false. Empty wakeups do not end the
+ * read; keepReading is checked at least every sliceMs. Returns the bytes
+ * read, or the reader error if nothing was read.
+ */
+int32_t PalRingBufferReader::readUntil(void *readBuffer, size_t readSize,
+    uint32_t timeoutMs, uint32_t sliceMs,
+    const std::function<bool()> &keepReading)
+{
+    auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(timeoutMs);
+    size_t size = 0;
+    int32_t ret = 0;
+    uint32_t waitMs = 0;
+
+    while (size < readSize) {
+        ret = read((char *)readBuffer + size, readSize - size);
+        if (ret < 0)
+            break;
+        size += ret;
+        if (size == readSize || !keepReading())
+            break;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            break;
+        waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - now).count() + 1;
+        waitForData(readSize - size, std::min(waitMs, sliceMs));
+    }
+
+    return size ? (int32_t)size : ret;
+}
+
+bool PalRingBufferReader::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
+
+    return state_ == READER_ENABLED;
+}
+
 void PalRingBufferReader::reset()
 {
-    ringBuffer_->mutex_.lock();
+    std::unique_lock<std::mutex> lock(ringBuffer_->mutex_);
+
+    /* a span handed out by peek may still be in use, e.g. by capi process */
+    ringBuffer_->cv_.wait(lock, [this] { return !peekHeld_; });
     readOffset_ = 0;
     unreadSize_ = 0;
     state_ = READER_DISABLED;
-    ringBuffer_->mutex_.unlock();
+    lock.unlock();
+    ringBuffer_->cv_.notify_all();
 }
 
 PalRingBufferReader* PalRingBuffer::newReader()
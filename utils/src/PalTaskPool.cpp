@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalTaskPool"
+
+#include <chrono>
+#include "PalTaskPool.h"
+#include "PalCommon.h"
+
+std::mutex PalTaskPool::sInstanceLock;
+std::shared_ptr<PalTaskPool> PalTaskPool::sInstance = nullptr;
+
+std::shared_ptr<PalTaskPool> PalTaskPool::getInstance()
+{
+    std::lock_guard<std::mutex> lock(sInstanceLock);
+
+    if (!sInstance)
+        sInstance = std::shared_ptr<PalTaskPool>(new PalTaskPool());
+
+    return sInstance;
+}
+
+PalTaskPool::PalTaskPool()
+    : mThreads(0),
+      mIdle(0)
+{
+}
+
+void PalTaskPool::post(const void *owner, Task task)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    Strand &strand = mStrands[owner];
+
+    strand.tasks.push_back(std::move(task));
+    /* a running or already queued strand is rescheduled by its worker */
+    if (strand.running || strand.tasks.size() > 1)
+        return;
+
+    mReady.push_back(owner);
+    if (mReady.size() > mIdle) {
+        mThreads++;
+        PAL_DBG(LOG_TAG, "spawning worker, %u threads", mThreads);
+        std::thread(workerLoop, this).detach();
+    } else {
+        mWorkCv.notify_one();
+    }
+}
+
+void PalTaskPool::drain(const void *owner)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    mDoneCv.wait(lock, [&] { return mStrands.find(owner) == mStrands.end(); });
+}
+
+uint32_t PalTaskPool::getThreadCount()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return mThreads;
+}
+
+void PalTaskPool::workerLoop(PalTaskPool *pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mLock);
+    const void *owner = nullptr;
+    Task task;
+
+    while (1) {
+        if (pool->mReady.empty()) {
+            pool->mIdle++;
+            pool->mWorkCv.wait_for(lock,
+                    std::chrono::milliseconds(PAL_TASK_POOL_IDLE_TIMEOUT_MS),
+                    [pool] { return !pool->mReady.empty(); });
+            pool->mIdle--;
+            if (pool->mReady.empty())
+                break;
+        }
+
+        owner = pool->mReady.front();
+        pool->mReady.pop_front();
+        auto it = pool->mStrands.find(owner);
+        task = std::move(it->second.tasks.front());
+        it->second.tasks.pop_front();
+        it->second.running = true;
+        lock.unlock();
+
+        task();
+        task = nullptr;
+
+        lock.lock();
+        it = pool->mStrands.find(owner);
+        it->second.running = false;
+        if (!it->second.tasks.empty())
+            pool->mReady.push_back(owner);
+        else
+            pool->mStrands.erase(it);
+        pool->mDoneCv.notify_all();
+    }
+    pool->mThreads--;
+    PAL_DBG(LOG_TAG, "worker retired, %u threads", pool->mThreads);
+}
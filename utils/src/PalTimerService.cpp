@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalTimerService"
+
+#include "PalTimerService.h"
+#include "PalCommon.h"
+
+std::mutex PalTimerService::sInstanceLock;
+std::shared_ptr<PalTimerService> PalTimerService::sInstance = nullptr;
+
+std::shared_ptr<PalTimerService> PalTimerService::getInstance()
+{
+    std::lock_guard<std::mutex> lock(sInstanceLock);
+
+    if (!sInstance)
+        sInstance = std::shared_ptr<PalTimerService>(new PalTimerService());
+
+    return sInstance;
+}
+
+PalTimerService::PalTimerService()
+    : mNextHandle(1),
+      mRunning(0)
+{
+    std::thread timerThread(threadLoop, this);
+
+    mThreadId = timerThread.get_id();
+    timerThread.detach();
+}
+
+PalTimerService::Handle PalTimerService::schedule(uint32_t delayMs, Callback cb)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    TimePoint deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(delayMs);
+    Handle handle = mNextHandle++;
+
+    mTimers.emplace(std::make_pair(deadline, handle), std::move(cb));
+    mDeadlines.emplace(handle, deadline);
+    mCv.notify_one();
+    PAL_VERBOSE(LOG_TAG, "timer %llu in %u ms", (unsigned long long)handle, delayMs);
+
+    return handle;
+}
+
+bool PalTimerService::cancel(Handle handle, bool wait)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    auto it = mDeadlines.find(handle);
+
+    if (it != mDeadlines.end()) {
+        mTimers.erase(std::make_pair(it->second, handle));
+        mDeadlines.erase(it);
+        mCv.notify_one();
+        return true;
+    }
+
+    if (wait && std::this_thread::get_id() != mThreadId)
+        mDoneCv.wait(lock, [&] { return mRunning != handle; });
+
+    return false;
+}
+
+void PalTimerService::threadLoop(PalTimerService *service)
+{
+    std::unique_lock<std::mutex> lock(service->mLock);
+    Callback cb;
+    Handle handle = 0;
+
+    while (1) {
+        if (service->mTimers.empty()) {
+            service->mCv.wait(lock);
+            continue;
+        }
+
+        auto it = service->mTimers.begin();
+        if (it->first.first > std::chrono::steady_clock::now()) {
+            service->mCv.wait_until(lock, it->first.first);
+            continue;
+        }
+
+        handle = it->first.second;
+        cb = std::move(it->second);
+        service->mTimers.erase(it);
+        service->mDeadlines.erase(handle);
+        service->mRunning = handle;
+        lock.unlock();
+
+        cb();
+        cb = nullptr;
+
+        lock.lock();
+        service->mRunning = 0;
+        service->mDoneCv.notify_all();
+    }
+}
@@ -408,6 +408,7 @@ SoundTriggerPlatformInfo::SoundTriggerPlatformInfo() :
     support_defer_lpi_switch_(true),
     mmap_buffer_duration_(0),
     mmap_frame_length_(0),
+    merged_model_cache_size_kb_(ST_MERGED_MODEL_CACHE_SIZE_KB),
     sound_model_lib_("liblistensoundmodel2vendor.so"),
     curr_child_(nullptr)
 {
@@ -541,6 +542,8 @@ void SoundTriggerPlatformInfo::HandleStartTag(const char* tag,
                 mmap_buffer_duration_ = std::stoi(attribs[++i]);
             } else if (!strcmp(attribs[i], "mmap_frame_length")) {
                 mmap_frame_length_ = std::stoi(attribs[++i]);
+            } else if (!strcmp(attribs[i], "merged_model_cache_size_kb")) {
+                merged_model_cache_size_kb_ = std::stoi(attribs[++i]);
             } else if (!strcmp(attribs[i], "sound_model_lib")) {
                 sound_model_lib_ = std::string(attribs[++i]);
             } else if (!strcmp(attribs[i], "notify_second_stage_failure")) {